@@ -0,0 +1,796 @@
+/**
+ * @file bassil_bench.cpp
+ * @brief Entry point of bassil-bench, the lexer benchmark suite.
+ *
+ * Two sub-commands:
+ *
+ *     bassil-bench gen [--size 10MB] [--mix comments] [--seed 1] -o corpus.basl
+ *     bassil-bench run [--size 10MB | --input file.basl] [--mix ...] [--seed ...]
+ *                      [--warmup 2] [--reps 10] [--phases lex,save,display]
+ *                      [--split 2KB] [--jobs n] [--log file] [--json results.json] [--perf]
+ *
+ * "run" measures lex(), save_tokens() and display_tokens() over a generated or
+ * given corpus and reports MB/s, tokens/s, heap allocations and peak RSS per
+ * phase. --split cuts the corpus into files of about the given size, each
+ * ending before an unindented line; the "lex" phase then lexes them one after
+ * another with a reused Lexer, and the "lex-oneshot" phase with a fresh lex()
+ * call per file. The "utf8" phase times the UTF-8 validation that lexing
+ * starts with, and the "parse" phase Parser::parse() over the already lexed
+ * files; "parse-parallel" uses Parser::parseParallel() on a pool of --jobs
+ * threads instead. "reparse"
+ * builds a SyntaxTree of the whole corpus once, then times edits at random
+ * offsets (a space typed and deleted again) with SyntaxTree::edit().
+ * "resolve" times Resolver::resolve() over the already parsed files, and
+ * "typecheck" TypeChecker::check() over the already resolved ones; "fold"
+ * times ConstantFolder::fold() over the type-checked files. "interpret"
+ * runs the files without errors compiled to bytecode (give a program with
+ * --input; generated corpora do not run), "tree-walk" runs them with the
+ * reference TreeWalker, for the speedup of the bytecode. The JSON
+ * output is meant to be kept per commit and diffed. --perf adds hardware
+ * counters (IPC, branch/cache misses per KB) where perf_event_open works.
+ */
+
+#include "headers/bytecode.h"
+#include "headers/constant_folder.h"
+#include "headers/corpus.h"
+#include "headers/interpreter.h"
+#include "headers/lexer.h"
+#include "headers/parser.h"
+#include "headers/perf_counters.h"
+#include "headers/resolver.h"
+#include "headers/syntax_tree.h"
+#include "headers/thread_pool.h"
+#include "headers/type_checker.h"
+#include "headers/utf8.h"
+#include "headers/utils.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+// Allocation counters: every operator new in the process goes through here.
+static std::atomic<std::uint64_t> allocationCount{0};
+static std::atomic<std::uint64_t> allocationBytes{0};
+
+void *operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+// One release path, like the one allocation path above: the array and sized forms forward to it.
+// GCC 11+ inlines this into callers and then reports -Wmismatched-new-delete for free() on a pointer
+// from operator new; that is a false positive, because the operator new above allocates with malloc().
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+void operator delete[](void *p) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+namespace
+{
+    struct BenchOptions
+    {
+        Corpus::Options corpus;
+        std::string inputFile;
+        std::string outputFile;
+        std::string jsonFile;
+        std::string logFile;
+        std::vector<std::string> phases = {"lex", "save", "display"};
+        std::uint64_t splitBytes = 0; ///< Lex the corpus as files of about this size (0 = one file)
+        unsigned jobs = 0;            ///< Threads of the parse-parallel phase (0 = one per core)
+        int warmup = 2;
+        int reps = 10;
+        bool perf = false;
+    };
+
+    struct PhaseResult
+    {
+        std::string name;
+        std::vector<std::uint64_t> nanoseconds;
+        std::uint64_t allocations = 0; ///< Per repetition
+        std::uint64_t allocatedBytes = 0;
+        long peakRssKb = 0;
+        size_t tokens = 0;
+    };
+
+    long peakRssKb()
+    {
+#ifndef _WIN32
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+#else
+        return 0;
+#endif
+    }
+
+    std::uint64_t median(std::vector<std::uint64_t> values)
+    {
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    }
+
+    /**
+     * @brief Cuts text into pieces of about pieceBytes, ending each at a newline.
+     */
+    std::vector<std::string> splitCorpus(const std::string &text, std::uint64_t pieceBytes)
+    {
+        std::vector<std::string> pieces;
+        size_t pos = 0;
+        while (pos < text.size())
+        {
+            size_t end = text.size();
+            if (pieceBytes != 0 && pos + pieceBytes < text.size())
+            {
+                // Cut before an unindented line that is not a '}' or 'else', so statements stay whole for the parser.
+                size_t newline = text.find('\n', pos + pieceBytes);
+                while (newline != std::string::npos && newline + 1 < text.size() &&
+                       (text[newline + 1] == ' ' || text[newline + 1] == '\t' || text[newline + 1] == '}' ||
+                        text.compare(newline + 1, 4, "else") == 0))
+                {
+                    newline = text.find('\n', newline + 1);
+                }
+                end = newline == std::string::npos ? text.size() : newline + 1;
+            }
+            pieces.push_back(text.substr(pos, end - pos));
+            pos = end;
+        }
+        return pieces;
+    }
+
+    void printUsage()
+    {
+        std::cout << "Usage: bassil-bench gen [--size <n>] [--mix <mix>] [--seed <n>] -o <file>\n"
+                  << "       bassil-bench [run] [--size <n> | --input <file>] [--mix <mix>] [--seed <n>]\n"
+                  << "                    [--warmup <n>] [--reps <n>] [--phases lex,save,display]\n"
+                  << "                    [--split <n>] [--jobs <n>] [--log <file>] [--json <file>] [--perf]\n"
+                  << "\n"
+                  << "Sizes accept KB/MB/GB suffixes. Mixes: balanced, identifiers, strings, comments, operators.\n"
+                  << "Phases: lex, lex-oneshot, utf8, parse, parse-parallel, reparse, resolve, typecheck, fold, interpret, tree-walk, save, display. --split <n> lexes the corpus as files of about <n> bytes.\n"
+                  << "display_tokens only writes when --log is given; otherwise it measures formatting alone.\n";
+    }
+
+    /**
+     * @brief Runs one phase warmup + reps times and collects its measurements.
+     */
+    template <typename Fn>
+    PhaseResult measure(const char *name, const BenchOptions &options, size_t corpusBytes, Fn &&body)
+    {
+        PhaseResult result;
+        result.name = name;
+
+        for (int i = 0; i < options.warmup; i++)
+        {
+            body();
+        }
+
+        std::uint64_t countBefore = allocationCount.load();
+        std::uint64_t bytesBefore = allocationBytes.load();
+        for (int i = 0; i < options.reps; i++)
+        {
+            BASSIL_PERF_REGION(name, corpusBytes);
+            auto start = std::chrono::steady_clock::now();
+            body();
+            auto end = std::chrono::steady_clock::now();
+            result.nanoseconds.push_back(static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+        }
+        result.allocations = (allocationCount.load() - countBefore) / options.reps;
+        result.allocatedBytes = (allocationBytes.load() - bytesBefore) / options.reps;
+        result.peakRssKb = peakRssKb();
+        return result;
+    }
+
+    int parseArguments(int argc, char **argv, bool &generateOnly, BenchOptions &options)
+    {
+        int i = 1;
+        if (i < argc && (std::strcmp(argv[i], "gen") == 0 || std::strcmp(argv[i], "run") == 0))
+        {
+            generateOnly = std::strcmp(argv[i], "gen") == 0;
+            i++;
+        }
+
+        for (; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg == "-h" || arg == "--help")
+            {
+                printUsage();
+                return -1;
+            }
+            if (arg == "--perf")
+            {
+                options.perf = true;
+                continue;
+            }
+            if (i + 1 >= argc)
+            {
+                std::cerr << "bassil-bench: missing value for " << arg << "\n";
+                return 2;
+            }
+            std::string value = argv[++i];
+
+            if (arg == "--size")
+            {
+                if (!Corpus::parseSize(value, options.corpus.bytes))
+                {
+                    std::cerr << "bassil-bench: invalid size '" << value << "'\n";
+                    return 2;
+                }
+            }
+            else if (arg == "--split")
+            {
+                if (!Corpus::parseSize(value, options.splitBytes))
+                {
+                    std::cerr << "bassil-bench: invalid size '" << value << "'\n";
+                    return 2;
+                }
+            }
+            else if (arg == "--mix")
+            {
+                if (!Corpus::parseMix(value, options.corpus.mix))
+                {
+                    std::cerr << "bassil-bench: unknown mix '" << value << "'\n";
+                    return 2;
+                }
+            }
+            else if (arg == "--seed")
+            {
+                options.corpus.seed = std::strtoull(value.c_str(), nullptr, 10);
+            }
+            else if (arg == "--input")
+            {
+                options.inputFile = value;
+            }
+            else if (arg == "-o" || arg == "--output")
+            {
+                options.outputFile = value;
+            }
+            else if (arg == "--json")
+            {
+                options.jsonFile = value;
+            }
+            else if (arg == "--log")
+            {
+                options.logFile = value;
+            }
+            else if (arg == "--warmup")
+            {
+                options.warmup = std::max(0, std::atoi(value.c_str()));
+            }
+            else if (arg == "--reps")
+            {
+                options.reps = std::max(1, std::atoi(value.c_str()));
+            }
+            else if (arg == "--jobs")
+            {
+                options.jobs = static_cast<unsigned>(std::max(0, std::atoi(value.c_str())));
+            }
+            else if (arg == "--phases")
+            {
+                options.phases = Utils::split_string(value, ",");
+            }
+            else
+            {
+                std::cerr << "bassil-bench: unknown option '" << arg << "'\n";
+                return 2;
+            }
+        }
+        return 0;
+    }
+
+    void writeJson(const BenchOptions &options, const std::string &corpusName, size_t corpusBytes, const std::vector<PhaseResult> &results)
+    {
+        std::ofstream out(options.jsonFile, std::ios::trunc);
+        out << std::fixed << std::setprecision(3);
+        out << "{\n"
+            << "  \"corpus\": {\"name\": \"" << Utils::escapeJson(corpusName) << "\", \"bytes\": " << corpusBytes
+            << ", \"mix\": \"" << Corpus::mixName(options.corpus.mix) << "\", \"seed\": " << options.corpus.seed
+            << ", \"split_bytes\": " << options.splitBytes << "},\n"
+            << "  \"warmup\": " << options.warmup << ",\n"
+            << "  \"reps\": " << options.reps << ",\n"
+            << "  \"phases\": [\n";
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const PhaseResult &r = results[i];
+            std::uint64_t med = median(r.nanoseconds);
+            std::uint64_t best = *std::min_element(r.nanoseconds.begin(), r.nanoseconds.end());
+            double seconds = med / 1e9;
+            out << "    {\"name\": \"" << r.name << "\""
+                << ", \"median_ns\": " << med
+                << ", \"min_ns\": " << best
+                << ", \"mb_per_s\": " << (corpusBytes / (1024.0 * 1024.0)) / seconds
+                << ", \"tokens_per_s\": " << r.tokens / seconds
+                << ", \"allocations\": " << r.allocations
+                << ", \"allocated_bytes\": " << r.allocatedBytes
+                << ", \"peak_rss_kb\": " << r.peakRssKb;
+            for (const auto &region : PerfCounters::totals())
+            {
+                if (region.name != r.name)
+                {
+                    continue;
+                }
+                bool first = true;
+                for (int c = 0; c < PerfCounters::PC_Count; c++)
+                {
+                    if (region.valid[c])
+                    {
+                        out << (first ? ", \"perf\": {" : ", ") << "\"" << PerfCounters::counterName(static_cast<PerfCounters::Counter>(c))
+                            << "\": " << region.values[c] / region.calls;
+                        first = false;
+                    }
+                }
+                out << (first ? "" : "}");
+            }
+            out << ", \"samples_ns\": [";
+            for (size_t s = 0; s < r.nanoseconds.size(); s++)
+            {
+                out << (s ? ", " : "") << r.nanoseconds[s];
+            }
+            out << "]}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bool generateOnly = false;
+    BenchOptions options;
+    int status = parseArguments(argc, argv, generateOnly, options);
+    if (status != 0)
+    {
+        return status < 0 ? 0 : status;
+    }
+
+    if (generateOnly)
+    {
+        if (options.outputFile.empty())
+        {
+            Corpus::generate(options.corpus, std::cout);
+            return 0;
+        }
+        std::ofstream out(options.outputFile, std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+        {
+            std::cerr << "bassil-bench: cannot write " << options.outputFile << "\n";
+            return 1;
+        }
+        Corpus::generate(options.corpus, out);
+        return 0;
+    }
+
+    logBool = false; // Lexer diagnostics are not part of the measurement
+    std::string corpus;
+    std::string corpusName;
+    if (!options.inputFile.empty())
+    {
+        try
+        {
+            corpus = Utils::readFileToString(options.inputFile);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "bassil-bench: cannot read " << options.inputFile << "\n";
+            return 1;
+        }
+        corpusName = options.inputFile;
+    }
+    else
+    {
+        corpus = Corpus::generate(options.corpus);
+        corpusName = std::string("generated-") + Corpus::mixName(options.corpus.mix);
+    }
+
+    std::string tokensFile = options.outputFile.empty() ? "bassil-bench-tokens.json" : options.outputFile;
+    // The lex phases rewind the arena for every file, so after warmup they reuse the same chunks.
+    CompilationArena arena(corpus.size() + 1024);
+    std::vector<Diagnostic> diagnostics;
+    std::vector<Token> tokens = lex(corpus, diagnostics, arena);
+    CompilationArena::Mark lexed = arena.mark();
+    std::vector<std::string> files = splitCorpus(corpus, options.splitBytes);
+    Lexer lexer;
+
+    PerfCounters::setEnabled(options.perf);
+    std::vector<PhaseResult> results;
+    size_t astNodes = 0;
+    size_t astBytes = 0;
+    for (const auto &phase : options.phases)
+    {
+        size_t phaseTokens = tokens.size();
+        if (phase == "lex")
+        {
+            results.push_back(measure("lex", options, corpus.size(), [&]
+                                      {
+                                          phaseTokens = 0;
+                                          for (const std::string &file : files)
+                                          {
+                                              arena.resetTo(lexed);
+                                              phaseTokens += lexer.lex(file, arena).size();
+                                          } }));
+        }
+        else if (phase == "lex-oneshot")
+        {
+            results.push_back(measure("lex-oneshot", options, corpus.size(), [&]
+                                      {
+                                          phaseTokens = 0;
+                                          for (const std::string &file : files)
+                                          {
+                                              arena.resetTo(lexed);
+                                              std::vector<Diagnostic> phaseDiagnostics;
+                                              phaseTokens += lex(file, phaseDiagnostics, arena).size();
+                                          } }));
+        }
+        else if (phase == "utf8")
+        {
+            // Validation alone; lex() runs it too, so compare with the lex phase.
+            size_t invalid = 0;
+            results.push_back(measure("utf8", options, corpus.size(), [&]
+                                      { invalid += Utf8::findInvalid(corpus) != std::string_view::npos; }));
+            if (invalid != 0)
+            {
+                std::cerr << "bassil-bench: corpus is not valid UTF-8\n";
+            }
+        }
+        else if (phase == "parse" || phase == "parse-parallel")
+        {
+            // Lex every file up front and keep the tokens, so only the parser is timed.
+            arena.resetTo(lexed);
+            std::vector<std::vector<Token>> fileTokens;
+            size_t syntaxErrors = 0;
+            for (const std::string &file : files)
+            {
+                fileTokens.push_back(lexer.lex(file, arena));
+            }
+            CompilationArena::Mark fileTokensLexed = arena.mark();
+            Parser parser;
+            std::unique_ptr<ThreadPool> pool;
+            if (phase == "parse-parallel")
+            {
+                pool = std::make_unique<ThreadPool>(options.jobs);
+            }
+            results.push_back(measure(phase.c_str(), options, corpus.size(), [&]
+                                      {
+                                          phaseTokens = 0;
+                                          syntaxErrors = 0;
+                                          astNodes = 0;
+                                          astBytes = 0;
+                                          for (const std::vector<Token> &tokensOfFile : fileTokens)
+                                          {
+                                              arena.resetTo(fileTokensLexed);
+                                              const Ast &tree = pool ? parser.parseParallel(tokensOfFile, arena, *pool) : parser.parse(tokensOfFile, arena);
+                                              phaseTokens += tokensOfFile.size();
+                                              syntaxErrors += parser.diagnostics().size();
+                                              astNodes += tree.size();
+                                              astBytes += tree.bytes();
+                                          } }));
+            arena.resetTo(lexed);
+            if (syntaxErrors != 0)
+            {
+                std::cerr << "bassil-bench: " << syntaxErrors << " file(s) stopped at a syntax error\n";
+            }
+        }
+        else if (phase == "reparse")
+        {
+            // The edits put the text back, so every repetition starts from the same tree.
+            constexpr int EditPairs = 100;
+            SyntaxTree tree = SyntaxTree::parse(corpus);
+            std::mt19937 random(static_cast<std::uint32_t>(options.corpus.seed));
+            std::uniform_int_distribution<std::uint32_t> offsets(0, static_cast<std::uint32_t>(corpus.size()));
+            ReparseStats total = {0, 0, 0};
+            results.push_back(measure("reparse", options, corpus.size(), [&]
+                                      {
+                                          total = {0, 0, 0};
+                                          for (int i = 0; i < EditPairs; i++)
+                                          {
+                                              std::uint32_t offset = offsets(random);
+                                              ReparseStats stats;
+                                              tree = tree.edit({offset, 0, " "}, &stats);
+                                              total.reusedItems += stats.reusedItems;
+                                              total.reparsedItems += stats.reparsedItems;
+                                              total.relexedBytes += stats.relexedBytes;
+                                              tree = tree.edit({offset, 1, ""}, &stats);
+                                              total.reusedItems += stats.reusedItems;
+                                              total.reparsedItems += stats.reparsedItems;
+                                              total.relexedBytes += stats.relexedBytes;
+                                          } }));
+            phaseTokens = 0;
+            std::cout << "reparse: " << 2 * EditPairs << " edits/rep, " << std::fixed << std::setprecision(3)
+                      << median(results.back().nanoseconds) / 1e6 / (2 * EditPairs) << " ms/edit, "
+                      << total.reparsedItems / (2.0 * EditPairs) << " items reparsed and "
+                      << total.relexedBytes / (2.0 * EditPairs) << " bytes relexed per edit, "
+                      << total.reusedItems / (2.0 * EditPairs) << " items reused\n";
+        }
+        else if (phase == "resolve")
+        {
+            // Lex and parse every file up front and keep the trees, so only the resolver is timed.
+            arena.resetTo(lexed);
+            std::vector<std::vector<Token>> fileTokens;
+            std::vector<Ast> fileTrees;
+            Parser parser;
+            for (const std::string &file : files)
+            {
+                fileTokens.push_back(lexer.lex(file, arena));
+                fileTrees.push_back(parser.parse(fileTokens.back(), arena));
+            }
+            CompilationArena::Mark filesParsed = arena.mark();
+            Resolver resolver;
+            size_t symbols = 0;
+            size_t bound = 0;
+            size_t errors = 0;
+            results.push_back(measure("resolve", options, corpus.size(), [&]
+                                      {
+                                          phaseTokens = 0;
+                                          symbols = bound = errors = 0;
+                                          for (size_t i = 0; i < fileTrees.size(); i++)
+                                          {
+                                              arena.resetTo(filesParsed);
+                                              const Resolution &resolution = resolver.resolve(fileTrees[i].view(), fileTokens[i], arena);
+                                              phaseTokens += fileTokens[i].size();
+                                              symbols += resolution.symbols.size();
+                                              bound += resolution.bindings.size() - std::count(resolution.bindings.begin(), resolution.bindings.end(), NoBinding);
+                                              errors += resolver.diagnostics().size();
+                                          } }));
+            arena.resetTo(lexed);
+            std::cout << "resolve: " << symbols << " declarations, " << bound << " bindings, "
+                      << errors << " name errors\n";
+        }
+        else if (phase == "typecheck")
+        {
+            // Lex, parse and resolve every file up front, so only the checker is timed.
+            arena.resetTo(lexed);
+            std::vector<std::vector<Token>> fileTokens;
+            std::vector<Ast> fileTrees;
+            std::vector<Resolution> fileNames;
+            Parser parser;
+            Resolver resolver;
+            for (const std::string &file : files)
+            {
+                fileTokens.push_back(lexer.lex(file, arena));
+                fileTrees.push_back(parser.parse(fileTokens.back(), arena));
+                fileNames.push_back(resolver.resolve(fileTrees.back().view(), fileTokens.back(), arena));
+            }
+            CompilationArena::Mark filesResolved = arena.mark();
+            TypeChecker checker;
+            size_t errors = 0;
+            size_t types = 0;
+            results.push_back(measure("typecheck", options, corpus.size(), [&]
+                                      {
+                                          phaseTokens = 0;
+                                          errors = types = 0;
+                                          for (size_t i = 0; i < fileTrees.size(); i++)
+                                          {
+                                              arena.resetTo(filesResolved);
+                                              checker.check(fileTrees[i].view(), fileTokens[i], fileNames[i], arena);
+                                              phaseTokens += fileTokens[i].size();
+                                              errors += checker.diagnostics().size();
+                                              types += checker.table().size();
+                                          } }));
+            arena.resetTo(lexed);
+            std::cout << "typecheck: " << types << " distinct types over all files, " << errors << " type errors\n";
+        }
+        else if (phase == "fold")
+        {
+            // Run every pass before folding up front, so only the folder is timed.
+            arena.resetTo(lexed);
+            std::vector<std::vector<Token>> fileTokens;
+            std::vector<std::vector<NumericLiteral>> fileLiterals;
+            std::vector<Ast> fileTrees;
+            std::vector<Resolution> fileNames;
+            std::vector<std::vector<TypeId>> fileTypes;
+            Parser parser;
+            Resolver resolver;
+            TypeChecker checker;
+            for (const std::string &file : files)
+            {
+                fileTokens.push_back(lexer.lex(file, arena));
+                fileLiterals.push_back(lexer.literals());
+                fileTrees.push_back(parser.parse(fileTokens.back(), arena));
+                fileNames.push_back(resolver.resolve(fileTrees.back().view(), fileTokens.back(), arena));
+                fileTypes.push_back(checker.check(fileTrees.back().view(), fileTokens.back(), fileNames.back(), arena));
+            }
+            ConstantFolder folder;
+            size_t folded = 0;
+            size_t errors = 0;
+            results.push_back(measure("fold", options, corpus.size(), [&]
+                                      {
+                                          phaseTokens = 0;
+                                          folded = errors = 0;
+                                          for (size_t i = 0; i < fileTrees.size(); i++)
+                                          {
+                                              folder.fold(fileTrees[i].view(), fileTokens[i], fileLiterals[i], fileNames[i], fileTypes[i]);
+                                              phaseTokens += fileTokens[i].size();
+                                              folded += folder.foldedCount();
+                                              errors += folder.diagnostics().size();
+                                          } }));
+            arena.resetTo(lexed);
+            std::cout << "fold: " << folded << " operators and names folded, " << errors << " divisions by zero\n";
+        }
+        else if (phase == "interpret" || phase == "tree-walk")
+        {
+            // Check and compile every file up front; only the files without errors run.
+            arena.resetTo(lexed);
+            std::vector<std::vector<Token>> fileTokens;
+            std::vector<std::vector<NumericLiteral>> fileLiterals;
+            std::vector<Ast> fileTrees;
+            std::vector<Resolution> fileNames;
+            std::vector<std::vector<TypeId>> fileTypes;
+            std::vector<std::unique_ptr<BytecodeCompiler>> filePrograms;
+            Parser parser;
+            Resolver resolver;
+            TypeChecker checker;
+            ConstantFolder folder;
+            size_t skipped = 0;
+            for (const std::string &file : files)
+            {
+                std::vector<Token> tokensOfFile = lexer.lex(file, arena);
+                std::vector<Diagnostic> errors = lexer.diagnostics();
+                const Ast &tree = parser.parse(tokensOfFile, arena);
+                mergeDiagnostics(errors, parser.diagnostics());
+                const Resolution &names = resolver.resolve(tree.view(), tokensOfFile, arena);
+                mergeDiagnostics(errors, resolver.diagnostics());
+                const std::vector<TypeId> &types = checker.check(tree.view(), tokensOfFile, names, arena);
+                mergeDiagnostics(errors, checker.diagnostics());
+                folder.fold(tree.view(), tokensOfFile, lexer.literals(), names, types);
+                mergeDiagnostics(errors, folder.diagnostics());
+                if (!errors.empty())
+                {
+                    skipped++;
+                    continue;
+                }
+                // compile() takes checked trees only, so it runs after the check.
+                auto compiler = std::make_unique<BytecodeCompiler>();
+                compiler->compile(tree.view(), tokensOfFile, names, types, folder.values());
+                if (!compiler->diagnostics().empty())
+                {
+                    skipped++;
+                    continue;
+                }
+                fileTokens.push_back(std::move(tokensOfFile));
+                fileLiterals.push_back(lexer.literals());
+                fileTrees.push_back(tree);
+                fileNames.push_back(names);
+                fileTypes.push_back(types);
+                filePrograms.push_back(std::move(compiler));
+            }
+
+            // print output is formatted but discarded: a stream without a buffer drops what it is given.
+            std::ostream discard(nullptr);
+            Interpreter interpreter;
+            TreeWalker walker;
+            size_t failures = 0;
+            bool bytecode = phase == "interpret";
+            results.push_back(measure(phase.c_str(), options, corpus.size(), [&]
+                                      {
+                                          phaseTokens = 0;
+                                          failures = 0;
+                                          for (size_t i = 0; i < fileTrees.size(); i++)
+                                          {
+                                              RunResult run = bytecode ? interpreter.run(filePrograms[i]->program(), discard)
+                                                                       : walker.run(fileTrees[i].view(), fileTokens[i], fileLiterals[i], fileNames[i], fileTypes[i], discard);
+                                              phaseTokens += fileTokens[i].size();
+                                              failures += !run.ok;
+                                          } }));
+            arena.resetTo(lexed);
+            std::cout << phase << ": " << fileTrees.size() << " files run, " << failures << " run-time errors, "
+                      << skipped << " files with errors skipped\n";
+        }
+        else if (phase == "save")
+        {
+            results.push_back(measure("save_tokens", options, corpus.size(), [&]
+                                      {
+                                          Utils::clear_file(tokensFile);
+                                          save_tokens(tokens, tokensFile); }));
+        }
+        else if (phase == "display")
+        {
+            logBool = !options.logFile.empty();
+            if (logBool)
+            {
+                Utils::setLogFilePath(options.logFile);
+            }
+            results.push_back(measure("display_tokens", options, corpus.size(), [&]
+                                      {
+                                          if (logBool)
+                                          {
+                                              Utils::clear_file(options.logFile);
+                                          }
+                                          display_tokens(tokens); }));
+            logBool = false;
+        }
+        else
+        {
+            std::cerr << "bassil-bench: unknown phase '" << phase << "'\n";
+            return 2;
+        }
+        results.back().tokens = phaseTokens;
+    }
+    std::remove(tokensFile.c_str());
+
+    std::cout << "corpus: " << corpusName << ", " << corpus.size() << " bytes, " << tokens.size() << " tokens, "
+              << diagnostics.size() << " diagnostics";
+    if (files.size() > 1)
+    {
+        std::cout << ", lexed as " << files.size() << " files";
+    }
+    std::cout << "\n";
+    if (astNodes != 0)
+    {
+        std::cout << "ast: " << astNodes << " nodes, " << astBytes << " bytes ("
+                  << std::setprecision(1) << std::fixed << static_cast<double>(astBytes) / astNodes << " bytes/node)\n";
+    }
+    std::cout << std::left << std::setw(16) << "phase" << std::right
+              << std::setw(12) << "median ms" << std::setw(12) << "MB/s" << std::setw(14) << "Mtokens/s"
+              << std::setw(14) << "allocs/rep" << std::setw(14) << "MB alloc" << std::setw(14) << "peak RSS MB" << "\n";
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto &r : results)
+    {
+        double seconds = median(r.nanoseconds) / 1e9;
+        std::cout << std::left << std::setw(16) << r.name << std::right
+                  << std::setw(12) << seconds * 1e3
+                  << std::setw(12) << (corpus.size() / (1024.0 * 1024.0)) / seconds
+                  << std::setw(14) << r.tokens / seconds / 1e6
+                  << std::setw(14) << r.allocations
+                  << std::setw(14) << r.allocatedBytes / (1024.0 * 1024.0)
+                  << std::setw(14) << r.peakRssKb / 1024.0 << "\n";
+    }
+
+    if (options.perf)
+    {
+        std::cout << "\n";
+        PerfCounters::report(std::cout);
+    }
+
+    if (!options.jsonFile.empty())
+    {
+        writeJson(options, corpusName, corpus.size(), results);
+    }
+
+    return 0;
+}
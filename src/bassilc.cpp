@@ -0,0 +1,28 @@
+/**
+ * @file bassilc.cpp
+ * @brief Entry point of the headless Bassil command line compiler.
+ *
+ * Unlike main.cpp this target has no GUI, Win32 or GLFW dependencies and
+ * runs the lex/dump pipeline directly on the files given on the command line.
+ */
+
+#include "headers/driver.h"
+#include <iostream>
+
+int main(int argc, char **argv)
+{
+    std::ios::sync_with_stdio(false);
+
+    Driver::Options options;
+    int status = Driver::parseArguments(argc, argv, options);
+    if (status != 0)
+    {
+        if (status == 2)
+        {
+            Driver::printUsage();
+        }
+        return status < 0 ? 0 : status;
+    }
+
+    return Driver::run(options);
+}
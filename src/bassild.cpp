@@ -0,0 +1,66 @@
+/**
+ * @file bassild.cpp
+ * @brief Entry point of the bassild compile server daemon.
+ *
+ * Keeps lexed sources warm in memory and serves them to bassilc (--server)
+ * and editor integrations over a Unix domain socket. See compile_server.h
+ * for the protocol.
+ */
+
+#include "headers/compile_server.h"
+#include "headers/lexer.h"
+#include "headers/utils.h"
+#include <cstring>
+#include <iostream>
+
+int main(int argc, char **argv)
+{
+    std::string socketPath = CompileServer::defaultSocketPath();
+    std::string logFile;
+    bool stop = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((std::strcmp(argv[i], "--socket") == 0 || std::strcmp(argv[i], "-s") == 0) && i + 1 < argc)
+        {
+            socketPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--log") == 0 && i + 1 < argc)
+        {
+            logFile = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--stop") == 0)
+        {
+            stop = true;
+        }
+        else
+        {
+            std::cout << "Usage: bassild [--socket <path>] [--log <file>] [--stop]\n"
+                      << "\n"
+                      << "  -s, --socket <path>  Socket to listen on (default: " << socketPath << ")\n"
+                      << "      --log <file>     Append server logs to <file>\n"
+                      << "      --stop           Ask the server listening on the socket to shut down\n";
+            return std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0 ? 0 : 2;
+        }
+    }
+
+    if (stop)
+    {
+        std::vector<std::string> payload;
+        std::string error;
+        if (!CompileServer::request(socketPath, "SHUTDOWN", payload, error))
+        {
+            std::cerr << "bassild: " << error << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    logBool = !logFile.empty();
+    if (logBool)
+    {
+        Utils::setLogFilePath(logFile);
+    }
+
+    return CompileServer::serve(socketPath);
+}
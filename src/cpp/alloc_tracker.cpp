@@ -0,0 +1,208 @@
+/**
+ * @file alloc_tracker.cpp
+ * @brief Implementation of the per-phase allocation accounting.
+ */
+
+#include "../headers/alloc_tracker.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+namespace AllocTracker
+{
+    namespace
+    {
+        // Everything here is constant-initialised so operator new works before main().
+        struct AtomicStats
+        {
+            std::atomic<std::uint64_t> allocations{0};
+            std::atomic<std::uint64_t> frees{0};
+            std::atomic<std::uint64_t> bytes{0};
+            std::atomic<std::uint64_t> live{0};
+            std::atomic<std::uint64_t> peakLive{0};
+        };
+
+        AtomicStats phaseStats[AP_Count];
+        std::atomic<std::uint64_t> totalLive{0};
+        std::atomic<std::uint64_t> totalPeakLive{0};
+        thread_local Phase threadPhase = AP_Other;
+
+        const char *const phaseNames[] = {"other", "read", "lex", "parse", "check", "run", "display", "save", "report"};
+    }
+
+    const char *phaseName(Phase phase)
+    {
+        return phase >= 0 && phase < AP_Count ? phaseNames[phase] : "unknown";
+    }
+
+    Phase currentPhase()
+    {
+        return threadPhase;
+    }
+
+    void setCurrentPhase(Phase phase)
+    {
+        threadPhase = phase;
+    }
+
+    PhaseStats stats(Phase phase)
+    {
+        PhaseStats result;
+        const AtomicStats &s = phaseStats[phase];
+        result.allocations = s.allocations.load(std::memory_order_relaxed);
+        result.frees = s.frees.load(std::memory_order_relaxed);
+        result.bytes = s.bytes.load(std::memory_order_relaxed);
+        result.live = s.live.load(std::memory_order_relaxed);
+        result.peakLive = s.peakLive.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    std::uint64_t peakLiveBytes()
+    {
+        return totalPeakLive.load(std::memory_order_relaxed);
+    }
+
+    void report(std::ostream &out)
+    {
+        if (!isCompiledIn())
+        {
+            out << "Allocation tracking is not compiled in (build with -DBASSIL_ALLOC_TRACKING)\n";
+            return;
+        }
+
+        std::ios::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+
+        out << "Heap allocations by phase\n";
+        out << std::left << std::setw(10) << "phase" << std::right
+            << std::setw(14) << "allocs" << std::setw(14) << "frees" << std::setw(14) << "MB"
+            << std::setw(14) << "peak live MB" << std::setw(14) << "live MB" << "\n";
+        out << std::fixed << std::setprecision(3);
+
+        PhaseStats total;
+        for (int p = 0; p < AP_Count; p++)
+        {
+            PhaseStats s = stats(static_cast<Phase>(p));
+            total.allocations += s.allocations;
+            total.frees += s.frees;
+            total.bytes += s.bytes;
+            total.live += s.live;
+            out << std::left << std::setw(10) << phaseNames[p] << std::right
+                << std::setw(14) << s.allocations << std::setw(14) << s.frees
+                << std::setw(14) << s.bytes / (1024.0 * 1024.0)
+                << std::setw(14) << s.peakLive / (1024.0 * 1024.0)
+                << std::setw(14) << s.live / (1024.0 * 1024.0) << "\n";
+        }
+        out << std::left << std::setw(10) << "total" << std::right
+            << std::setw(14) << total.allocations << std::setw(14) << total.frees
+            << std::setw(14) << total.bytes / (1024.0 * 1024.0)
+            << std::setw(14) << peakLiveBytes() / (1024.0 * 1024.0)
+            << std::setw(14) << total.live / (1024.0 * 1024.0) << "\n";
+
+        out.flags(flags);
+        out.precision(precision);
+    }
+}
+
+#ifdef BASSIL_ALLOC_TRACKING
+
+namespace
+{
+    using namespace AllocTracker;
+
+    void raisePeak(std::atomic<std::uint64_t> &peak, std::uint64_t value)
+    {
+        std::uint64_t current = peak.load(std::memory_order_relaxed);
+        while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    /// Prepended to every block so operator delete knows its size and phase.
+    struct alignas(alignof(std::max_align_t)) BlockHeader
+    {
+        std::uint64_t size;
+        std::uint32_t phase;
+    };
+
+    void *trackedAllocate(std::size_t size)
+    {
+        void *raw = std::malloc(sizeof(BlockHeader) + size);
+        if (!raw)
+        {
+            throw std::bad_alloc();
+        }
+
+        Phase phase = threadPhase;
+        BlockHeader *header = static_cast<BlockHeader *>(raw);
+        header->size = size;
+        header->phase = static_cast<std::uint32_t>(phase);
+
+        AtomicStats &s = phaseStats[phase];
+        s.allocations.fetch_add(1, std::memory_order_relaxed);
+        s.bytes.fetch_add(size, std::memory_order_relaxed);
+        raisePeak(s.peakLive, s.live.fetch_add(size, std::memory_order_relaxed) + size);
+        raisePeak(totalPeakLive, totalLive.fetch_add(size, std::memory_order_relaxed) + size);
+        return header + 1;
+    }
+
+    void trackedFree(void *p) noexcept
+    {
+        if (!p)
+        {
+            return;
+        }
+
+        BlockHeader *header = static_cast<BlockHeader *>(p) - 1;
+        AtomicStats &s = phaseStats[header->phase];
+        s.frees.fetch_add(1, std::memory_order_relaxed);
+        s.live.fetch_sub(header->size, std::memory_order_relaxed);
+        totalLive.fetch_sub(header->size, std::memory_order_relaxed);
+        std::free(header);
+    }
+
+    /// Prints the table once the program is done.
+    struct ExitReport
+    {
+        ExitReport()
+        {
+            std::atexit([]
+                        { report(std::cerr); });
+        }
+    } exitReport;
+}
+
+void *operator new(std::size_t size)
+{
+    return trackedAllocate(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return trackedAllocate(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    trackedFree(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    trackedFree(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    trackedFree(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    trackedFree(p);
+}
+
+#endif // BASSIL_ALLOC_TRACKING
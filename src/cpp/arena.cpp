@@ -0,0 +1,133 @@
+/**
+ * @file arena.cpp
+ * @brief Implementation of the chunked bump allocator.
+ */
+
+#include "../headers/arena.h"
+#include <algorithm>
+#include <cstdlib>
+
+CompilationArena::CompilationArena(size_t firstChunkSize)
+    : nextChunkSize(std::max<size_t>(firstChunkSize, 256))
+{
+}
+
+CompilationArena::~CompilationArena()
+{
+    release();
+}
+
+void *CompilationArena::allocateSlow(size_t bytes, size_t alignment)
+{
+    size_t needed = bytes + alignment;
+
+    // Move on to a spare chunk (kept by an earlier reset) if one is large enough.
+    size_t next = chunks.empty() ? 0 : current + 1;
+    size_t spare = next;
+    while (spare < chunks.size() && chunks[spare].size < needed)
+    {
+        spare++;
+    }
+
+    if (spare < chunks.size())
+    {
+        std::swap(chunks[next], chunks[spare]);
+    }
+    else
+    {
+        size_t size = std::max(needed, nextChunkSize);
+        nextChunkSize = std::min(nextChunkSize * 2, maxChunkSize);
+
+        char *data = static_cast<char *>(std::malloc(size));
+        if (!data)
+        {
+            throw std::bad_alloc();
+        }
+        chunks.insert(chunks.begin() + static_cast<std::ptrdiff_t>(next), Chunk{data, size});
+    }
+
+    current = next;
+    cursor = chunks[current].data;
+    limit = cursor + chunks[current].size;
+    return allocateAligned(bytes, alignment);
+}
+
+std::string_view CompilationArena::concat(std::initializer_list<std::string_view> parts)
+{
+    size_t length = 0;
+    for (std::string_view part : parts)
+    {
+        length += part.size();
+    }
+    if (length == 0)
+    {
+        return {};
+    }
+
+    char *out = static_cast<char *>(allocateAligned(length, 1));
+    char *p = out;
+    for (std::string_view part : parts)
+    {
+        std::memcpy(p, part.data(), part.size());
+        p += part.size();
+    }
+    return std::string_view(out, length);
+}
+
+void CompilationArena::registerFinalizer(void *object, void (*destroy)(void *))
+{
+    Finalizer *finalizer = static_cast<Finalizer *>(allocateAligned(sizeof(Finalizer), alignof(Finalizer)));
+    finalizer->destroy = destroy;
+    finalizer->object = object;
+    finalizer->next = finalizers;
+    finalizers = finalizer;
+}
+
+void CompilationArena::runFinalizers(void *until)
+{
+    while (finalizers && finalizers != until)
+    {
+        Finalizer *finalizer = finalizers;
+        finalizers = finalizer->next;
+        finalizer->destroy(finalizer->object);
+    }
+}
+
+void CompilationArena::resetTo(const Mark &mark)
+{
+    runFinalizers(mark.finalizers);
+    used = mark.bytesUsed;
+
+    if (chunks.empty())
+    {
+        return;
+    }
+
+    current = mark.chunk;
+    cursor = chunks[current].data + mark.offset;
+    limit = chunks[current].data + chunks[current].size;
+}
+
+void CompilationArena::release()
+{
+    runFinalizers(nullptr);
+    for (const Chunk &chunk : chunks)
+    {
+        std::free(chunk.data);
+    }
+    chunks.clear();
+    current = 0;
+    cursor = nullptr;
+    limit = nullptr;
+    used = 0;
+}
+
+size_t CompilationArena::bytesReserved() const
+{
+    size_t total = 0;
+    for (const Chunk &chunk : chunks)
+    {
+        total += chunk.size;
+    }
+    return total;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file ast.cpp
+ * @brief Implementation of the flat syntax tree helpers.
+ */
+
+#include "../headers/ast.h"
+#include <string>
+#include <utility>
+
+namespace
+{
+    const char *const nodeKindNames[] = {
+        "Program", "Function", "Parameter", "Type", "Block", "VarDecl", "If", "For", "Return",
+        "ExprStmt", "Empty", "Assign", "Binary", "Unary", "Call", "Name", "Literal", "Error"};
+
+    static_assert(sizeof(nodeKindNames) / sizeof(nodeKindNames[0]) == NK_KindCount, "one name per node kind");
+    static_assert(sizeof(NodeKind) + sizeof(std::uint32_t) + sizeof(NodeData) == 13, "a node is 13 bytes plus its extra children");
+
+    /// Kinds whose main token is worth printing in dumpAst() (names, operators, types and literals).
+    constexpr bool showsToken(NodeKind kind)
+    {
+        return kind == NK_Function || kind == NK_Parameter || kind == NK_Type || kind == NK_VarDecl ||
+               (kind >= NK_Assign && kind <= NK_Unary) || kind == NK_Name || kind == NK_Literal;
+    }
+}
+
+const char *nodeKindName(NodeKind kind)
+{
+    return kind < NK_KindCount ? nodeKindNames[kind] : "Unknown";
+}
+
+NodeIndex Ast::add(NodeKind kind, std::uint32_t token, const NodeIndex *children, std::uint32_t count)
+{
+    NodeData words = {{0, 0}};
+    switch (childLayout(kind))
+    {
+    case CL_None:
+        break;
+    case CL_One:
+        words.word[0] = children[0];
+        break;
+    case CL_Two:
+        words.word[0] = children[0];
+        words.word[1] = children[1];
+        break;
+    case CL_Extra:
+        words.word[0] = static_cast<std::uint32_t>(extra.size());
+        words.word[1] = count;
+        extra.insert(extra.end(), children, children + count);
+        break;
+    }
+
+    kinds.push_back(kind);
+    tokens.push_back(token);
+    data.push_back(words);
+    return static_cast<NodeIndex>(kinds.size() - 1);
+}
+
+void Ast::truncate(size_t nodes, size_t extraSize)
+{
+    kinds.resize(nodes);
+    tokens.resize(nodes);
+    data.resize(nodes);
+    extra.resize(extraSize);
+}
+
+void dumpAst(const AstView &tree, const std::vector<Token> &tokens, std::ostream &out)
+{
+    if (tree.empty())
+    {
+        return;
+    }
+
+    // Depth first with an explicit stack: a chain like a + b + c + ... is as deep as it is long.
+    std::vector<std::pair<NodeIndex, std::uint32_t>> pending = {{tree.root(), 0}};
+    while (!pending.empty())
+    {
+        auto [node, depth] = pending.back();
+        pending.pop_back();
+        NodeKind kind = tree.kind(node);
+        out << std::string(depth * 2, ' ') << nodeKindName(kind);
+        if (showsToken(kind) && tree.token(node) < tokens.size())
+        {
+            out << " " << tokens[tree.token(node)].value;
+        }
+        out << "\n";
+        ChildRange children = tree.children(node);
+        for (std::uint32_t i = children.size(); i > 0; i--)
+        {
+            pending.push_back({children[i - 1], depth + 1});
+        }
+    }
+}
@@ -0,0 +1,914 @@
+/**
+ * @file bytecode.cpp
+ * @brief Implementation of the bytecode compiler and disassembler.
+ */
+
+#include "../headers/bytecode.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iomanip>
+
+namespace
+{
+    constexpr std::uint32_t MaxIndex = 0xFFFF; ///< Largest 16-bit operand
+
+    const char *const opcodeNames[] = {
+#define BASSIL_OPCODE_NAME(name, operand, effect) #name,
+        BASSIL_OPCODES(BASSIL_OPCODE_NAME)
+#undef BASSIL_OPCODE_NAME
+    };
+
+    const OperandKind operandKinds[] = {
+#define BASSIL_OPCODE_OPERAND(name, operand, effect) operand,
+        BASSIL_OPCODES(BASSIL_OPCODE_OPERAND)
+#undef BASSIL_OPCODE_OPERAND
+    };
+
+    const std::int8_t stackEffects[] = {
+#define BASSIL_OPCODE_EFFECT(name, operand, effect) effect,
+        BASSIL_OPCODES(BASSIL_OPCODE_EFFECT)
+#undef BASSIL_OPCODE_EFFECT
+    };
+
+    static_assert(sizeof(opcodeNames) / sizeof(opcodeNames[0]) == OP_Count, "one name per opcode");
+
+    /// Integer and float forms of each binary operator that has both.
+    typedef struct
+    {
+        TokenKind op;
+        Opcode integer;
+        Opcode floating;
+    } BinaryOpcodes;
+
+    const BinaryOpcodes binaryOpcodes[] = {
+        {TK_Plus, OP_AddInt, OP_AddFloat},
+        {TK_Minus, OP_SubInt, OP_SubFloat},
+        {TK_Star, OP_MulInt, OP_MulFloat},
+        {TK_Slash, OP_DivInt, OP_DivFloat},
+        {TK_Percent, OP_ModInt, OP_ModInt},
+        {TK_EqualEqual, OP_EqInt, OP_EqFloat},
+        {TK_NotEqual, OP_NeInt, OP_NeFloat},
+        {TK_Less, OP_LtInt, OP_LtFloat},
+        {TK_LessEqual, OP_LeInt, OP_LeFloat},
+        {TK_Greater, OP_GtInt, OP_GtFloat},
+        {TK_GreaterEqual, OP_GeInt, OP_GeFloat},
+    };
+
+    std::uint32_t readOperand(const std::uint8_t *p, size_t size)
+    {
+        std::uint32_t value = 0;
+        if (size == 2)
+        {
+            std::uint16_t narrow;
+            std::memcpy(&narrow, p, sizeof(narrow));
+            value = narrow;
+        }
+        else
+        {
+            std::memcpy(&value, p, sizeof(value));
+        }
+        return value;
+    }
+
+    size_t operandSize(OperandKind kind)
+    {
+        switch (kind)
+        {
+        case OK_None:
+            return 0;
+        case OK_Int8:
+            return 1;
+        case OK_Jump:
+            return 4;
+        case OK_SlotInt8:
+            return 3;
+        case OK_Int8Jump:
+            return 5;
+        default:
+            return 2;
+        }
+    }
+
+    void appendEncoded(std::string &out, std::int64_t code)
+    {
+        std::uint32_t c = code < 0 || code > 0x10FFFF ? 0xFFFD : static_cast<std::uint32_t>(code);
+        if (c < 0x80)
+        {
+            out += static_cast<char>(c);
+        }
+        else if (c < 0x800)
+        {
+            out += static_cast<char>(0xC0 | (c >> 6));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        }
+        else if (c < 0x10000)
+        {
+            out += static_cast<char>(0xE0 | (c >> 12));
+            out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        }
+        else
+        {
+            out += static_cast<char>(0xF0 | (c >> 18));
+            out += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        }
+    }
+
+    void writeQuoted(std::ostream &out, const std::string &text)
+    {
+        out << '"';
+        for (char c : text)
+        {
+            switch (c)
+            {
+            case '\n':
+                out << "\\n";
+                break;
+            case '\t':
+                out << "\\t";
+                break;
+            case '\r':
+                out << "\\r";
+                break;
+            case '"':
+                out << "\\\"";
+                break;
+            case '\\':
+                out << "\\\\";
+                break;
+            default:
+                out << c;
+                break;
+            }
+        }
+        out << '"';
+    }
+}
+
+const char *opcodeName(Opcode op)
+{
+    return op < OP_Count ? opcodeNames[op] : "unknown";
+}
+
+OperandKind operandKind(Opcode op)
+{
+    return op < OP_Count ? operandKinds[op] : OK_None;
+}
+
+void appendValue(std::string &out, Value value, TypeId type)
+{
+    char buffer[32];
+    switch (type)
+    {
+    case TypeFloat:
+        // The shortest digits that read back as the same double.
+        out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value.floating).ptr);
+        break;
+    case TypeChar:
+        appendEncoded(out, value.integer);
+        break;
+    case TypeBool:
+        out += value.integer ? "true" : "false";
+        break;
+    case TypeString:
+        out += *value.string;
+        break;
+    default:
+        out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value.integer).ptr);
+        break;
+    }
+}
+
+void decodeStringLiteral(std::string_view token, std::string &out)
+{
+    if (token.size() >= 2 && token.front() == '"' && token.back() == '"')
+    {
+        token = token.substr(1, token.size() - 2);
+    }
+    for (size_t i = 0; i < token.size(); i++)
+    {
+        if (token[i] != '\\' || i + 1 == token.size())
+        {
+            out += token[i];
+            continue;
+        }
+        switch (token[++i])
+        {
+        case 'n':
+            out += '\n';
+            break;
+        case 't':
+            out += '\t';
+            break;
+        case 'r':
+            out += '\r';
+            break;
+        case '0':
+            out += '\0';
+            break;
+        case '\\':
+        case '\'':
+        case '"':
+            out += token[i];
+            break;
+        default:
+            out += '\\';
+            out += token[i];
+            break;
+        }
+    }
+}
+
+void disassemble(const Program &program, std::ostream &out)
+{
+    for (size_t index = 0; index < program.functions.size(); index++)
+    {
+        const BytecodeFunction &function = program.functions[index];
+        out << "function " << index << " " << function.name << ": " << function.parameterCount << " parameters, "
+            << function.frameSize << " slots, stack " << function.maxStack << ", " << function.code.size() << " bytes\n";
+        for (size_t k = 0; k < function.constants.size(); k++)
+        {
+            out << "  constant " << k << ": ";
+            if (function.constantTypes[k] == TypeString)
+            {
+                writeQuoted(out, *function.constants[k].string);
+            }
+            else
+            {
+                std::string text;
+                appendValue(text, function.constants[k], function.constantTypes[k]);
+                out << text;
+            }
+            out << "\n";
+        }
+
+        const std::uint8_t *code = function.code.data();
+        for (size_t offset = 0; offset < function.code.size();)
+        {
+            Opcode op = static_cast<Opcode>(code[offset]);
+            out << "  " << std::setw(6) << offset << "  " << opcodeName(op);
+            OperandKind kind = operandKind(op);
+            size_t size = operandSize(kind);
+            if (offset + 1 + size > function.code.size())
+            {
+                out << " <truncated>\n";
+                break;
+            }
+            if (kind == OK_Int8 || kind == OK_Int8Jump)
+            {
+                out << " " << static_cast<int>(static_cast<std::int8_t>(code[offset + 1]));
+                if (kind == OK_Int8Jump)
+                {
+                    out << " " << readOperand(code + offset + 2, 4);
+                }
+            }
+            else if (kind == OK_SlotInt8)
+            {
+                out << " " << readOperand(code + offset + 1, 2) << " " << static_cast<int>(static_cast<std::int8_t>(code[offset + 3]));
+            }
+            else if (kind != OK_None)
+            {
+                out << " " << readOperand(code + offset + 1, size);
+            }
+            out << "\n";
+            offset += 1 + size;
+        }
+    }
+}
+
+const Program &BytecodeCompiler::compile(const AstView &input, const std::vector<Token> &inputTokens, const Resolution &names,
+                                         const std::vector<TypeId> &nodeTypes, const std::vector<ConstantValue> &nodeValues)
+{
+    tree = input;
+    tokens = &inputTokens;
+    resolution = &names;
+    types = &nodeTypes;
+    values = &nodeValues;
+    diagnosticBuffer.clear();
+    result.strings.clear();
+    result.globalCount = resolution->globalCount;
+
+    // Function n is frame n of the resolution; the functions keep their buffers from the last file.
+    result.functions.resize(resolution->frameSizes.size());
+    for (BytecodeFunction &function : result.functions)
+    {
+        function.code.clear();
+        function.constants.clear();
+        function.constantTypes.clear();
+        function.positions.clear();
+        function.parameterCount = 0;
+        function.maxStack = 0;
+    }
+
+    current = &result.functions[0];
+    current->name = "<top level>";
+    current->frameSize = resolution->frameSizes[0];
+    returnType = TypeVoid;
+    depth = 0;
+    lastOp = previousOp = OP_Count;
+    labelled = 0;
+    integerConstants.clear();
+    floatConstants.clear();
+
+    // A tree with errors must not get this far, but an unbound name would index symbols with NoBinding.
+    for (NodeIndex node = 0; node < tree.size(); node++)
+    {
+        NodeKind kind = tree.kind(node);
+        if ((kind == NK_Name || kind == NK_VarDecl) && resolution->bindings[node] == NoBinding)
+        {
+            report(tree.token(node), "Unresolved name; only checked trees can be compiled");
+        }
+    }
+    if (!diagnosticBuffer.empty())
+    {
+        result.functions.clear();
+        return result;
+    }
+
+    if (!tree.empty())
+    {
+        for (NodeIndex item : tree.children(tree.root()))
+        {
+            if (tree.kind(item) != NK_Function)
+            {
+                statement(item);
+            }
+        }
+    }
+    emit(OP_Halt);
+
+    if (!tree.empty())
+    {
+        std::uint32_t index = 1;
+        for (NodeIndex item : tree.children(tree.root()))
+        {
+            if (tree.kind(item) == NK_Function)
+            {
+                function(item, index++);
+            }
+        }
+    }
+
+    if (!diagnosticBuffer.empty())
+    {
+        result.functions.clear();
+        std::sort(diagnosticBuffer.begin(), diagnosticBuffer.end(), [](const Diagnostic &a, const Diagnostic &b)
+                  { return a.line != b.line ? a.line < b.line : a.start_column < b.start_column; });
+    }
+    return result;
+}
+
+void BytecodeCompiler::function(NodeIndex node, std::uint32_t index)
+{
+    // Children: return type, parameters..., body. Parameters are the first frame slots.
+    ChildRange children = tree.children(node);
+    current = &result.functions[index];
+    current->name = (*tokens)[tree.token(node)].value;
+    current->parameterCount = children.size() - 2;
+    current->frameSize = resolution->frameSizes[index];
+    returnType = (*types)[children[0]];
+    depth = 0;
+    lastOp = previousOp = OP_Count;
+    labelled = 0;
+    integerConstants.clear();
+    floatConstants.clear();
+
+    for (NodeIndex child : tree.children(children[children.size() - 1]))
+    {
+        statement(child);
+    }
+    if (returnType == TypeVoid)
+    {
+        emit(OP_ReturnVoid);
+    }
+    else
+    {
+        position(tree.token(node));
+        emit(OP_NoReturn);
+    }
+}
+
+void BytecodeCompiler::statement(NodeIndex node)
+{
+    ChildRange children = tree.children(node);
+    switch (tree.kind(node))
+    {
+    case NK_VarDecl:
+        // A constant local is never read (its uses are constants too), so it needs no slot. A constant
+        // global is still stored: a function called before its declaration reads it.
+        if ((*values)[node].known && resolution->symbols[resolution->bindings[node]].kind == SK_Local)
+        {
+            break;
+        }
+        if (children.size() > 1)
+        {
+            expressionAs(children[1], (*types)[node]);
+        }
+        else
+        {
+            // Declared without a value: zero, the empty string, false.
+            constant(node, ConstantValue{true, {0}}, (*types)[node]);
+        }
+        variable(OP_StoreGlobal, OP_StoreLocal, node);
+        break;
+    case NK_If:
+    {
+        ConstantValue condition = (*values)[children[0]];
+        if (condition.known)
+        {
+            if (condition.integer)
+            {
+                statement(children[1]);
+            }
+            else if (children.size() > 2)
+            {
+                statement(children[2]);
+            }
+            break;
+        }
+        expression(children[0]);
+        std::uint32_t skip = emitJump(OP_JumpIfFalse);
+        statement(children[1]);
+        if (children.size() > 2)
+        {
+            std::uint32_t end = emitJump(OP_Jump);
+            patch(skip, here());
+            statement(children[2]);
+            patch(end, here());
+        }
+        else
+        {
+            patch(skip, here());
+        }
+        break;
+    }
+    case NK_For:
+    {
+        // init; jump test; top: body; step; test: condition; jump-if-true top
+        if (tree.kind(children[0]) == NK_VarDecl)
+        {
+            statement(children[0]);
+        }
+        else
+        {
+            discarded(children[0]);
+        }
+        NodeIndex condition = children[1];
+        bool forever = tree.kind(condition) == NK_Empty || ((*values)[condition].known && (*values)[condition].integer);
+        if (!forever && (*values)[condition].known)
+        {
+            break;
+        }
+        std::uint32_t entry = forever ? 0 : emitJump(OP_Jump);
+        std::uint32_t top = here();
+        statement(children[3]);
+        discarded(children[2]);
+        if (forever)
+        {
+            patch(emitJump(OP_Jump), top);
+            break;
+        }
+        patch(entry, here());
+        expression(condition);
+        patch(emitJump(OP_JumpIfTrue), top);
+        break;
+    }
+    case NK_Block:
+        for (NodeIndex child : children)
+        {
+            statement(child);
+        }
+        break;
+    case NK_Return:
+        if (children.size() > 0)
+        {
+            expressionAs(children[0], returnType);
+            emit(OP_Return);
+        }
+        else
+        {
+            emit(current == &result.functions[0] ? OP_Halt : OP_ReturnVoid);
+        }
+        break;
+    case NK_ExprStmt:
+        discarded(children[0]);
+        break;
+    default:
+        break;
+    }
+}
+
+void BytecodeCompiler::discarded(NodeIndex node)
+{
+    // An expression statement: evaluated for its effects only.
+    if (tree.kind(node) == NK_Empty || (*values)[node].known)
+    {
+        return;
+    }
+    if (tree.kind(node) == NK_Assign && emitIncLocal(node))
+    {
+        return;
+    }
+    if (tree.kind(node) == NK_Assign)
+    {
+        ChildRange children = tree.children(node);
+        expressionAs(children[1], (*types)[children[0]]);
+        variable(OP_StoreGlobal, OP_StoreLocal, children[0]);
+        return;
+    }
+    expression(node);
+    if ((*types)[node] != TypeVoid)
+    {
+        emit(OP_Pop);
+    }
+}
+
+void BytecodeCompiler::expression(NodeIndex node)
+{
+    ConstantValue value = (*values)[node];
+    if (value.known)
+    {
+        constant(node, value, (*types)[node]);
+        return;
+    }
+
+    ChildRange children = tree.children(node);
+    switch (tree.kind(node))
+    {
+    case NK_Literal:
+        // Numbers and bools are always known; this is a string.
+        constant(node, value, TypeString);
+        break;
+    case NK_Name:
+        variable(OP_LoadGlobal, OP_LoadLocal, node);
+        break;
+    case NK_Assign:
+        expressionAs(children[1], (*types)[children[0]]);
+        emit(OP_Dup);
+        variable(OP_StoreGlobal, OP_StoreLocal, children[0]);
+        break;
+    case NK_Unary:
+        expression(children[0]);
+        if ((*tokens)[tree.token(node)].type == TK_Not)
+        {
+            emit(OP_Not);
+        }
+        else
+        {
+            emit((*types)[children[0]] == TypeFloat ? OP_NegFloat : OP_NegInt);
+        }
+        break;
+    case NK_Binary:
+        binary(node);
+        break;
+    case NK_Call:
+        call(node);
+        break;
+    default:
+        break;
+    }
+}
+
+void BytecodeCompiler::expressionAs(NodeIndex node, TypeId to)
+{
+    // Only widening to float changes the representation (see type_checker.h).
+    bool widen = to == TypeFloat && (*types)[node] != TypeFloat;
+    ConstantValue value = (*values)[node];
+    if (widen && value.known)
+    {
+        value.floating = static_cast<double>(value.integer);
+        constant(node, value, TypeFloat);
+        return;
+    }
+    expression(node);
+    if (widen)
+    {
+        emit(OP_IntToFloat);
+    }
+}
+
+void BytecodeCompiler::binary(NodeIndex node)
+{
+    // A chain like a + b + c + ... is as deep as it is long, so the left operands are not compiled by
+    // recursion: the innermost one first, then each operator up the chain with its right operand.
+    size_t bottom = chain.size();
+    chain.push_back(node);
+    NodeIndex left = tree.children(node)[0];
+    while (tree.kind(left) == NK_Binary && !(*values)[left].known)
+    {
+        chain.push_back(left);
+        left = tree.children(left)[0];
+    }
+
+    NodeIndex innermost = chain.back();
+    TokenKind op = (*tokens)[tree.token(innermost)].type;
+    NodeIndex right = tree.children(innermost)[1];
+    if (op == TK_AndAnd || op == TK_OrOr)
+    {
+        // A known left operand that does not decide (the folder took the others) leaves the right one.
+        if (!(*values)[left].known)
+        {
+            expression(left);
+        }
+    }
+    else if ((*types)[left] == TypeString)
+    {
+        expression(left);
+    }
+    else
+    {
+        // One float operand makes both floats; bools and chars compare as ints.
+        bool floating = (*types)[left] == TypeFloat || (*types)[right] == TypeFloat;
+        expressionAs(left, floating ? TypeFloat : (*types)[left]);
+    }
+
+    binaryOperator(innermost, true);
+    chain.pop_back();
+    while (chain.size() > bottom)
+    {
+        binaryOperator(chain.back(), false);
+        chain.pop_back();
+    }
+}
+
+void BytecodeCompiler::binaryOperator(NodeIndex node, bool leftConverted)
+{
+    // The left operand is on the stack, as compiled by expression(), or by expressionAs() if leftConverted.
+    NodeIndex left = tree.children(node)[0];
+    NodeIndex right = tree.children(node)[1];
+    TokenKind op = (*tokens)[tree.token(node)].type;
+
+    if (op == TK_AndAnd || op == TK_OrOr)
+    {
+        if ((*values)[left].known)
+        {
+            expression(right);
+            return;
+        }
+        std::uint32_t end = emitJump(op == TK_AndAnd ? OP_AndJump : OP_OrJump);
+        expression(right);
+        patch(end, here());
+        return;
+    }
+
+    if ((*types)[left] == TypeString)
+    {
+        expression(right);
+        emit(op == TK_EqualEqual ? OP_EqString : OP_NeString);
+        return;
+    }
+
+    bool floating = (*types)[left] == TypeFloat || (*types)[right] == TypeFloat;
+    if (floating && !leftConverted && (*types)[left] != TypeFloat)
+    {
+        emit(OP_IntToFloat);
+    }
+    expressionAs(right, floating ? TypeFloat : (*types)[right]);
+    for (const BinaryOpcodes &entry : binaryOpcodes)
+    {
+        if (entry.op == op)
+        {
+            if (entry.integer == OP_DivInt || entry.integer == OP_ModInt)
+            {
+                position(tree.token(node));
+            }
+            if (floating || !emitAddInt8(entry.integer))
+            {
+                emit(floating ? entry.floating : entry.integer);
+            }
+            return;
+        }
+    }
+}
+
+void BytecodeCompiler::call(NodeIndex node)
+{
+    ChildRange children = tree.children(node);
+    const SymbolInfo &callee = resolution->symbols[resolution->bindings[children[0]]];
+    if (callee.kind == SK_Builtin)
+    {
+        // print(value), the only builtin: one instruction per argument type.
+        NodeIndex argument = children[1];
+        expression(argument);
+        switch ((*types)[argument])
+        {
+        case TypeFloat:
+            emit(OP_PrintFloat);
+            break;
+        case TypeChar:
+            emit(OP_PrintChar);
+            break;
+        case TypeBool:
+            emit(OP_PrintBool);
+            break;
+        case TypeString:
+            emit(OP_PrintString);
+            break;
+        default:
+            emit(OP_PrintInt);
+            break;
+        }
+        return;
+    }
+
+    ChildRange parameters = tree.children(callee.declaration);
+    for (std::uint32_t i = 1; i < children.size(); i++)
+    {
+        expressionAs(children[i], (*types)[parameters[i]]);
+    }
+    position(tree.token(node));
+    emit(OP_Call);
+    emitOperand(callee.slot, tree.token(node), "Too many functions for the bytecode format (at most 65536)");
+    depth -= static_cast<std::int32_t>(children.size() - 1);
+    if ((*types)[node] != TypeVoid)
+    {
+        depth++;
+        current->maxStack = std::max(current->maxStack, static_cast<std::uint32_t>(depth));
+    }
+}
+
+void BytecodeCompiler::constant(NodeIndex node, ConstantValue value, TypeId type)
+{
+    if (type != TypeFloat && type != TypeString && value.integer >= INT8_MIN && value.integer <= INT8_MAX)
+    {
+        emit(OP_Int8);
+        current->code.push_back(static_cast<std::uint8_t>(static_cast<std::int8_t>(value.integer)));
+        return;
+    }
+
+    Value pooled;
+    std::uint32_t slot = static_cast<std::uint32_t>(current->constants.size());
+    if (type == TypeString)
+    {
+        // Each literal is its own constant; a declaration without a value gets "".
+        result.strings.emplace_back();
+        if (tree.kind(node) == NK_Literal)
+        {
+            decodeStringLiteral((*tokens)[tree.token(node)].value, result.strings.back());
+        }
+        pooled.string = &result.strings.back();
+    }
+    else
+    {
+        std::uint64_t bits;
+        if (type == TypeFloat)
+        {
+            pooled.floating = value.floating;
+            std::memcpy(&bits, &value.floating, sizeof(bits));
+        }
+        else
+        {
+            pooled.integer = value.integer;
+            bits = static_cast<std::uint64_t>(value.integer);
+        }
+        auto found = (type == TypeFloat ? floatConstants : integerConstants).try_emplace(bits, static_cast<std::uint16_t>(slot));
+        if (!found.second)
+        {
+            slot = found.first->second;
+        }
+    }
+
+    if (slot == current->constants.size())
+    {
+        current->constants.push_back(pooled);
+        current->constantTypes.push_back(type == TypeFloat || type == TypeString ? type : TypeInt);
+    }
+    emit(OP_Const);
+    emitOperand(slot, tree.token(node), "Too many constants in one function for the bytecode format (at most 65536)");
+}
+
+void BytecodeCompiler::variable(Opcode globalOp, Opcode localOp, NodeIndex name)
+{
+    const SymbolInfo &symbol = resolution->symbols[resolution->bindings[name]];
+    emit(symbol.kind == SK_Global ? globalOp : localOp);
+    emitOperand(symbol.slot, tree.token(name), "Too many variables for the bytecode format (at most 65536)");
+}
+
+void BytecodeCompiler::emit(Opcode op)
+{
+    previousOp = lastOp;
+    previousOffset = lastOffset;
+    lastOp = op;
+    lastOffset = here();
+    current->code.push_back(op);
+    depth += stackEffects[op];
+    current->maxStack = std::max(current->maxStack, static_cast<std::uint32_t>(std::max(depth, 0)));
+}
+
+void BytecodeCompiler::emitOperand(std::uint32_t value, std::uint32_t token, const char *tooLarge)
+{
+    if (value > MaxIndex)
+    {
+        report(token, tooLarge);
+    }
+    std::uint16_t operand = static_cast<std::uint16_t>(value);
+    std::uint8_t bytes[sizeof(operand)];
+    std::memcpy(bytes, &operand, sizeof(operand));
+    current->code.insert(current->code.end(), bytes, bytes + sizeof(bytes));
+}
+
+std::uint32_t BytecodeCompiler::emitJump(Opcode op)
+{
+    // An int comparison followed by a conditional jump becomes one compare-and-jump;
+    // jumping if it is false is jumping if the opposite comparison holds.
+    static const Opcode ifTrue[] = {OP_JumpIfEqInt, OP_JumpIfNeInt, OP_JumpIfLtInt, OP_JumpIfLeInt, OP_JumpIfGtInt, OP_JumpIfGeInt};
+    static const Opcode ifFalse[] = {OP_JumpIfNeInt, OP_JumpIfEqInt, OP_JumpIfGeInt, OP_JumpIfGtInt, OP_JumpIfLeInt, OP_JumpIfLtInt};
+    if ((op == OP_JumpIfTrue || op == OP_JumpIfFalse) && lastOp >= OP_EqInt && lastOp <= OP_GeInt && fusible(1))
+    {
+        Opcode compare = lastOp;
+        current->code.pop_back();
+        depth -= stackEffects[compare];
+        op = (op == OP_JumpIfTrue ? ifTrue : ifFalse)[compare - OP_EqInt];
+
+        // Comparing with a small constant: the constant becomes an operand too.
+        if (previousOp == OP_Int8 && previousOffset + 2 == here() && labelled != here())
+        {
+            std::uint8_t k = current->code.back();
+            current->code.resize(previousOffset);
+            depth -= stackEffects[OP_Int8];
+            emit(static_cast<Opcode>(op - OP_JumpIfEqInt + OP_JumpIfEqInt8));
+            current->code.push_back(k);
+            std::uint32_t operand = here();
+            current->code.resize(current->code.size() + sizeof(std::uint32_t));
+            return operand;
+        }
+    }
+    emit(op);
+    std::uint32_t operand = here();
+    current->code.resize(current->code.size() + sizeof(std::uint32_t));
+    return operand;
+}
+
+bool BytecodeCompiler::emitAddInt8(Opcode op)
+{
+    // x + k and x - k with a small constant k: the OP_Int8 just emitted becomes the operand.
+    if ((op != OP_AddInt && op != OP_SubInt) || lastOp != OP_Int8 || !fusible(2))
+    {
+        return false;
+    }
+    std::int8_t k = static_cast<std::int8_t>(current->code.back());
+    if (op == OP_SubInt && k == INT8_MIN)
+    {
+        return false;
+    }
+    current->code.resize(lastOffset);
+    depth -= stackEffects[OP_Int8];
+    emit(OP_AddInt8);
+    current->code.push_back(static_cast<std::uint8_t>(op == OP_SubInt ? -k : k));
+    return true;
+}
+
+bool BytecodeCompiler::emitIncLocal(NodeIndex assign)
+{
+    // x = x + k or x = x - k, x an int local and k a small constant.
+    NodeIndex target = tree.children(assign)[0];
+    NodeIndex value = tree.children(assign)[1];
+    const SymbolInfo &symbol = resolution->symbols[resolution->bindings[target]];
+    if (symbol.kind != SK_Local || (*types)[target] != TypeInt || tree.kind(value) != NK_Binary || (*values)[value].known)
+    {
+        return false;
+    }
+    NodeIndex left = tree.children(value)[0];
+    NodeIndex right = tree.children(value)[1];
+    TokenKind op = (*tokens)[tree.token(value)].type;
+    ConstantValue k = (*values)[right];
+    if ((op != TK_Plus && op != TK_Minus) || tree.kind(left) != NK_Name || resolution->bindings[left] != resolution->bindings[target] ||
+        !k.known || (*types)[right] == TypeFloat || k.integer <= INT8_MIN || k.integer > INT8_MAX)
+    {
+        return false;
+    }
+    emit(OP_IncLocal);
+    emitOperand(symbol.slot, tree.token(target), "Too many variables for the bytecode format (at most 65536)");
+    current->code.push_back(static_cast<std::uint8_t>(static_cast<std::int8_t>(op == TK_Minus ? -k.integer : k.integer)));
+    return true;
+}
+
+bool BytecodeCompiler::fusible(std::uint32_t size) const
+{
+    // The last instruction (of @p size bytes) ends the code, and no jump lands right after it.
+    return lastOffset + size == here() && labelled != here();
+}
+
+void BytecodeCompiler::patch(std::uint32_t jump, std::uint32_t target)
+{
+    if (target == here())
+    {
+        labelled = target;
+    }
+    std::memcpy(current->code.data() + jump, &target, sizeof(target));
+}
+
+void BytecodeCompiler::position(std::uint32_t token)
+{
+    const Token &at = (*tokens)[token];
+    current->positions.push_back({here(), at.line, at.start_column, at.end_column});
+}
+
+void BytecodeCompiler::report(std::uint32_t token, std::string_view message)
+{
+    const Token &at = (*tokens)[token];
+    diagnosticBuffer.push_back({at.line, at.start_column, at.end_column, message});
+}
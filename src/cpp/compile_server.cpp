@@ -0,0 +1,433 @@
+/**
+ * @file compile_server.cpp
+ * @brief Implementation of the bassild compile server and client.
+ */
+
+#include "../headers/compile_server.h"
+#include "../headers/utils.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <csignal>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace CompileServer
+{
+    std::string defaultSocketPath()
+    {
+        const char *runtimeDir = std::getenv("XDG_RUNTIME_DIR");
+        if (runtimeDir && *runtimeDir)
+        {
+            return std::string(runtimeDir) + "/bassild.sock";
+        }
+#ifndef _WIN32
+        return "/tmp/bassild-" + std::to_string(getuid()) + ".sock";
+#else
+        return "bassild.sock";
+#endif
+    }
+
+    /**
+     * @brief Formats an "OK <n>" response from its payload lines.
+     * @param lines The payload lines.
+     * @return std::string The response.
+     */
+    static std::string okResponse(const std::vector<std::string> &lines)
+    {
+        std::string response = "OK " + std::to_string(lines.size()) + "\n";
+        for (const auto &line : lines)
+        {
+            response += line;
+            response += '\n';
+        }
+        return response;
+    }
+
+    std::string handleRequest(SourceCache &cache, const std::string &request, bool &shutdown)
+    {
+        size_t space = request.find(' ');
+        std::string command = request.substr(0, space);
+        std::string argument = space == std::string::npos ? "" : request.substr(space + 1);
+
+        if (command == "STATS")
+        {
+            SourceCacheStats stats = cache.stats();
+            return okResponse({"files=" + std::to_string(cache.size()) +
+                               " hits=" + std::to_string(stats.hits) +
+                               " rehashed=" + std::to_string(stats.rehashed) +
+                               " relexed=" + std::to_string(stats.relexed) +
+                               " failures=" + std::to_string(stats.failures)});
+        }
+        if (command == "SHUTDOWN")
+        {
+            shutdown = true;
+            return okResponse({});
+        }
+        if (argument.empty())
+        {
+            return "ERR missing argument\n";
+        }
+        if (command == "INVALIDATE")
+        {
+            cache.invalidate(argument);
+            return okResponse({});
+        }
+
+        int lineNumber = 0;
+        if (command == "LINE")
+        {
+            size_t lastSpace = argument.rfind(' ');
+            if (lastSpace == std::string::npos)
+            {
+                return "ERR missing line number\n";
+            }
+            lineNumber = std::atoi(argument.c_str() + lastSpace + 1);
+            argument.resize(lastSpace);
+        }
+        else if (command != "CHECK" && command != "LEX")
+        {
+            return "ERR unknown command '" + command + "'\n";
+        }
+
+        std::shared_ptr<const CachedSource> source = cache.get(argument);
+        if (!source)
+        {
+            return "ERR cannot read " + argument + "\n";
+        }
+
+        std::vector<std::string> lines;
+        if (command == "CHECK")
+        {
+            lines.reserve(source->diagnostics.size());
+            for (const auto &diagnostic : source->diagnostics)
+            {
+                lines.push_back(source->path + ":" + std::to_string(diagnostic.line) + ":" +
+                                std::to_string(diagnostic.start_column) + ": error: " + std::string(diagnostic.message));
+            }
+        }
+        else if (command == "LEX")
+        {
+            lines.reserve(source->tokens.size());
+            for (const auto &token : source->tokens)
+            {
+                lines.push_back(std::to_string(token.line) + " " + std::to_string(token.start_column) + " " +
+                                std::to_string(token.end_column) + " " + std::to_string(static_cast<int>(token.type)) +
+                                " \"" + Utils::escapeJson(token.value) + "\"");
+            }
+        }
+        else
+        {
+            if (lineNumber < 1 || static_cast<size_t>(lineNumber) > source->lineOffsets.size())
+            {
+                return "ERR line out of range\n";
+            }
+            lines.emplace_back(source->lineText(lineNumber));
+        }
+
+        return okResponse(lines);
+    }
+
+#ifndef _WIN32
+#ifdef MSG_NOSIGNAL
+    constexpr int SendFlags = MSG_NOSIGNAL; ///< A closed peer is an error from send(), not SIGPIPE
+#else
+    constexpr int SendFlags = 0; ///< SO_NOSIGPIPE is set on the socket instead (see openSocket())
+#endif
+
+    /**
+     * @brief Creates a Unix stream socket that is closed on exec.
+     *
+     * Plain POSIX calls: SOCK_CLOEXEC and accept4() are not available everywhere.
+     *
+     * @return int The socket, or -1 with errno set.
+     */
+    static int openSocket()
+    {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0)
+        {
+            ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+            int on = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        }
+        return fd;
+    }
+
+    /**
+     * @brief Writes a whole buffer to a socket.
+     * @param fd The socket.
+     * @param data The bytes to send.
+     * @return bool True if everything was written.
+     */
+    static bool sendAll(int fd, const std::string &data)
+    {
+        size_t sent = 0;
+        while (sent < data.size())
+        {
+            ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, SendFlags);
+            if (n <= 0)
+            {
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Reads one newline-terminated line from a socket.
+     *
+     * @param fd The socket.
+     * @param buffer Bytes received but not consumed yet; kept between calls.
+     * @param line Receives the line without the newline.
+     * @return bool False on EOF or error.
+     */
+    static bool receiveLine(int fd, std::string &buffer, std::string &line)
+    {
+        while (true)
+        {
+            size_t newline = buffer.find('\n');
+            if (newline != std::string::npos)
+            {
+                line.assign(buffer, 0, newline);
+                buffer.erase(0, newline + 1);
+                return true;
+            }
+
+            char chunk[4096];
+            ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0)
+            {
+                return false;
+            }
+            buffer.append(chunk, static_cast<size_t>(n));
+        }
+    }
+
+    /**
+     * @brief Fills in a sockaddr_un for a path.
+     * @param socketPath The socket path.
+     * @param address Receives the address.
+     * @return bool False if the path is too long for sun_path.
+     */
+    static bool makeAddress(const std::string &socketPath, sockaddr_un &address)
+    {
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path))
+        {
+            return false;
+        }
+        std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+        return true;
+    }
+
+    int serve(const std::string &socketPath)
+    {
+        sockaddr_un address;
+        if (!makeAddress(socketPath, address))
+        {
+            std::cerr << "bassild: socket path too long: " << socketPath << "\n";
+            return 1;
+        }
+
+        // Never take the path from a running server, nor remove anything but a stale socket.
+        struct stat status;
+        if (::lstat(socketPath.c_str(), &status) == 0)
+        {
+            if (!S_ISSOCK(status.st_mode))
+            {
+                std::cerr << "bassild: " << socketPath << " exists and is not a socket\n";
+                return 1;
+            }
+            int probe = openSocket();
+            bool live = probe >= 0 && ::connect(probe, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+            if (probe >= 0)
+            {
+                ::close(probe);
+            }
+            if (live)
+            {
+                std::cerr << "bassild: a server is already listening on " << socketPath << "\n";
+                return 1;
+            }
+            ::unlink(socketPath.c_str());
+        }
+
+        int listenFd = openSocket();
+        if (listenFd < 0)
+        {
+            std::cerr << "bassild: socket: " << std::strerror(errno) << "\n";
+            return 1;
+        }
+
+        mode_t previousMask = ::umask(0077); // Socket is only reachable by the owner
+        int bound = ::bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+        ::umask(previousMask);
+        if (bound < 0 || ::listen(listenFd, 64) < 0)
+        {
+            std::cerr << "bassild: cannot listen on " << socketPath << ": " << std::strerror(errno) << "\n";
+            ::close(listenFd);
+            return 1;
+        }
+
+        std::signal(SIGPIPE, SIG_IGN);
+
+        // Connection threads are detached, so their state is shared; serve() waits for the last one to
+        // remove its socket from `open` before it returns.
+        struct Connections
+        {
+            SourceCache cache;
+            std::atomic<bool> stopping{false};
+            std::mutex mutex;
+            std::condition_variable finished;
+            std::vector<int> open; ///< Client sockets being served
+        };
+        auto connections = std::make_shared<Connections>();
+
+        Utils::general_log("[bassild] Listening on " + socketPath, logBool);
+
+        while (!connections->stopping.load())
+        {
+            int clientFd = ::accept(listenFd, nullptr, nullptr);
+            if (clientFd < 0)
+            {
+                if (errno == EINTR || errno == ECONNABORTED)
+                {
+                    continue;
+                }
+                break;
+            }
+            ::fcntl(clientFd, F_SETFD, FD_CLOEXEC);
+            {
+                std::lock_guard<std::mutex> lock(connections->mutex);
+                connections->open.push_back(clientFd);
+            }
+
+            std::thread([clientFd, connections, listenFd]
+                        {
+                            std::string buffer;
+                            std::string line;
+                            while (receiveLine(clientFd, buffer, line))
+                            {
+                                bool shutdown = false;
+                                if (!sendAll(clientFd, handleRequest(connections->cache, line, shutdown)))
+                                {
+                                    break;
+                                }
+                                if (shutdown)
+                                {
+                                    connections->stopping.store(true);
+                                    ::shutdown(listenFd, SHUT_RDWR); // Wakes up the blocking accept()
+                                    break;
+                                }
+                            }
+                            // Closed under the lock, so serve() never shuts down a reused descriptor.
+                            std::lock_guard<std::mutex> lock(connections->mutex);
+                            ::close(clientFd);
+                            connections->open.erase(std::find(connections->open.begin(), connections->open.end(), clientFd));
+                            connections->finished.notify_all(); })
+                .detach();
+        }
+
+        {
+            // Idle clients would keep their threads in recv(): end their connections, then wait.
+            std::unique_lock<std::mutex> lock(connections->mutex);
+            for (int clientFd : connections->open)
+            {
+                ::shutdown(clientFd, SHUT_RDWR);
+            }
+            connections->finished.wait(lock, [&]
+                                       { return connections->open.empty(); });
+        }
+
+        ::close(listenFd);
+        ::unlink(socketPath.c_str());
+        Utils::general_log("[bassild] Shut down", logBool);
+        return 0;
+    }
+
+    bool request(const std::string &socketPath, const std::string &request, std::vector<std::string> &payload, std::string &error)
+    {
+        payload.clear();
+
+        sockaddr_un address;
+        if (!makeAddress(socketPath, address))
+        {
+            error = "socket path too long";
+            return false;
+        }
+
+        int fd = openSocket();
+        if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+        {
+            error = "cannot connect to " + socketPath + ": " + std::strerror(errno);
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+            return false;
+        }
+
+        std::string buffer;
+        std::string line;
+        bool ok = false;
+        if (!sendAll(fd, request + "\n") || !receiveLine(fd, buffer, line))
+        {
+            error = "connection to server lost";
+        }
+        else if (line.rfind("OK ", 0) == 0)
+        {
+            size_t count = std::strtoul(line.c_str() + 3, nullptr, 10);
+            payload.reserve(count);
+            ok = true;
+            for (size_t i = 0; i < count; i++)
+            {
+                if (!receiveLine(fd, buffer, line))
+                {
+                    error = "truncated response";
+                    ok = false;
+                    break;
+                }
+                payload.push_back(line);
+            }
+        }
+        else
+        {
+            error = line.rfind("ERR ", 0) == 0 ? line.substr(4) : "malformed response";
+        }
+
+        ::close(fd);
+        return ok;
+    }
+#else
+    int serve(const std::string &socketPath)
+    {
+        std::cerr << "bassild: the compile server is not supported on Windows (" << socketPath << ")\n";
+        return 1;
+    }
+
+    bool request(const std::string &socketPath, const std::string &request, std::vector<std::string> &payload, std::string &error)
+    {
+        payload.clear();
+        error = "the compile server is not supported on Windows";
+        return false;
+    }
+#endif
+}
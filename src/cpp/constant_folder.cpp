@@ -0,0 +1,304 @@
+/**
+ * @file constant_folder.cpp
+ * @brief Implementation of constant folding and propagation.
+ */
+
+#include "../headers/constant_folder.h"
+#include <algorithm>
+
+namespace
+{
+    constexpr ConstantValue Unknown = {false, {0}};
+
+    ConstantValue integerValue(std::int64_t value)
+    {
+        ConstantValue constant = {true, {0}};
+        constant.integer = value;
+        return constant;
+    }
+
+    ConstantValue floatValue(double value)
+    {
+        ConstantValue constant = {true, {0}};
+        constant.floating = value;
+        return constant;
+    }
+
+    /// Wrapping arithmetic: computed on the unsigned representation, which has no overflow.
+    std::int64_t wrap(std::uint64_t value)
+    {
+        return static_cast<std::int64_t>(value);
+    }
+}
+
+const std::vector<ConstantValue> &ConstantFolder::fold(const AstView &input, const std::vector<Token> &inputTokens, const std::vector<NumericLiteral> &inputLiterals,
+                                                       const Resolution &names, const std::vector<TypeId> &nodeTypes)
+{
+    tree = input;
+    tokens = &inputTokens;
+    literals = &inputLiterals;
+    resolution = &names;
+    types = &nodeTypes;
+    nodeValues.assign(tree.size(), Unknown);
+    diagnosticBuffer.clear();
+    folded = 0;
+
+    // A variable that is assigned anywhere is not constant anywhere, even before the assignment.
+    assigned.assign(resolution->symbols.size(), false);
+    for (NodeIndex node = 0; node < tree.size(); node++)
+    {
+        if (tree.kind(node) == NK_Assign)
+        {
+            std::uint32_t target = resolution->bindings[tree.children(node)[0]];
+            if (target != NoBinding)
+            {
+                assigned[target] = true;
+            }
+        }
+    }
+
+    // Functions may be called before a global's declaration has run, and then see it zero. Only the
+    // globals declared before the first top-level statement or call keep their value inside functions.
+    setBeforeCalls.assign(resolution->symbols.size(), false);
+    NodeIndex first = 0;
+    for (NodeIndex item : tree.children(tree.root()))
+    {
+        if (tree.kind(item) == NK_VarDecl)
+        {
+            bool calls = false;
+            for (NodeIndex node = first; node < item && !calls; node++)
+            {
+                calls = tree.kind(node) == NK_Call;
+            }
+            if (calls)
+            {
+                break;
+            }
+            if (resolution->bindings[item] != NoBinding)
+            {
+                setBeforeCalls[resolution->bindings[item]] = true;
+            }
+        }
+        else if (tree.kind(item) != NK_Function)
+        {
+            break;
+        }
+        first = item + 1;
+    }
+
+    // The nodes of each item form one range, in item order, before the root.
+    first = 0;
+    for (NodeIndex item : tree.children(tree.root()))
+    {
+        inFunction = tree.kind(item) == NK_Function;
+        for (NodeIndex node = first; node <= item; node++)
+        {
+            nodeValues[node] = valueOf(node);
+        }
+        first = item + 1;
+    }
+    inFunction = false;
+    for (NodeIndex node = first; node < tree.size(); node++)
+    {
+        nodeValues[node] = valueOf(node);
+    }
+
+    // Operators are reported after their operands, which may start later on the line.
+    std::sort(diagnosticBuffer.begin(), diagnosticBuffer.end(), [](const Diagnostic &a, const Diagnostic &b)
+              { return a.line != b.line ? a.line < b.line : a.start_column < b.start_column; });
+    return nodeValues;
+}
+
+ConstantValue ConstantFolder::valueOf(NodeIndex node)
+{
+    if ((*types)[node] == TypeError)
+    {
+        return Unknown;
+    }
+
+    ChildRange children = tree.children(node);
+    const Token &token = (*tokens)[tree.token(node)];
+    switch (tree.kind(node))
+    {
+    case NK_Literal:
+        switch (token.type)
+        {
+        case TK_Integer:
+        case TK_Char:
+            return token.literal != 0 && (*literals)[token.literal - 1].valid ? integerValue((*literals)[token.literal - 1].integer) : Unknown;
+        case TK_Float:
+            return token.literal != 0 && (*literals)[token.literal - 1].valid ? floatValue((*literals)[token.literal - 1].floating) : Unknown;
+        case TK_True:
+            return integerValue(1);
+        case TK_False:
+            return integerValue(0);
+        default:
+            return Unknown;
+        }
+    case NK_Name:
+    {
+        // The declaration holds the variable's value once, converted to the declared type.
+        std::uint32_t symbol = resolution->bindings[node];
+        if (symbol == NoBinding || assigned[symbol])
+        {
+            return Unknown;
+        }
+        const SymbolInfo &info = resolution->symbols[symbol];
+        if ((info.kind != SK_Global && info.kind != SK_Local) || tree.kind(info.declaration) != NK_VarDecl ||
+            (info.kind == SK_Global && inFunction && !setBeforeCalls[symbol]))
+        {
+            return Unknown;
+        }
+        folded += nodeValues[info.declaration].known;
+        return nodeValues[info.declaration];
+    }
+    case NK_VarDecl:
+    {
+        std::uint32_t symbol = resolution->bindings[node];
+        if (children.size() < 2 || symbol == NoBinding || assigned[symbol] || !nodeValues[children[1]].known)
+        {
+            return Unknown;
+        }
+        return convert(children[1], (*types)[node]);
+    }
+    case NK_Unary:
+    {
+        ConstantValue value = unary(node);
+        folded += value.known;
+        return value;
+    }
+    case NK_Binary:
+    {
+        ConstantValue value = binary(node);
+        folded += value.known;
+        return value;
+    }
+    default:
+        return Unknown;
+    }
+}
+
+ConstantValue ConstantFolder::binary(NodeIndex node)
+{
+    NodeIndex leftNode = tree.children(node)[0];
+    NodeIndex rightNode = tree.children(node)[1];
+    ConstantValue left = nodeValues[leftNode];
+    ConstantValue right = nodeValues[rightNode];
+    TokenKind op = (*tokens)[tree.token(node)].type;
+
+    // The right operand of && and || is not evaluated when the left one decides.
+    if (op == TK_AndAnd || op == TK_OrOr)
+    {
+        if (left.known && (left.integer != 0) == (op == TK_OrOr))
+        {
+            return left;
+        }
+        return left.known ? right : Unknown;
+    }
+
+    bool integerResult = (*types)[node] == TypeInt;
+    if (integerResult && (op == TK_Slash || op == TK_Percent) && right.known && right.integer == 0)
+    {
+        report(tree.token(node), op == TK_Slash ? "Division by zero" : "Remainder of division by zero");
+        return Unknown;
+    }
+    if (!left.known || !right.known)
+    {
+        return Unknown;
+    }
+
+    // Strings are never known, so the operands are numbers or bools; one float makes both floats.
+    bool floating = (*types)[leftNode] == TypeFloat || (*types)[rightNode] == TypeFloat;
+    if (floating)
+    {
+        double a = convert(leftNode, TypeFloat).floating;
+        double b = convert(rightNode, TypeFloat).floating;
+        switch (op)
+        {
+        case TK_Plus:
+            return floatValue(a + b);
+        case TK_Minus:
+            return floatValue(a - b);
+        case TK_Star:
+            return floatValue(a * b);
+        case TK_Slash:
+            return floatValue(a / b);
+        case TK_EqualEqual:
+            return integerValue(a == b);
+        case TK_NotEqual:
+            return integerValue(a != b);
+        case TK_Less:
+            return integerValue(a < b);
+        case TK_Greater:
+            return integerValue(a > b);
+        case TK_LessEqual:
+            return integerValue(a <= b);
+        case TK_GreaterEqual:
+            return integerValue(a >= b);
+        default:
+            return Unknown;
+        }
+    }
+
+    std::int64_t a = left.integer;
+    std::int64_t b = right.integer;
+    switch (op)
+    {
+    case TK_Plus:
+        return integerValue(wrap(static_cast<std::uint64_t>(a) + static_cast<std::uint64_t>(b)));
+    case TK_Minus:
+        return integerValue(wrap(static_cast<std::uint64_t>(a) - static_cast<std::uint64_t>(b)));
+    case TK_Star:
+        return integerValue(wrap(static_cast<std::uint64_t>(a) * static_cast<std::uint64_t>(b)));
+    case TK_Slash:
+        return integerValue(b == -1 ? wrap(0 - static_cast<std::uint64_t>(a)) : a / b);
+    case TK_Percent:
+        return integerValue(b == -1 ? 0 : a % b);
+    case TK_EqualEqual:
+        return integerValue(a == b);
+    case TK_NotEqual:
+        return integerValue(a != b);
+    case TK_Less:
+        return integerValue(a < b);
+    case TK_Greater:
+        return integerValue(a > b);
+    case TK_LessEqual:
+        return integerValue(a <= b);
+    case TK_GreaterEqual:
+        return integerValue(a >= b);
+    default:
+        return Unknown;
+    }
+}
+
+ConstantValue ConstantFolder::unary(NodeIndex node)
+{
+    NodeIndex operand = tree.children(node)[0];
+    ConstantValue value = nodeValues[operand];
+    if (!value.known)
+    {
+        return Unknown;
+    }
+    if ((*tokens)[tree.token(node)].type == TK_Not)
+    {
+        return integerValue(value.integer == 0);
+    }
+    return (*types)[operand] == TypeFloat ? floatValue(-value.floating) : integerValue(wrap(0 - static_cast<std::uint64_t>(value.integer)));
+}
+
+ConstantValue ConstantFolder::convert(NodeIndex node, TypeId to) const
+{
+    // Only widening to float changes the representation (see type_checker.h).
+    ConstantValue value = nodeValues[node];
+    if (to == TypeFloat && (*types)[node] != TypeFloat)
+    {
+        return floatValue(static_cast<double>(value.integer));
+    }
+    return value;
+}
+
+void ConstantFolder::report(std::uint32_t token, std::string_view message)
+{
+    const Token &at = (*tokens)[token];
+    diagnosticBuffer.push_back({at.line, at.start_column, at.end_column, message});
+}
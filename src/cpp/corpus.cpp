@@ -0,0 +1,481 @@
+/**
+ * @file corpus.cpp
+ * @brief Implementation of the synthetic Bassil corpus generator.
+ */
+
+#include "../headers/corpus.h"
+#include <cctype>
+#include <cstdlib>
+#include <vector>
+
+namespace Corpus
+{
+    namespace
+    {
+        enum StatementKind
+        {
+            SK_Declaration,
+            SK_Assignment,
+            SK_If,
+            SK_For,
+            SK_Function,
+            SK_Print,
+            SK_LineComment,
+            SK_BlockComment,
+            SK_StringDeclaration,
+            SK_Count
+        };
+
+        /// Relative statement frequencies per mix, indexed by StatementKind.
+        const unsigned statementWeights[][SK_Count] = {
+            /* Balanced    */ {20, 15, 8, 6, 4, 10, 10, 3, 10},
+            /* Identifiers */ {45, 40, 0, 0, 0, 15, 0, 0, 0},
+            /* Strings     */ {0, 0, 0, 0, 0, 20, 0, 0, 80},
+            /* Comments    */ {5, 5, 0, 0, 0, 0, 60, 30, 0},
+            /* Operators   */ {25, 55, 20, 0, 0, 0, 0, 0, 0},
+        };
+
+        const char *const words[] = {
+            "value", "count", "index", "result", "total", "buffer", "offset", "length",
+            "factor", "node", "left", "right", "sum", "limit", "score", "item",
+            "greeting", "pi", "temp", "flag", "delta", "state", "entry", "cursor"};
+
+        const char *const sentenceWords[] = {
+            "the", "lexer", "should", "handle", "this", "input", "quickly", "and", "report",
+            "every", "error", "with", "a", "clear", "message", "for", "each", "line", "of", "code"};
+
+        const char *const binaryOperators[] = {"+", "-", "*", "/", "%"};
+        const char *const comparisonOperators[] = {"==", "!=", "<", ">", "<=", ">="};
+        const char *const logicalOperators[] = {"&&", "||"};
+        const char *const typeNames[] = {"int", "float", "char", "string"};
+
+        template <typename T, size_t N>
+        constexpr size_t countOf(const T (&)[N]) { return N; }
+
+        class Generator
+        {
+        public:
+            explicit Generator(const Options &options)
+                : state(options.seed * 0x9E3779B97F4A7C15ull + 0x2545F4914F6CDD1Dull), mix(options.mix)
+            {
+                // Identifier pool: short names reused constantly plus longer compound names.
+                names = {"x", "i", "n", "a", "b", "print", "factorial"};
+                size_t poolSize = mix == Mix::Identifiers ? 512 : 128;
+                while (names.size() < poolSize)
+                {
+                    std::string name = pick(words);
+                    unsigned parts = 1 + below(mix == Mix::Identifiers ? 4 : 2);
+                    for (unsigned p = 0; p < parts; p++)
+                    {
+                        std::string word = pick(words);
+                        if (below(2) == 0)
+                        {
+                            word[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(word[0])));
+                            name += word;
+                        }
+                        else
+                        {
+                            name += "_" + word;
+                        }
+                    }
+                    if (below(4) == 0)
+                    {
+                        name += std::to_string(below(100));
+                    }
+                    names.push_back(name);
+                }
+            }
+
+            /**
+             * @brief Appends one top-level statement to the output.
+             * @param out The output buffer.
+             */
+            void statement(std::string &out)
+            {
+                statementOfKind(out, chooseKind(), 0);
+            }
+
+        private:
+            std::uint64_t next()
+            {
+                // xorshift64*
+                state ^= state >> 12;
+                state ^= state << 25;
+                state ^= state >> 27;
+                return state * 2685821657736338717ull;
+            }
+
+            unsigned below(unsigned n)
+            {
+                return static_cast<unsigned>((next() >> 32) % n);
+            }
+
+            template <size_t N>
+            const char *pick(const char *const (&items)[N])
+            {
+                return items[below(static_cast<unsigned>(N))];
+            }
+
+            const std::string &name()
+            {
+                // Skew towards the front of the pool so short names repeat, like real code.
+                unsigned r = below(static_cast<unsigned>(names.size()));
+                return names[below(2) == 0 ? r / 8 : r];
+            }
+
+            StatementKind chooseKind()
+            {
+                const unsigned *weights = statementWeights[static_cast<int>(mix)];
+                unsigned total = 0;
+                for (int k = 0; k < SK_Count; k++)
+                {
+                    total += weights[k];
+                }
+                unsigned roll = below(total);
+                for (int k = 0; k < SK_Count; k++)
+                {
+                    if (roll < weights[k])
+                    {
+                        return static_cast<StatementKind>(k);
+                    }
+                    roll -= weights[k];
+                }
+                return SK_Declaration;
+            }
+
+            void indent(std::string &out, int depth)
+            {
+                out.append(static_cast<size_t>(depth) * 4, ' ');
+            }
+
+            void number(std::string &out)
+            {
+                if (below(3) == 0)
+                {
+                    out += std::to_string(below(1000));
+                    out += '.';
+                    out += std::to_string(below(100000));
+                }
+                else
+                {
+                    out += std::to_string(below(4) == 0 ? below(1000000) : below(100));
+                }
+            }
+
+            void sentence(std::string &out, unsigned wordCount)
+            {
+                for (unsigned w = 0; w < wordCount; w++)
+                {
+                    if (w != 0)
+                    {
+                        out += ' ';
+                    }
+                    out += pick(sentenceWords);
+                }
+            }
+
+            void stringLiteral(std::string &out)
+            {
+                out += '"';
+                sentence(out, 2 + below(mix == Mix::Strings ? 14 : 6));
+                if (below(3) == 0)
+                {
+                    out += below(2) == 0 ? " \\\"quoted\\\"" : "\\n\\t";
+                }
+                out += '"';
+            }
+
+            void operand(std::string &out)
+            {
+                unsigned identifierWeight = mix == Mix::Identifiers ? 9 : 6;
+                unsigned roll = below(10);
+                if (roll < identifierWeight)
+                {
+                    out += name();
+                }
+                else if (mix != Mix::Identifiers && roll == 9 && below(4) == 0)
+                {
+                    out += name();
+                    out += '(';
+                    out += name();
+                    out += ')';
+                }
+                else
+                {
+                    number(out);
+                }
+            }
+
+            void expression(std::string &out, int depth)
+            {
+                unsigned terms = 1 + below(mix == Mix::Operators ? 6 : 3);
+                for (unsigned t = 0; t < terms; t++)
+                {
+                    if (t != 0)
+                    {
+                        out += ' ';
+                        out += pick(binaryOperators);
+                        out += ' ';
+                    }
+                    if (depth < 3 && below(mix == Mix::Operators ? 3 : 8) == 0)
+                    {
+                        out += '(';
+                        expression(out, depth + 1);
+                        out += ')';
+                    }
+                    else
+                    {
+                        operand(out);
+                    }
+                }
+            }
+
+            void condition(std::string &out)
+            {
+                unsigned clauses = 1 + below(mix == Mix::Operators ? 4 : 2);
+                for (unsigned c = 0; c < clauses; c++)
+                {
+                    if (c != 0)
+                    {
+                        out += ' ';
+                        out += pick(logicalOperators);
+                        out += ' ';
+                    }
+                    if (below(6) == 0)
+                    {
+                        out += '!';
+                    }
+                    out += '(';
+                    expression(out, 2);
+                    out += ' ';
+                    out += pick(comparisonOperators);
+                    out += ' ';
+                    expression(out, 2);
+                    out += ')';
+                }
+            }
+
+            void block(std::string &out, int depth)
+            {
+                out += "{\n";
+                unsigned count = 1 + below(4);
+                for (unsigned s = 0; s < count; s++)
+                {
+                    StatementKind kind = chooseKind();
+                    if (kind == SK_Function || (depth >= 3 && (kind == SK_If || kind == SK_For)))
+                    {
+                        kind = SK_Assignment;
+                    }
+                    statementOfKind(out, kind, depth + 1);
+                }
+                indent(out, depth);
+                out += "}\n";
+            }
+
+            void statementOfKind(std::string &out, StatementKind kind, int depth)
+            {
+                indent(out, depth);
+                switch (kind)
+                {
+                case SK_Declaration:
+                {
+                    const char *type = pick(typeNames);
+                    out += type;
+                    out += ' ';
+                    out += name();
+                    out += " = ";
+                    if (type[0] == 's')
+                    {
+                        stringLiteral(out);
+                    }
+                    else if (type[0] == 'c')
+                    {
+                        out += '\'';
+                        out += static_cast<char>('A' + below(26));
+                        out += '\'';
+                    }
+                    else
+                    {
+                        expression(out, 0);
+                    }
+                    out += ";\n";
+                    break;
+                }
+                case SK_Assignment:
+                    out += name();
+                    out += " = ";
+                    expression(out, 0);
+                    out += ";\n";
+                    break;
+                case SK_If:
+                    out += "if (";
+                    condition(out);
+                    out += ") ";
+                    block(out, depth);
+                    if (below(2) == 0)
+                    {
+                        indent(out, depth);
+                        out += "else ";
+                        block(out, depth);
+                    }
+                    break;
+                case SK_For:
+                {
+                    const std::string &counter = name();
+                    out += "for (int " + counter + " = 0; " + counter + " < ";
+                    operand(out);
+                    out += "; " + counter + " = " + counter + " + 1) ";
+                    block(out, depth);
+                    break;
+                }
+                case SK_Function:
+                    out += "function int ";
+                    out += name();
+                    out += "(int ";
+                    out += name();
+                    out += ", float ";
+                    out += name();
+                    out += ") ";
+                    block(out, depth);
+                    break;
+                case SK_Print:
+                    out += "print(";
+                    if (mix == Mix::Strings || below(2) == 0)
+                    {
+                        stringLiteral(out);
+                    }
+                    else
+                    {
+                        expression(out, 1);
+                    }
+                    out += ");\n";
+                    break;
+                case SK_LineComment:
+                    out += "// ";
+                    sentence(out, 4 + below(12));
+                    out += '\n';
+                    break;
+                case SK_BlockComment:
+                {
+                    out += "/* ";
+                    unsigned lines = 1 + below(4);
+                    for (unsigned l = 0; l < lines; l++)
+                    {
+                        if (l != 0)
+                        {
+                            out += "\n   ";
+                        }
+                        sentence(out, 4 + below(10));
+                    }
+                    out += " */\n";
+                    break;
+                }
+                case SK_StringDeclaration:
+                    out += "string ";
+                    out += name();
+                    out += " = ";
+                    stringLiteral(out);
+                    out += ";\n";
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            std::uint64_t state;
+            Mix mix;
+            std::vector<std::string> names;
+        };
+
+        const char *const mixNames[] = {"balanced", "identifiers", "strings", "comments", "operators"};
+    }
+
+    bool parseMix(const std::string &name, Mix &mix)
+    {
+        for (size_t i = 0; i < countOf(mixNames); i++)
+        {
+            if (name == mixNames[i])
+            {
+                mix = static_cast<Mix>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const char *mixName(Mix mix)
+    {
+        return mixNames[static_cast<int>(mix)];
+    }
+
+    bool parseSize(const std::string &text, std::uint64_t &bytes)
+    {
+        char *end = nullptr;
+        double value = std::strtod(text.c_str(), &end);
+        if (end == text.c_str() || value < 0)
+        {
+            return false;
+        }
+
+        std::string suffix(end);
+        for (auto &c : suffix)
+        {
+            c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        }
+
+        double multiplier = 1;
+        if (suffix.empty() || suffix == "B")
+        {
+            multiplier = 1;
+        }
+        else if (suffix == "K" || suffix == "KB")
+        {
+            multiplier = 1024.0;
+        }
+        else if (suffix == "M" || suffix == "MB")
+        {
+            multiplier = 1024.0 * 1024.0;
+        }
+        else if (suffix == "G" || suffix == "GB")
+        {
+            multiplier = 1024.0 * 1024.0 * 1024.0;
+        }
+        else
+        {
+            return false;
+        }
+
+        bytes = static_cast<std::uint64_t>(value * multiplier);
+        return true;
+    }
+
+    std::string generate(const Options &options)
+    {
+        Generator generator(options);
+        std::string out;
+        out.reserve(static_cast<size_t>(options.bytes) + 1024);
+        while (out.size() < options.bytes)
+        {
+            generator.statement(out);
+        }
+        return out;
+    }
+
+    void generate(const Options &options, std::ostream &out)
+    {
+        Generator generator(options);
+        std::string chunk;
+        chunk.reserve(80 * 1024);
+        std::uint64_t written = 0;
+        while (written < options.bytes)
+        {
+            generator.statement(chunk);
+            if (chunk.size() >= 64 * 1024 || written + chunk.size() >= options.bytes)
+            {
+                out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+                written += chunk.size();
+                chunk.clear();
+            }
+        }
+    }
+}
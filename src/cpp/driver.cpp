@@ -0,0 +1,718 @@
+/**
+ * @file driver.cpp
+ * @brief Implementation of the headless compilation driver.
+ */
+
+#include "../headers/driver.h"
+#include "../headers/bytecode.h"
+#include "../headers/compile_server.h"
+#include "../headers/interpreter.h"
+#include "../headers/lexer.h"
+#include "../headers/parse_cache.h"
+#include "../headers/parser.h"
+#include "../headers/constant_folder.h"
+#include "../headers/thread_pool.h"
+#include "../headers/alloc_tracker.h"
+#include "../headers/perf_counters.h"
+#include "../headers/trace.h"
+#include "../headers/utils.h"
+#include "../headers/watch.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace Driver
+{
+    namespace
+    {
+        /// A single input at least this large is parsed on a thread pool (about Parser::ParallelMinTokens tokens).
+        constexpr std::uintmax_t ParallelParseBytes = 512 * 1024;
+
+        // Like the lexer and parser, one of each semantic pass per worker.
+        thread_local Resolver resolver;
+        thread_local TypeChecker checker;
+        thread_local ConstantFolder folder;
+    }
+
+    void checkTree(const AstView &tree, const std::vector<Token> &tokens, const std::vector<NumericLiteral> &literals,
+                   size_t bytes, CompilationArena &arena, std::vector<Diagnostic> &diagnostics)
+    {
+        {
+            BASSIL_PERF_REGION("resolve", bytes);
+            BASSIL_ALLOC_PHASE(AllocTracker::AP_Check);
+            resolver.resolve(tree, tokens, arena);
+            mergeDiagnostics(diagnostics, resolver.diagnostics());
+        }
+        {
+            BASSIL_PERF_REGION("typecheck", bytes);
+            BASSIL_ALLOC_PHASE(AllocTracker::AP_Check);
+            checker.check(tree, tokens, resolver.resolution(), arena);
+            mergeDiagnostics(diagnostics, checker.diagnostics());
+        }
+        {
+            BASSIL_PERF_REGION("fold", bytes);
+            BASSIL_ALLOC_PHASE(AllocTracker::AP_Check);
+            folder.fold(tree, tokens, literals, resolver.resolution(), checker.types());
+            mergeDiagnostics(diagnostics, folder.diagnostics());
+        }
+    }
+
+    namespace
+    {
+        /**
+         * @brief Compiles a checked file without errors to bytecode and dumps and/or runs it, or runs its tree.
+         *
+         * @param tree The file's syntax tree, just passed to checkTree().
+         * @param tokens Its tokens.
+         * @param literals Their decoded literals.
+         * @param bytes Size of the source, for the perf regions.
+         * @param options The driver options.
+         * @param result Receives the listing, the output and a run-time error.
+         */
+        void runTree(const AstView &tree, const std::vector<Token> &tokens, const std::vector<NumericLiteral> &literals,
+                     size_t bytes, const Options &options, FileResult &result)
+        {
+            // The tree-walker needs no bytecode, nor is it held to the format's limits.
+            static thread_local BytecodeCompiler compiler;
+            if (options.dumpBytecode || (options.run && !options.treeWalk))
+            {
+                BASSIL_PERF_REGION("codegen", bytes);
+                BASSIL_ALLOC_PHASE(AllocTracker::AP_Run);
+                compiler.compile(tree, tokens, resolver.resolution(), checker.types(), folder.values());
+                mergeDiagnostics(result.diagnostics, compiler.diagnostics());
+            }
+            if (!result.diagnostics.empty())
+            {
+                return;
+            }
+            if (options.dumpBytecode)
+            {
+                std::ostringstream out;
+                disassemble(compiler.program(), out);
+                result.bytecode = out.str();
+            }
+            if (!options.run && !options.treeWalk)
+            {
+                return;
+            }
+
+            BASSIL_TRACE_SCOPE("run");
+            BASSIL_PERF_REGION("run", bytes);
+            BASSIL_ALLOC_PHASE(AllocTracker::AP_Run);
+            std::ostringstream out;
+            RunResult run;
+            if (options.treeWalk)
+            {
+                static thread_local TreeWalker walker;
+                run = walker.run(tree, tokens, literals, resolver.resolution(), checker.types(), out);
+            }
+            else
+            {
+                static thread_local Interpreter interpreter;
+                run = interpreter.run(compiler.program(), out);
+            }
+            result.output = out.str();
+            if (!run.ok)
+            {
+                result.diagnostics.push_back(run.error);
+            }
+        }
+    }
+
+    void printUsage()
+    {
+        std::cout << "Usage: bassilc [options] <file|directory>...\n"
+                  << "\n"
+                  << "Options:\n"
+                  << "  -o, --emit-tokens <dir>  Write the tokens of each file as JSON into <dir>\n"
+                  << "      --log <file>         Append lexer/driver logs to <file> (off by default)\n"
+                  << "      --display-tokens     Log every token (requires --log)\n"
+                  << "      --dump-ast           Print the syntax tree of each file\n"
+                  << "      --dump-bytecode      Print the bytecode of each file without errors\n"
+                  << "      --run                Compile each file without errors to bytecode and run it\n"
+                  << "      --run-tree           Like --run, with the (slow) reference tree-walking interpreter\n"
+                  << "  -j, --jobs <n>           Compile with <n> worker threads (default: one per core)\n"
+                  << "      --server             Ask a running bassild for diagnostics instead of lexing\n"
+                  << "      --server-socket <p>  Like --server, using the bassild listening on socket <p>\n"
+                  << "  -w, --watch              Keep running and re-lex files when they change\n"
+                  << "      --debounce-ms <n>    Quiet period ending a burst of changes (default: 5)\n"
+                  << "      --trace <file>       Write a Chrome/Perfetto trace of every phase to <file>\n"
+                  << "      --perf               Print cycles, IPC and cache misses per phase (Linux perf)\n"
+                  << "      --columns <unit>     Count columns in 'chars' (UTF-8 characters, default) or 'bytes'\n"
+                  << "      --cache-dir <dir>    Reuse the tokens and syntax trees of unchanged files from <dir>\n"
+                  << "  -q, --quiet              Only print errors\n"
+                  << "  -h, --help               Show this help\n";
+    }
+
+    int parseArguments(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const char *arg = argv[i];
+
+            auto requireValue = [&](const char *flag) -> const char *
+            {
+                if (i + 1 >= argc)
+                {
+                    std::cerr << "bassilc: missing value for " << flag << "\n";
+                    return nullptr;
+                }
+                return argv[++i];
+            };
+
+            if (std::strcmp(arg, "-h") == 0 || std::strcmp(arg, "--help") == 0)
+            {
+                printUsage();
+                return -1;
+            }
+            else if (std::strcmp(arg, "-o") == 0 || std::strcmp(arg, "--emit-tokens") == 0)
+            {
+                const char *value = requireValue(arg);
+                if (!value)
+                {
+                    return 2;
+                }
+                options.tokensOutputDir = value;
+            }
+            else if (std::strcmp(arg, "--log") == 0)
+            {
+                const char *value = requireValue(arg);
+                if (!value)
+                {
+                    return 2;
+                }
+                options.logFile = value;
+            }
+            else if (std::strcmp(arg, "-j") == 0 || std::strcmp(arg, "--jobs") == 0)
+            {
+                const char *value = requireValue(arg);
+                if (!value)
+                {
+                    return 2;
+                }
+                char *end = nullptr;
+                long jobs = std::strtol(value, &end, 10);
+                if (*end != '\0' || jobs < 0)
+                {
+                    std::cerr << "bassilc: invalid job count '" << value << "'\n";
+                    return 2;
+                }
+                options.jobs = static_cast<unsigned>(jobs);
+            }
+            else if (std::strcmp(arg, "--server") == 0)
+            {
+                options.serverSocket = CompileServer::defaultSocketPath();
+            }
+            else if (std::strcmp(arg, "--server-socket") == 0)
+            {
+                const char *value = requireValue(arg);
+                if (!value)
+                {
+                    return 2;
+                }
+                options.serverSocket = value;
+            }
+            else if (std::strcmp(arg, "-w") == 0 || std::strcmp(arg, "--watch") == 0)
+            {
+                options.watch = true;
+            }
+            else if (std::strcmp(arg, "--debounce-ms") == 0)
+            {
+                const char *value = requireValue(arg);
+                if (!value)
+                {
+                    return 2;
+                }
+                // poll() takes the delay as an int; more than a minute is a typo.
+                char *end = nullptr;
+                long debounce = std::strtol(value, &end, 10);
+                if (end == value || *end != '\0' || debounce < 0 || debounce > 60000)
+                {
+                    std::cerr << "bassilc: invalid debounce delay '" << value << "' (0 to 60000 ms)\n";
+                    return 2;
+                }
+                options.debounceMs = static_cast<unsigned>(debounce);
+            }
+            else if (std::strcmp(arg, "--trace") == 0)
+            {
+                const char *value = requireValue(arg);
+                if (!value)
+                {
+                    return 2;
+                }
+                options.traceFile = value;
+            }
+            else if (std::strcmp(arg, "--perf") == 0)
+            {
+                options.perfCounters = true;
+            }
+            else if (std::strcmp(arg, "--columns") == 0)
+            {
+                const char *value = requireValue(arg);
+                if (!value)
+                {
+                    return 2;
+                }
+                if (std::strcmp(value, "chars") == 0)
+                {
+                    options.columnMode = CM_Codepoints;
+                }
+                else if (std::strcmp(value, "bytes") == 0)
+                {
+                    options.columnMode = CM_Bytes;
+                }
+                else
+                {
+                    std::cerr << "bassilc: --columns must be 'chars' or 'bytes'\n";
+                    return 2;
+                }
+            }
+            else if (std::strcmp(arg, "--cache-dir") == 0)
+            {
+                const char *value = requireValue(arg);
+                if (!value)
+                {
+                    return 2;
+                }
+                options.cacheDir = value;
+            }
+            else if (std::strcmp(arg, "--display-tokens") == 0)
+            {
+                options.displayTokens = true;
+            }
+            else if (std::strcmp(arg, "--dump-ast") == 0)
+            {
+                options.dumpAst = true;
+            }
+            else if (std::strcmp(arg, "--dump-bytecode") == 0)
+            {
+                options.dumpBytecode = true;
+            }
+            else if (std::strcmp(arg, "--run") == 0)
+            {
+                options.run = true;
+            }
+            else if (std::strcmp(arg, "--run-tree") == 0)
+            {
+                options.treeWalk = true;
+            }
+            else if (std::strcmp(arg, "-q") == 0 || std::strcmp(arg, "--quiet") == 0)
+            {
+                options.quiet = true;
+            }
+            else if (arg[0] == '-' && arg[1] != '\0')
+            {
+                std::cerr << "bassilc: unknown option '" << arg << "'\n";
+                return 2;
+            }
+            else
+            {
+                options.inputs.push_back(arg);
+            }
+        }
+
+        if (options.inputs.empty())
+        {
+            std::cerr << "bassilc: no input files\n";
+            return 2;
+        }
+
+        return 0;
+    }
+
+    std::vector<SourceFile> collectSources(const std::vector<std::string> &inputs)
+    {
+        std::vector<SourceFile> sources;
+
+        for (const auto &input : inputs)
+        {
+            std::error_code ec;
+            fs::file_status status = fs::status(input, ec);
+
+            if (ec || !fs::exists(status))
+            {
+                throw std::runtime_error("[collectSources] No such file or directory: " + input);
+            }
+
+            if (fs::is_directory(status))
+            {
+                std::vector<SourceFile> found;
+                for (const auto &entry : fs::recursive_directory_iterator(input, fs::directory_options::skip_permission_denied))
+                {
+                    if (entry.is_regular_file() && entry.path().extension() == ".basl")
+                    {
+                        found.push_back({entry.path().string(), fs::relative(entry.path(), input).string(), entry.file_size()});
+                    }
+                }
+                std::sort(found.begin(), found.end(), [](const SourceFile &a, const SourceFile &b)
+                          { return a.path < b.path; });
+                sources.insert(sources.end(), found.begin(), found.end());
+            }
+            else
+            {
+                sources.push_back({input, fs::path(input).filename().string(), fs::file_size(input, ec)});
+            }
+        }
+
+        return sources;
+    }
+
+    FileResult compileFile(const SourceFile &source, const Options &options, ThreadPool *pool)
+    {
+        BASSIL_TRACE_SCOPE_ARG("compileFile", source.path);
+        FileResult result;
+
+        std::string inputContent;
+        try
+        {
+            BASSIL_TRACE_SCOPE("read");
+            BASSIL_PERF_REGION("read", source.size);
+            BASSIL_ALLOC_PHASE(AllocTracker::AP_Read);
+            inputContent = Utils::readFileToString(source.path);
+        }
+        catch (const std::exception &e)
+        {
+            result.error = "unable to read file";
+            return result;
+        }
+
+        std::uint64_t contentHash = 0;
+        std::vector<Token> cachedTokens;
+        std::vector<NumericLiteral> cachedLiterals;
+        const std::vector<Token> *tokens = nullptr;
+        bool runs = options.run || options.treeWalk || options.dumpBytecode;
+        if (!options.cacheDir.empty())
+        {
+            BASSIL_PERF_REGION("cache", inputContent.size());
+            contentHash = ParseCache::hashSource(inputContent);
+            result.cacheEntry = ParseCache::Entry::open(options.cacheDir, contentHash, inputContent.size(), options.columnMode);
+            try
+            {
+                if (result.cacheEntry)
+                {
+                    // Only the header and diagnostics are read unless tokens or the tree are printed.
+                    const ParseCache::Entry &entry = *result.cacheEntry;
+                    result.tokenCount = entry.tokenCount();
+                    result.diagnostics = entry.diagnostics();
+                    if (options.dumpAst || options.displayTokens || !options.tokensOutputDir.empty() || runs)
+                    {
+                        cachedTokens = entry.tokens();
+                        tokens = &cachedTokens;
+                    }
+                    if (runs)
+                    {
+                        cachedLiterals = entry.literals();
+                    }
+                    if (options.dumpAst)
+                    {
+                        std::ostringstream out;
+                        dumpAst(entry.tree(), cachedTokens, out);
+                        result.ast = out.str();
+                    }
+                }
+            }
+            catch (const std::runtime_error &e)
+            {
+                Utils::general_log("[driver] Ignoring parse cache entry of " + source.path + ": " + e.what(), logBool);
+                result.cacheEntry.reset();
+                result.diagnostics.clear();
+                tokens = nullptr;
+            }
+        }
+
+        if (!result.cacheEntry)
+        {
+            Utils::general_log("[driver] Lexing " + source.path, logBool);
+            // Token text is at most the input size; one chunk of that size serves the whole file.
+            result.arena = std::make_shared<CompilationArena>(inputContent.size() + 1024);
+            // Each worker reuses one lexer, so after its first few files lexing stops allocating.
+            static thread_local Lexer lexer;
+            {
+                BASSIL_PERF_REGION("lex", inputContent.size());
+                BASSIL_ALLOC_PHASE(AllocTracker::AP_Lex);
+                lexer.setColumnMode(options.columnMode);
+                lexer.lex(inputContent, *result.arena);
+                result.diagnostics = lexer.diagnostics();
+            }
+            tokens = &lexer.tokens();
+            result.tokenCount = tokens->size();
+
+            // Like the lexer, one parser per worker keeps its node arrays and scratch stack warm.
+            static thread_local Parser parser;
+            {
+                BASSIL_PERF_REGION("parse", inputContent.size());
+                BASSIL_ALLOC_PHASE(AllocTracker::AP_Parse);
+                const Ast &tree = pool ? parser.parseParallel(*tokens, *result.arena, *pool) : parser.parse(*tokens, *result.arena);
+                mergeDiagnostics(result.diagnostics, parser.diagnostics());
+                if (options.dumpAst)
+                {
+                    std::ostringstream out;
+                    dumpAst(tree, *tokens, out);
+                    result.ast = out.str();
+                }
+            }
+
+            checkTree(parser.tree().view(), *tokens, lexer.literals(), inputContent.size(), *result.arena, result.diagnostics);
+
+            if (!options.cacheDir.empty())
+            {
+                BASSIL_PERF_REGION("cache-store", inputContent.size());
+                std::string error;
+                if (!ParseCache::store(options.cacheDir, contentHash, inputContent.size(), options.columnMode,
+                                       *tokens, lexer.literals(), parser.tree(), result.diagnostics, error))
+                {
+                    Utils::general_log("[driver] " + error, logBool);
+                }
+            }
+
+            if (runs && result.diagnostics.empty())
+            {
+                runTree(parser.tree().view(), *tokens, lexer.literals(), inputContent.size(), options, result);
+            }
+        }
+        else if (runs && result.diagnostics.empty())
+        {
+            // The entry only keeps the tree; the semantic passes run again for the compiler's inputs.
+            result.arena = std::make_shared<CompilationArena>(1024);
+            AstView tree = result.cacheEntry->tree();
+            checkTree(tree, cachedTokens, cachedLiterals, inputContent.size(), *result.arena, result.diagnostics);
+            if (result.diagnostics.empty())
+            {
+                runTree(tree, cachedTokens, cachedLiterals, inputContent.size(), options, result);
+            }
+        }
+
+        if (options.displayTokens)
+        {
+            BASSIL_PERF_REGION("display", inputContent.size());
+            BASSIL_ALLOC_PHASE(AllocTracker::AP_Display);
+            display_tokens(*tokens);
+        }
+
+        bool written = true;
+        if (tokens)
+        {
+            BASSIL_PERF_REGION("save", inputContent.size());
+            BASSIL_ALLOC_PHASE(AllocTracker::AP_Save);
+            written = writeTokenOutput(source, *tokens, options, result.error);
+        }
+        if (!written)
+        {
+            return result;
+        }
+
+        result.ok = true;
+        return result;
+    }
+
+    std::string tokenOutputPath(const SourceFile &source, const Options &options)
+    {
+        if (options.tokensOutputDir.empty())
+        {
+            return "";
+        }
+        return (fs::path(options.tokensOutputDir) / (source.relativePath + ".json")).string();
+    }
+
+    bool writeTokenOutput(const SourceFile &source, const std::vector<Token> &tokens, const Options &options, std::string &error)
+    {
+        std::string outputPath = tokenOutputPath(source, options);
+        if (outputPath.empty())
+        {
+            return true;
+        }
+
+        std::error_code ec;
+        fs::create_directories(fs::path(outputPath).parent_path(), ec);
+        if (Utils::clear_file(outputPath) != 0)
+        {
+            error = "unable to write token output " + outputPath;
+            return false;
+        }
+        save_tokens(tokens, outputPath);
+        return true;
+    }
+
+    void printResult(const SourceFile &source, const FileResult &result, const Options &options)
+    {
+        BASSIL_ALLOC_PHASE(AllocTracker::AP_Report);
+        if (!result.ok)
+        {
+            std::cerr << source.path << ": error: " << result.error << "\n";
+            return;
+        }
+
+        for (const auto &diagnostic : result.diagnostics)
+        {
+            std::cerr << source.path << ":" << diagnostic.line << ":" << diagnostic.start_column
+                      << ": error: " << diagnostic.message << "\n";
+        }
+
+        std::cout << result.ast << result.bytecode << result.output;
+
+        if (!options.quiet)
+        {
+            std::cout << source.path << ": " << result.tokenCount << " tokens\n";
+        }
+    }
+
+    /**
+     * @brief Thin client mode: asks a running bassild for the diagnostics of every source.
+     *
+     * @param sources The files to check.
+     * @param options The driver options.
+     * @return int 0 if every file was checked without errors, 1 otherwise.
+     */
+    static int runClient(const std::vector<SourceFile> &sources, const Options &options)
+    {
+        int failures = 0;
+        std::vector<std::string> payload;
+        std::string error;
+
+        for (const auto &source : sources)
+        {
+            std::error_code ec;
+            std::string absolutePath = fs::absolute(source.path, ec).lexically_normal().string();
+            if (!CompileServer::request(options.serverSocket, "CHECK " + absolutePath, payload, error))
+            {
+                std::cerr << source.path << ": error: " << error << "\n";
+                failures++;
+                continue;
+            }
+
+            for (const auto &line : payload)
+            {
+                std::cerr << line << "\n";
+            }
+            if (!payload.empty())
+            {
+                failures++;
+            }
+            else if (!options.quiet)
+            {
+                std::cout << source.path << ": ok\n";
+            }
+        }
+
+        return failures == 0 ? 0 : 1;
+    }
+
+    /**
+     * @brief Runs the selected mode (watch, client or local compilation).
+     *
+     * @param options The driver options.
+     * @return int The process exit code.
+     */
+    static int runPipeline(const Options &options)
+    {
+        // Logging is opt-in for the driver: every general_log call opens the log file.
+        logBool = !options.logFile.empty();
+        if (logBool)
+        {
+            Utils::setLogFilePath(options.logFile);
+        }
+
+        if (options.watch)
+        {
+            return Watch::run(options);
+        }
+
+        std::vector<SourceFile> sources;
+        try
+        {
+            sources = collectSources(options.inputs);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "bassilc: " << e.what() << "\n";
+            return 1;
+        }
+
+        if (!options.serverSocket.empty())
+        {
+            return runClient(sources, options);
+        }
+
+        std::vector<FileResult> results(sources.size());
+
+        if (sources.size() == 1 && options.jobs != 1 && sources[0].size >= ParallelParseBytes)
+        {
+            // One big file: the only parallelism left is inside it.
+            ThreadPool pool(options.jobs);
+            results[0] = compileFile(sources[0], options, &pool);
+        }
+        else if (sources.size() == 1 || options.jobs == 1)
+        {
+            for (size_t i = 0; i < sources.size(); i++)
+            {
+                results[i] = compileFile(sources[i], options);
+            }
+        }
+        else
+        {
+            // Largest files first so a big file picked up last can't dominate the tail.
+            std::vector<size_t> schedule(sources.size());
+            std::iota(schedule.begin(), schedule.end(), 0);
+            std::stable_sort(schedule.begin(), schedule.end(), [&](size_t a, size_t b)
+                             { return sources[a].size > sources[b].size; });
+
+            BASSIL_TRACE_SCOPE("compileAll");
+            ThreadPool pool(options.jobs);
+            for (size_t index : schedule)
+            {
+                pool.submit([&, index]
+                            { results[index] = compileFile(sources[index], options, &pool); });
+            }
+            pool.wait();
+        }
+
+        int failures = 0;
+        for (size_t i = 0; i < sources.size(); i++)
+        {
+            printResult(sources[i], results[i], options);
+            if (!results[i].ok || !results[i].diagnostics.empty())
+            {
+                failures++;
+            }
+        }
+
+        return failures == 0 ? 0 : 1;
+    }
+
+    int run(const Options &options)
+    {
+        PerfCounters::setEnabled(options.perfCounters);
+        if (options.traceFile.empty())
+        {
+            int status = runPipeline(options);
+            if (options.perfCounters)
+            {
+                PerfCounters::report(std::cerr);
+            }
+            return status;
+        }
+
+        Trace::setEnabled(true);
+        Trace::setThreadName("main");
+        int status = runPipeline(options);
+        Trace::setEnabled(false);
+
+        if (options.perfCounters)
+        {
+            PerfCounters::report(std::cerr);
+        }
+        if (!Trace::writeChromeJson(options.traceFile))
+        {
+            std::cerr << "bassilc: unable to write trace " << options.traceFile << "\n";
+            return 1;
+        }
+        return status;
+    }
+}
@@ -1,4 +1,5 @@
-#include "C:/coding-projects/CPP-Dev/bassil/src/headers/error_report.h"
+#include "../headers/error_report.h"
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <limits>
@@ -67,4 +68,17 @@ int reportError(const std::string &filePath, int lineNumber, int startColumn, in
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+void mergeDiagnostics(std::vector<Diagnostic> &diagnostics, const std::vector<Diagnostic> &more)
+{
+    if (more.empty())
+    {
+        return;
+    }
+    size_t existing = diagnostics.size();
+    diagnostics.insert(diagnostics.end(), more.begin(), more.end());
+    std::inplace_merge(diagnostics.begin(), diagnostics.begin() + static_cast<std::ptrdiff_t>(existing), diagnostics.end(),
+                       [](const Diagnostic &a, const Diagnostic &b)
+                       { return a.line != b.line ? a.line < b.line : a.start_column < b.start_column; });
+}
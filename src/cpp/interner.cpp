@@ -0,0 +1,134 @@
+/**
+ * @file interner.cpp
+ * @brief Implementation of the sharded string interner.
+ */
+
+#include "../headers/interner.h"
+#include <stdexcept>
+
+Interner::Interner()
+{
+    for (Shard &shard : shards)
+    {
+        shard.slots.assign(256, 0);
+        shard.blocks.reset(new std::atomic<Entry *>[MaxBlocks]);
+        for (size_t b = 0; b < MaxBlocks; b++)
+        {
+            shard.blocks[b].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+}
+
+Interner::~Interner() = default;
+
+Interner &Interner::global()
+{
+    static Interner interner;
+    return interner;
+}
+
+SymbolId Interner::intern(std::string_view text, std::uint64_t precomputedHash)
+{
+    size_t shardIndex = static_cast<size_t>(precomputedHash >> (64 - ShardBits));
+    Shard &shard = shards[shardIndex];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return find(shard, shardIndex, text, precomputedHash, true);
+}
+
+SymbolId Interner::lookup(std::string_view text)
+{
+    std::uint64_t h = hash(text);
+    size_t shardIndex = static_cast<size_t>(h >> (64 - ShardBits));
+    Shard &shard = shards[shardIndex];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return find(shard, shardIndex, text, h, false);
+}
+
+SymbolId Interner::find(Shard &shard, size_t shardIndex, std::string_view text, std::uint64_t hash, bool insert)
+{
+    std::uint64_t tag = hash & 0xFFFFFFFF00000000ull;
+    size_t mask = shard.slots.size() - 1;
+
+    for (size_t i = static_cast<size_t>(hash) & mask;; i = (i + 1) & mask)
+    {
+        std::uint64_t slot = shard.slots[i];
+        if (slot == 0)
+        {
+            break;
+        }
+        if ((slot & 0xFFFFFFFF00000000ull) == tag)
+        {
+            SymbolId local = static_cast<SymbolId>(slot) - 1;
+            const Entry &entry = shard.blocks[local >> BlockBits].load(std::memory_order_relaxed)[local & BlockMask];
+            if (entry.text == text)
+            {
+                return ((local + 1) << ShardBits) | static_cast<SymbolId>(shardIndex);
+            }
+        }
+    }
+
+    if (!insert)
+    {
+        return NoSymbol;
+    }
+
+    SymbolId local = shard.count;
+    if ((local >> BlockBits) >= MaxBlocks)
+    {
+        throw std::length_error("Interner: too many symbols");
+    }
+
+    Entry *block = shard.blocks[local >> BlockBits].load(std::memory_order_relaxed);
+    if (!block)
+    {
+        block = shard.storage.makeArray<Entry>(size_t(1) << BlockBits);
+        shard.blocks[local >> BlockBits].store(block, std::memory_order_release);
+    }
+    block[local & BlockMask] = {shard.storage.copyString(text), hash};
+
+    // Keep the load factor under 1/2 so probe sequences stay short. grow() re-inserts
+    // the entries below count, so it runs before the new entry is counted and placed.
+    if ((static_cast<size_t>(local) + 1) * 2 > shard.slots.size())
+    {
+        grow(shard);
+        mask = shard.slots.size() - 1;
+    }
+
+    size_t i = static_cast<size_t>(hash) & mask;
+    while (shard.slots[i] != 0)
+    {
+        i = (i + 1) & mask;
+    }
+    shard.slots[i] = tag | (local + 1);
+    shard.count++;
+
+    return ((local + 1) << ShardBits) | static_cast<SymbolId>(shardIndex);
+}
+
+void Interner::grow(Shard &shard)
+{
+    std::vector<std::uint64_t> slots(shard.slots.size() * 2, 0);
+    size_t mask = slots.size() - 1;
+    for (SymbolId local = 0; local < shard.count; local++)
+    {
+        const Entry &entry = shard.blocks[local >> BlockBits].load(std::memory_order_relaxed)[local & BlockMask];
+        size_t i = static_cast<size_t>(entry.hash) & mask;
+        while (slots[i] != 0)
+        {
+            i = (i + 1) & mask;
+        }
+        slots[i] = (entry.hash & 0xFFFFFFFF00000000ull) | (local + 1);
+    }
+    shard.slots.swap(slots);
+}
+
+size_t Interner::size() const
+{
+    size_t total = 0;
+    for (const Shard &shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.count;
+    }
+    return total;
+}
@@ -0,0 +1,811 @@
+/**
+ * @file interpreter.cpp
+ * @brief Implementation of the bytecode interpreter and the reference tree-walker.
+ */
+
+#include "../headers/interpreter.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BASSIL_COMPUTED_GOTO 1
+#endif
+
+namespace
+{
+    /// print output is buffered up to this size before it is written out.
+    constexpr size_t FlushBytes = 64 * 1024;
+
+    const std::string_view DivisionByZero = "Division by zero";
+    const std::string_view RemainderByZero = "Remainder of division by zero";
+    const std::string_view StackOverflow = "Stack overflow";
+    const std::string_view MissingReturn = "Reached the end of a function without returning a value";
+
+    const std::string EmptyString;
+
+    /// Wrapping arithmetic: computed on the unsigned representation, which has no overflow.
+    inline std::int64_t wrap(std::uint64_t value)
+    {
+        return static_cast<std::int64_t>(value);
+    }
+
+    /// Truncating division; the minimum int divided by -1 wraps to itself. @p b is not 0.
+    inline std::int64_t divide(std::int64_t a, std::int64_t b)
+    {
+        return b == -1 ? wrap(0 - static_cast<std::uint64_t>(a)) : a / b;
+    }
+
+    inline std::int64_t remainder(std::int64_t a, std::int64_t b)
+    {
+        return b == -1 ? 0 : a % b;
+    }
+
+    inline std::uint16_t read16(const std::uint8_t *p)
+    {
+        std::uint16_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline std::uint32_t read32(const std::uint8_t *p)
+    {
+        std::uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    /// A run-time error of the tree-walker, thrown up to run().
+    struct RuntimeFault
+    {
+        std::uint32_t token;
+        std::string_view message;
+    };
+}
+
+Interpreter::Interpreter() : stack(StackValues), frames(MaxCallDepth)
+{
+}
+
+RunResult Interpreter::run(const Program &program, std::ostream &out)
+{
+    output.clear();
+    globals.assign(program.globalCount, Value{0});
+
+    const BytecodeFunction *functions = program.functions.data();
+    const BytecodeFunction *function = functions;
+    // The top-level frame always fits; calls check for room before they enter.
+    if (stack.size() < function->frameSize + function->maxStack)
+    {
+        stack.resize(function->frameSize + function->maxStack);
+    }
+    Value *stackEnd = stack.data() + stack.size();
+    Value *base = stack.data();
+    Value *sp = base + function->frameSize;
+    Frame *frame = frames.data();
+    Frame *frameEnd = frame + frames.size();
+    Value *globalSlots = globals.data();
+    const std::uint8_t *code = function->code.data();
+    const std::uint8_t *ip = code;
+    const Value *constants = function->constants.data();
+    std::string_view fault;
+
+#define LEAVE_FRAME()                           \
+    --frame;                                    \
+    ip = frame->returnAddress;                  \
+    base = frame->base;                         \
+    function = frame->function;                 \
+    code = function->code.data();               \
+    constants = function->constants.data()
+
+#define PRINT(type)                             \
+    appendValue(output, *--sp, type);           \
+    output += '\n';                             \
+    if (output.size() >= FlushBytes)            \
+    {                                           \
+        out.write(output.data(), output.size()); \
+        output.clear();                         \
+    }
+
+#define INT_BINARY(expr)                        \
+    sp--;                                       \
+    sp[-1].integer = (expr);
+
+#define FLOAT_BINARY(expr)                      \
+    sp--;                                       \
+    sp[-1].floating = (expr);
+
+#define COMPARE(field, op)                      \
+    sp--;                                       \
+    sp[-1].integer = sp[-1].field op sp[0].field;
+
+#define JUMP_IF(op)                             \
+    sp -= 2;                                    \
+    ip = sp[0].integer op sp[1].integer ? code + read32(ip) : ip + 4;
+
+#define JUMP_IF_INT8(op)                        \
+    sp--;                                       \
+    ip = sp[0].integer op static_cast<std::int8_t>(ip[0]) ? code + read32(ip + 1) : ip + 5;
+
+#ifdef BASSIL_COMPUTED_GOTO
+#define BASSIL_OPCODE_LABEL(name, operand, effect) &&L_##name,
+    static const void *const dispatch[] = {BASSIL_OPCODES(BASSIL_OPCODE_LABEL)};
+#undef BASSIL_OPCODE_LABEL
+#define CASE(name) L_##name:
+#define NEXT() goto *dispatch[*ip++]
+    NEXT();
+#else
+#define CASE(name) case name:
+#define NEXT() continue
+    for (;;)
+    {
+        switch (static_cast<Opcode>(*ip++))
+        {
+#endif
+
+    CASE(OP_Const)
+        *sp++ = constants[read16(ip)];
+        ip += 2;
+        NEXT();
+    CASE(OP_Int8)
+        (sp++)->integer = static_cast<std::int8_t>(*ip++);
+        NEXT();
+    CASE(OP_Pop)
+        sp--;
+        NEXT();
+    CASE(OP_Dup)
+        sp[0] = sp[-1];
+        sp++;
+        NEXT();
+    CASE(OP_LoadLocal)
+        *sp++ = base[read16(ip)];
+        ip += 2;
+        NEXT();
+    CASE(OP_StoreLocal)
+        base[read16(ip)] = *--sp;
+        ip += 2;
+        NEXT();
+    CASE(OP_LoadGlobal)
+        *sp++ = globalSlots[read16(ip)];
+        ip += 2;
+        NEXT();
+    CASE(OP_StoreGlobal)
+        globalSlots[read16(ip)] = *--sp;
+        ip += 2;
+        NEXT();
+    CASE(OP_IncLocal)
+    {
+        Value &local = base[read16(ip)];
+        local.integer = wrap(static_cast<std::uint64_t>(local.integer) + static_cast<std::uint64_t>(static_cast<std::int8_t>(ip[2])));
+        ip += 3;
+        NEXT();
+    }
+    CASE(OP_AddInt)
+        INT_BINARY(wrap(static_cast<std::uint64_t>(sp[-1].integer) + static_cast<std::uint64_t>(sp[0].integer)));
+        NEXT();
+    CASE(OP_SubInt)
+        INT_BINARY(wrap(static_cast<std::uint64_t>(sp[-1].integer) - static_cast<std::uint64_t>(sp[0].integer)));
+        NEXT();
+    CASE(OP_MulInt)
+        INT_BINARY(wrap(static_cast<std::uint64_t>(sp[-1].integer) * static_cast<std::uint64_t>(sp[0].integer)));
+        NEXT();
+    CASE(OP_AddInt8)
+        sp[-1].integer = wrap(static_cast<std::uint64_t>(sp[-1].integer) + static_cast<std::uint64_t>(static_cast<std::int8_t>(*ip++)));
+        NEXT();
+    CASE(OP_DivInt)
+        if (sp[-1].integer == 0)
+        {
+            fault = DivisionByZero;
+            goto failed;
+        }
+        INT_BINARY(divide(sp[-1].integer, sp[0].integer));
+        NEXT();
+    CASE(OP_ModInt)
+        if (sp[-1].integer == 0)
+        {
+            fault = RemainderByZero;
+            goto failed;
+        }
+        INT_BINARY(remainder(sp[-1].integer, sp[0].integer));
+        NEXT();
+    CASE(OP_NegInt)
+        sp[-1].integer = wrap(0 - static_cast<std::uint64_t>(sp[-1].integer));
+        NEXT();
+    CASE(OP_AddFloat)
+        FLOAT_BINARY(sp[-1].floating + sp[0].floating);
+        NEXT();
+    CASE(OP_SubFloat)
+        FLOAT_BINARY(sp[-1].floating - sp[0].floating);
+        NEXT();
+    CASE(OP_MulFloat)
+        FLOAT_BINARY(sp[-1].floating * sp[0].floating);
+        NEXT();
+    CASE(OP_DivFloat)
+        FLOAT_BINARY(sp[-1].floating / sp[0].floating);
+        NEXT();
+    CASE(OP_NegFloat)
+        sp[-1].floating = -sp[-1].floating;
+        NEXT();
+    CASE(OP_IntToFloat)
+        sp[-1].floating = static_cast<double>(sp[-1].integer);
+        NEXT();
+    CASE(OP_EqInt)
+        COMPARE(integer, ==);
+        NEXT();
+    CASE(OP_NeInt)
+        COMPARE(integer, !=);
+        NEXT();
+    CASE(OP_LtInt)
+        COMPARE(integer, <);
+        NEXT();
+    CASE(OP_LeInt)
+        COMPARE(integer, <=);
+        NEXT();
+    CASE(OP_GtInt)
+        COMPARE(integer, >);
+        NEXT();
+    CASE(OP_GeInt)
+        COMPARE(integer, >=);
+        NEXT();
+    CASE(OP_EqFloat)
+        COMPARE(floating, ==);
+        NEXT();
+    CASE(OP_NeFloat)
+        COMPARE(floating, !=);
+        NEXT();
+    CASE(OP_LtFloat)
+        COMPARE(floating, <);
+        NEXT();
+    CASE(OP_LeFloat)
+        COMPARE(floating, <=);
+        NEXT();
+    CASE(OP_GtFloat)
+        COMPARE(floating, >);
+        NEXT();
+    CASE(OP_GeFloat)
+        COMPARE(floating, >=);
+        NEXT();
+    CASE(OP_EqString)
+        sp--;
+        sp[-1].integer = *sp[-1].string == *sp[0].string;
+        NEXT();
+    CASE(OP_NeString)
+        sp--;
+        sp[-1].integer = *sp[-1].string != *sp[0].string;
+        NEXT();
+    CASE(OP_Not)
+        sp[-1].integer = sp[-1].integer == 0;
+        NEXT();
+    CASE(OP_Jump)
+        ip = code + read32(ip);
+        NEXT();
+    CASE(OP_JumpIfFalse)
+        ip = (--sp)->integer ? ip + 4 : code + read32(ip);
+        NEXT();
+    CASE(OP_JumpIfTrue)
+        ip = (--sp)->integer ? code + read32(ip) : ip + 4;
+        NEXT();
+    CASE(OP_AndJump)
+        if (sp[-1].integer)
+        {
+            sp--;
+            ip += 4;
+        }
+        else
+        {
+            ip = code + read32(ip);
+        }
+        NEXT();
+    CASE(OP_OrJump)
+        if (sp[-1].integer)
+        {
+            ip = code + read32(ip);
+        }
+        else
+        {
+            sp--;
+            ip += 4;
+        }
+        NEXT();
+    CASE(OP_JumpIfEqInt)
+        JUMP_IF(==);
+        NEXT();
+    CASE(OP_JumpIfNeInt)
+        JUMP_IF(!=);
+        NEXT();
+    CASE(OP_JumpIfLtInt)
+        JUMP_IF(<);
+        NEXT();
+    CASE(OP_JumpIfLeInt)
+        JUMP_IF(<=);
+        NEXT();
+    CASE(OP_JumpIfGtInt)
+        JUMP_IF(>);
+        NEXT();
+    CASE(OP_JumpIfGeInt)
+        JUMP_IF(>=);
+        NEXT();
+    CASE(OP_JumpIfEqInt8)
+        JUMP_IF_INT8(==);
+        NEXT();
+    CASE(OP_JumpIfNeInt8)
+        JUMP_IF_INT8(!=);
+        NEXT();
+    CASE(OP_JumpIfLtInt8)
+        JUMP_IF_INT8(<);
+        NEXT();
+    CASE(OP_JumpIfLeInt8)
+        JUMP_IF_INT8(<=);
+        NEXT();
+    CASE(OP_JumpIfGtInt8)
+        JUMP_IF_INT8(>);
+        NEXT();
+    CASE(OP_JumpIfGeInt8)
+        JUMP_IF_INT8(>=);
+        NEXT();
+    CASE(OP_Call)
+    {
+        // The arguments on the operand stack become the first slots of the callee's frame.
+        const BytecodeFunction *callee = functions + read16(ip);
+        if (frame == frameEnd || sp + (callee->frameSize - callee->parameterCount) + callee->maxStack > stackEnd)
+        {
+            fault = StackOverflow;
+            goto failed;
+        }
+        *frame++ = {ip + 2, base, function};
+        base = sp - callee->parameterCount;
+        sp = base + callee->frameSize;
+        function = callee;
+        code = function->code.data();
+        constants = function->constants.data();
+        ip = code;
+        NEXT();
+    }
+    CASE(OP_Return)
+        base[0] = sp[-1];
+        sp = base + 1;
+        LEAVE_FRAME();
+        NEXT();
+    CASE(OP_ReturnVoid)
+        sp = base;
+        LEAVE_FRAME();
+        NEXT();
+    CASE(OP_NoReturn)
+        fault = MissingReturn;
+        goto failed;
+    CASE(OP_Halt)
+        out.write(output.data(), output.size());
+        return {true, {0, 0, 0, {}}};
+    CASE(OP_PrintInt)
+        PRINT(TypeInt);
+        NEXT();
+    CASE(OP_PrintFloat)
+        PRINT(TypeFloat);
+        NEXT();
+    CASE(OP_PrintChar)
+        PRINT(TypeChar);
+        NEXT();
+    CASE(OP_PrintBool)
+        PRINT(TypeBool);
+        NEXT();
+    CASE(OP_PrintString)
+        PRINT(TypeString);
+        NEXT();
+
+#ifndef BASSIL_COMPUTED_GOTO
+        default:
+            fault = "Invalid instruction";
+            goto failed;
+        }
+    }
+#endif
+
+#undef LEAVE_FRAME
+#undef PRINT
+#undef INT_BINARY
+#undef FLOAT_BINARY
+#undef COMPARE
+#undef JUMP_IF
+#undef JUMP_IF_INT8
+#undef CASE
+#undef NEXT
+
+failed:
+    // ip is just past the opcode that failed; its position was recorded by the compiler.
+    out.write(output.data(), output.size());
+    std::uint32_t offset = static_cast<std::uint32_t>(ip - 1 - code);
+    auto at = std::lower_bound(function->positions.begin(), function->positions.end(), offset,
+                               [](const SourcePosition &position, std::uint32_t value)
+                               { return position.offset < value; });
+    if (at == function->positions.end() || at->offset != offset)
+    {
+        return {false, {0, 0, 0, fault}};
+    }
+    return {false, {at->line, at->start_column, at->end_column, fault}};
+}
+
+RunResult TreeWalker::run(const AstView &input, const std::vector<Token> &inputTokens, const std::vector<NumericLiteral> &inputLiterals,
+                          const Resolution &names, const std::vector<TypeId> &nodeTypes, std::ostream &stream)
+{
+    tree = input;
+    tokens = &inputTokens;
+    literals = &inputLiterals;
+    resolution = &names;
+    types = &nodeTypes;
+    out = &stream;
+    globals.assign(resolution->globalCount, Value{0});
+    locals.assign(resolution->frameSizes[0], Value{0});
+    base = 0;
+    depth = 0;
+    returnType = TypeVoid;
+    strings.clear();
+    chain.clear();
+    output.clear();
+
+    RunResult result = {true, {0, 0, 0, {}}};
+    try
+    {
+        if (!tree.empty())
+        {
+            for (NodeIndex item : tree.children(tree.root()))
+            {
+                // A return among the top-level statements ends the program.
+                if (tree.kind(item) != NK_Function && execute(item))
+                {
+                    break;
+                }
+            }
+        }
+    }
+    catch (const RuntimeFault &fault)
+    {
+        const Token &at = (*tokens)[fault.token];
+        result = {false, {at.line, at.start_column, at.end_column, fault.message}};
+    }
+    out->write(output.data(), output.size());
+    return result;
+}
+
+bool TreeWalker::execute(NodeIndex node)
+{
+    // Returns true when a return statement ran.
+    ChildRange children = tree.children(node);
+    switch (tree.kind(node))
+    {
+    case NK_VarDecl:
+    {
+        Value value;
+        if (children.size() > 1)
+        {
+            value = evaluateAs(children[1], (*types)[node]);
+        }
+        else if ((*types)[node] == TypeString)
+        {
+            value.string = &EmptyString;
+        }
+        else
+        {
+            value.integer = 0;
+        }
+        variable(node) = value;
+        return false;
+    }
+    case NK_If:
+        if (evaluate(children[0]).integer)
+        {
+            return execute(children[1]);
+        }
+        return children.size() > 2 && execute(children[2]);
+    case NK_For:
+        if (tree.kind(children[0]) == NK_VarDecl)
+        {
+            execute(children[0]);
+        }
+        else if (tree.kind(children[0]) != NK_Empty)
+        {
+            evaluate(children[0]);
+        }
+        while (tree.kind(children[1]) == NK_Empty || evaluate(children[1]).integer)
+        {
+            if (execute(children[3]))
+            {
+                return true;
+            }
+            if (tree.kind(children[2]) != NK_Empty)
+            {
+                evaluate(children[2]);
+            }
+        }
+        return false;
+    case NK_Block:
+        for (NodeIndex child : children)
+        {
+            if (execute(child))
+            {
+                return true;
+            }
+        }
+        return false;
+    case NK_Return:
+        if (children.size() > 0)
+        {
+            returned = evaluateAs(children[0], returnType);
+        }
+        return true;
+    case NK_ExprStmt:
+        evaluate(children[0]);
+        return false;
+    default:
+        return false;
+    }
+}
+
+Value TreeWalker::evaluate(NodeIndex node)
+{
+    ChildRange children = tree.children(node);
+    Value value = {0};
+    switch (tree.kind(node))
+    {
+    case NK_Literal:
+    {
+        const Token &token = (*tokens)[tree.token(node)];
+        switch (token.type)
+        {
+        case TK_Integer:
+        case TK_Char:
+            value.integer = (*literals)[token.literal - 1].integer;
+            break;
+        case TK_Float:
+            value.floating = (*literals)[token.literal - 1].floating;
+            break;
+        case TK_True:
+            value.integer = 1;
+            break;
+        case TK_String:
+        {
+            auto found = strings.try_emplace(node);
+            if (found.second)
+            {
+                decodeStringLiteral(token.value, found.first->second);
+            }
+            value.string = &found.first->second;
+            break;
+        }
+        default:
+            break;
+        }
+        return value;
+    }
+    case NK_Name:
+        return variable(node);
+    case NK_Assign:
+        // The value first: evaluating it may grow the frames and move the variable.
+        value = evaluateAs(children[1], (*types)[children[0]]);
+        variable(children[0]) = value;
+        return value;
+    case NK_Unary:
+        value = evaluate(children[0]);
+        if ((*tokens)[tree.token(node)].type == TK_Not)
+        {
+            value.integer = value.integer == 0;
+        }
+        else if ((*types)[children[0]] == TypeFloat)
+        {
+            value.floating = -value.floating;
+        }
+        else
+        {
+            value.integer = wrap(0 - static_cast<std::uint64_t>(value.integer));
+        }
+        return value;
+    case NK_Binary:
+        return binary(node);
+    case NK_Call:
+        return call(node);
+    default:
+        return value;
+    }
+}
+
+Value TreeWalker::evaluateAs(NodeIndex node, TypeId to)
+{
+    Value value = evaluate(node);
+    if (to == TypeFloat && (*types)[node] != TypeFloat)
+    {
+        value.floating = static_cast<double>(value.integer);
+    }
+    return value;
+}
+
+Value TreeWalker::binary(NodeIndex node)
+{
+    // A chain like a + b + c + ... is as deep as it is long, so the left operands are not evaluated by
+    // recursion: the innermost one first, then each operator up the chain with its right operand.
+    size_t bottom = chain.size();
+    NodeIndex left = node;
+    while (tree.kind(left) == NK_Binary)
+    {
+        chain.push_back(left);
+        left = tree.children(left)[0];
+    }
+    Value value = evaluate(left);
+    while (chain.size() > bottom)
+    {
+        value = binaryOperator(chain.back(), value);
+        chain.pop_back();
+    }
+    return value;
+}
+
+Value TreeWalker::binaryOperator(NodeIndex node, Value left)
+{
+    NodeIndex leftNode = tree.children(node)[0];
+    NodeIndex rightNode = tree.children(node)[1];
+    TokenKind op = (*tokens)[tree.token(node)].type;
+    Value value = {0};
+
+    if (op == TK_AndAnd || op == TK_OrOr)
+    {
+        if ((left.integer != 0) == (op == TK_OrOr))
+        {
+            return left;
+        }
+        return evaluate(rightNode);
+    }
+
+    if ((*types)[leftNode] == TypeString)
+    {
+        const std::string &right = *evaluate(rightNode).string;
+        value.integer = (*left.string == right) == (op == TK_EqualEqual);
+        return value;
+    }
+
+    if ((*types)[leftNode] == TypeFloat || (*types)[rightNode] == TypeFloat)
+    {
+        double a = (*types)[leftNode] == TypeFloat ? left.floating : static_cast<double>(left.integer);
+        double b = evaluateAs(rightNode, TypeFloat).floating;
+        switch (op)
+        {
+        case TK_Plus:
+            value.floating = a + b;
+            break;
+        case TK_Minus:
+            value.floating = a - b;
+            break;
+        case TK_Star:
+            value.floating = a * b;
+            break;
+        case TK_Slash:
+            value.floating = a / b;
+            break;
+        case TK_EqualEqual:
+            value.integer = a == b;
+            break;
+        case TK_NotEqual:
+            value.integer = a != b;
+            break;
+        case TK_Less:
+            value.integer = a < b;
+            break;
+        case TK_Greater:
+            value.integer = a > b;
+            break;
+        case TK_LessEqual:
+            value.integer = a <= b;
+            break;
+        case TK_GreaterEqual:
+            value.integer = a >= b;
+            break;
+        default:
+            break;
+        }
+        return value;
+    }
+
+    std::int64_t a = left.integer;
+    std::int64_t b = evaluate(rightNode).integer;
+    switch (op)
+    {
+    case TK_Plus:
+        value.integer = wrap(static_cast<std::uint64_t>(a) + static_cast<std::uint64_t>(b));
+        break;
+    case TK_Minus:
+        value.integer = wrap(static_cast<std::uint64_t>(a) - static_cast<std::uint64_t>(b));
+        break;
+    case TK_Star:
+        value.integer = wrap(static_cast<std::uint64_t>(a) * static_cast<std::uint64_t>(b));
+        break;
+    case TK_Slash:
+        if (b == 0)
+        {
+            throw RuntimeFault{tree.token(node), DivisionByZero};
+        }
+        value.integer = divide(a, b);
+        break;
+    case TK_Percent:
+        if (b == 0)
+        {
+            throw RuntimeFault{tree.token(node), RemainderByZero};
+        }
+        value.integer = remainder(a, b);
+        break;
+    case TK_EqualEqual:
+        value.integer = a == b;
+        break;
+    case TK_NotEqual:
+        value.integer = a != b;
+        break;
+    case TK_Less:
+        value.integer = a < b;
+        break;
+    case TK_Greater:
+        value.integer = a > b;
+        break;
+    case TK_LessEqual:
+        value.integer = a <= b;
+        break;
+    case TK_GreaterEqual:
+        value.integer = a >= b;
+        break;
+    default:
+        break;
+    }
+    return value;
+}
+
+Value TreeWalker::call(NodeIndex node)
+{
+    ChildRange children = tree.children(node);
+    const SymbolInfo &callee = resolution->symbols[resolution->bindings[children[0]]];
+    if (callee.kind == SK_Builtin)
+    {
+        print(evaluate(children[1]), (*types)[children[1]]);
+        return Value{0};
+    }
+
+    // The arguments are pushed as the first slots of the new frame, then the rest is added.
+    ChildRange parameters = tree.children(callee.declaration);
+    size_t frame = locals.size();
+    for (std::uint32_t i = 1; i < children.size(); i++)
+    {
+        Value argument = evaluateAs(children[i], (*types)[parameters[i]]);
+        locals.push_back(argument);
+    }
+    if (depth == MaxCallDepth)
+    {
+        throw RuntimeFault{tree.token(node), StackOverflow};
+    }
+    locals.resize(frame + resolution->frameSizes[callee.slot]);
+
+    size_t callerBase = base;
+    TypeId callerReturnType = returnType;
+    base = frame;
+    returnType = (*types)[parameters[0]];
+    depth++;
+    bool hasReturned = execute(parameters[parameters.size() - 1]);
+    if (!hasReturned && returnType != TypeVoid)
+    {
+        throw RuntimeFault{tree.token(callee.declaration), MissingReturn};
+    }
+    depth--;
+    returnType = callerReturnType;
+    base = callerBase;
+    locals.resize(frame);
+    return returned;
+}
+
+Value &TreeWalker::variable(NodeIndex name)
+{
+    const SymbolInfo &symbol = resolution->symbols[resolution->bindings[name]];
+    return symbol.kind == SK_Global ? globals[symbol.slot] : locals[base + symbol.slot];
+}
+
+void TreeWalker::print(Value value, TypeId type)
+{
+    appendValue(output, value, type);
+    output += '\n';
+    if (output.size() >= FlushBytes)
+    {
+        out->write(output.data(), output.size());
+        output.clear();
+    }
+}
@@ -3,58 +3,302 @@
  * @brief Implementation of the lexical analyzer for the Bassil language.
  */
 
-#include "C:/coding-projects/CPP-Dev/bassil/src/headers/lexer.h"
-#include <cctype>
-#include <unordered_map>
+#include "../headers/lexer.h"
+#include "../headers/numbers.h"
+#include "../headers/trace.h"
+#include "../headers/utf8.h"
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 bool logBool = true; // Define logBool here
 
+namespace
+{
+    /**
+     * @brief Source spelling of each fixed token, indexed by TokenKind (empty for literals and names).
+     */
+    const std::string_view tokenSpellings[] = {
+        "", "", "", "", "", "",
+        ";", ",", "(", ")", "{", "}",
+        "=", "+", "-", "*", "/", "%",
+        "==", "!=", "<", ">", "<=", ">=",
+        "&&", "||", "!",
+        "int", "char", "float", "string", "bool",
+        "if", "else", "for", "function", "return", "true", "false",
+        ""};
+
+    const char *const tokenKindNames[] = {
+        "Identifier", "Integer", "Float", "String", "Char", "Argument",
+        "Semicolon", "Comma", "OpenParen", "CloseParen", "OpenBrace", "CloseBrace",
+        "EqualsSign", "Plus", "Minus", "Star", "Slash", "Percent",
+        "EqualEqual", "NotEqual", "Less", "Greater", "LessEqual", "GreaterEqual",
+        "AndAnd", "OrOr", "Not",
+        "TypeInteger", "TypeChar", "TypeFloat", "TypeString", "TypeBool",
+        "If", "Else", "For", "Function", "Return", "True", "False",
+        "Unknown"};
+
+    static_assert(sizeof(tokenSpellings) / sizeof(tokenSpellings[0]) == TK_KindCount, "tokenSpellings is out of step with TokenKind");
+    static_assert(sizeof(tokenKindNames) / sizeof(tokenKindNames[0]) == TK_KindCount, "tokenKindNames is out of step with TokenKind");
+
+    bool isAsciiSpace(char c)
+    {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    bool isAsciiDigit(char c)
+    {
+        return static_cast<unsigned char>(c - '0') < 10;
+    }
+
+    /**
+     * @brief Home slot of a keyword symbol in Lexer's keyword table (multiplicative hash).
+     */
+    size_t keywordSlot(SymbolId symbol)
+    {
+        return static_cast<size_t>((symbol * 0x9E3779B1u) >> 26);
+    }
+
+    /**
+     * @brief Finds the "*\/" closing a block comment.
+     *
+     * Compares 16 bytes at a time against '*' and the following 16 against '/'
+     * where SSE2 is available, otherwise jumps between '*' characters with memchr.
+     *
+     * @param input The source.
+     * @param from First byte of the comment body.
+     * @return size_t Position of the '*', or std::string_view::npos if unterminated.
+     */
+    size_t findBlockCommentEnd(std::string_view input, size_t from)
+    {
+        const char *data = input.data();
+        size_t size = input.size();
+        size_t i = from;
+#ifdef __SSE2__
+        const __m128i star = _mm_set1_epi8('*');
+        const __m128i slash = _mm_set1_epi8('/');
+        for (; i + 17 <= size; i += 16)
+        {
+            __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 1));
+            int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, star), _mm_cmpeq_epi8(second, slash)));
+            if (mask != 0)
+            {
+                return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+            }
+        }
+#endif
+        while (i + 1 < size)
+        {
+            const void *found = std::memchr(data + i, '*', size - i - 1);
+            if (!found)
+            {
+                break;
+            }
+            i = static_cast<size_t>(static_cast<const char *>(found) - data);
+            if (data[i + 1] == '/')
+            {
+                return i;
+            }
+            i++;
+        }
+        return std::string_view::npos;
+    }
+
+    /**
+     * @brief Decodes the character after a backslash in a char literal.
+     * @param c The escaped character.
+     * @param code Receives the character code.
+     * @return bool False for an unknown escape.
+     */
+    bool decodeEscape(char c, std::int64_t &code)
+    {
+        switch (c)
+        {
+        case 'n':
+            code = '\n';
+            return true;
+        case 't':
+            code = '\t';
+            return true;
+        case 'r':
+            code = '\r';
+            return true;
+        case '0':
+            code = 0;
+            return true;
+        case '\\':
+        case '\'':
+        case '"':
+            code = static_cast<unsigned char>(c);
+            return true;
+        default:
+            return false;
+        }
+    }
+}
+
 /**
  * @brief Lexically analyze the input string and generate tokens
  * @param inputString The input string to be analyzed
+ * @param arena Holds the token values; must outlive the returned tokens
+ * @return Vector of tokens
+ */
+std::vector<Token> lex(const std::string &inputString, CompilationArena &arena)
+{
+    std::vector<Diagnostic> diagnostics;
+    return lex(inputString, diagnostics, arena);
+}
+
+/**
+ * @brief Lexically analyze the input string, collecting lexical errors
+ * @param inputString The input string to be analyzed
+ * @param diagnostics Receives one entry per lexical error, in source order
+ * @param arena Holds the token values and diagnostic messages; must outlive both
+ * @return Vector of tokens
+ */
+std::vector<Token> lex(const std::string &inputString, std::vector<Diagnostic> &diagnostics, CompilationArena &arena)
+{
+    std::vector<NumericLiteral> literals;
+    return lex(inputString, diagnostics, arena, literals);
+}
+
+/**
+ * @brief Lexically analyze the input string, also decoding numeric literals
+ * @param inputString The input string to be analyzed
+ * @param diagnostics Receives one entry per lexical error, in source order
+ * @param arena Holds the token values and diagnostic messages; must outlive both
+ * @param literals Receives the value of every number token, in token order (see Token::literal)
  * @return Vector of tokens
  */
-std::vector<Token> lex(const std::string &inputString)
+std::vector<Token> lex(const std::string &inputString, std::vector<Diagnostic> &diagnostics, CompilationArena &arena, std::vector<NumericLiteral> &literals)
+{
+    Lexer lexer;
+    lexer.lex(inputString, arena);
+    diagnostics.insert(diagnostics.end(), lexer.diagnostics().begin(), lexer.diagnostics().end());
+    literals = lexer.literals();
+    return lexer.tokens();
+}
+
+Lexer::Lexer(Interner &interner)
+    : interner(interner)
 {
-    std::vector<Token> tokens;
-    std::unordered_map<std::string, TokenKind> keywords = {
-        {"int", TK_TypeInteger},
-        {"char", TK_TypeChar},
-        {"float", TK_TypeFloat},
-        {"string", TK_TypeString}};
-    std::unordered_map<std::string, TokenKind> operators = {
-        {"+", TK_MathOperator},
-        {"-", TK_MathOperator},
-        {"*", TK_MathOperator},
-        {"/", TK_MathOperator},
-        {"%", TK_MathOperator},
-        {"=", TK_EqualsSign},
-        {"==", TK_ComparisonOperator},
-        {"!=", TK_ComparisonOperator},
-        {"<", TK_ComparisonOperator},
-        {">", TK_ComparisonOperator},
-        {"<=", TK_ComparisonOperator},
-        {">=", TK_ComparisonOperator},
-        {"&&", TK_LogicalOperator},
-        {"||", TK_LogicalOperator},
-        {"!", TK_LogicalOperator}};
+    for (int k = TK_TypeInteger; k <= TK_False; k++)
+    {
+        SymbolId symbol = interner.intern(tokenSpellings[k]);
+        size_t i = keywordSlot(symbol);
+        while (keywordSymbols[i] != NoSymbol)
+        {
+            i = (i + 1) & (KeywordSlots - 1);
+        }
+        keywordSymbols[i] = symbol;
+        keywordKinds[i] = static_cast<TokenKind>(k);
+    }
+}
 
+TokenKind Lexer::keywordKind(SymbolId symbol) const
+{
+    // With a dozen keywords in 64 slots most identifiers are rejected by one compare.
+    for (size_t i = keywordSlot(symbol); keywordSymbols[i] != NoSymbol; i = (i + 1) & (KeywordSlots - 1))
+    {
+        if (keywordSymbols[i] == symbol)
+        {
+            return keywordKinds[i];
+        }
+    }
+    return TK_Identifier;
+}
+
+void Lexer::reset()
+{
+    tokenBuffer.clear();
+    diagnosticBuffer.clear();
+    literalBuffer.clear();
+}
+
+const std::vector<Token> &Lexer::lex(std::string_view input, CompilationArena &arena)
+{
+    BASSIL_TRACE_SCOPE("lex");
+    reset();
+    tokenBuffer.reserve(input.size() / BytesPerToken + 16);
+
+    std::vector<Token> &tokens = tokenBuffer;
+    std::vector<Diagnostic> &diagnostics = diagnosticBuffer;
+    std::vector<NumericLiteral> &literals = literalBuffer;
     size_t pos = 0;
     int line = 1;
     int column = 1;
 
-    auto addToken = [&](TokenKind type, const std::string &value, int startColumn)
+    bool ascii = true;
+    size_t invalidUtf8 = Utf8::findInvalid(input, &ascii);
+    // Pure ASCII input has one byte per character whatever the column mode.
+    bool countCodepoints = columns == CM_Codepoints && !ascii;
+    const char *inputEnd = input.data() + input.size();
+
+    // Number of columns taken by input[from, to).
+    auto width = [&](size_t from, size_t to)
+    {
+        size_t bytes = to - from;
+        return static_cast<int>(countCodepoints ? bytes - Utf8::countContinuationBytes(input.substr(from, bytes)) : bytes);
+    };
+
+    auto addToken = [&](TokenKind type, std::string_view value, int startColumn, SymbolId symbol = NoSymbol, std::uint32_t literal = 0)
     {
-        tokens.push_back({type, value, line, startColumn, column - 1});
+        tokens.push_back({type, value, line, startColumn, column - 1, symbol, literal});
+    };
+
+    auto addDiagnostic = [&](int startColumn, int endColumn, std::string_view message)
+    {
+        diagnostics.push_back({line, startColumn, endColumn, message});
+        if (logBool)
+        {
+            Utils::general_log("Error: " + std::string(message) + " at line " + std::to_string(line) + ", column " + std::to_string(startColumn), logBool);
+        }
     };
 
-    while (pos < inputString.length())
+    // Report each invalid UTF-8 sequence once, up front; the loop below lexes its bytes as unknown characters.
+    size_t reportedUtf8 = 0;
+    for (size_t p = invalidUtf8, lineStart = 0; p < input.size();)
+    {
+        std::uint32_t codepoint;
+        int sequence = static_cast<unsigned char>(input[p]) < 0x80 ? 1 : Utf8::decode(input.data() + p, inputEnd, codepoint);
+        if (sequence)
+        {
+            p += static_cast<size_t>(sequence);
+            continue;
+        }
+        while (const void *newline = std::memchr(input.data() + lineStart, '\n', p - lineStart))
+        {
+            lineStart = static_cast<size_t>(static_cast<const char *>(newline) - input.data()) + 1;
+            line++;
+        }
+        static const char hexDigits[] = "0123456789ABCDEF";
+        unsigned char byte = static_cast<unsigned char>(input[p]);
+        const char hex[2] = {hexDigits[byte >> 4], hexDigits[byte & 0x0F]};
+        int at = width(lineStart, p) + 1;
+        addDiagnostic(at, at, arena.concat({"Invalid UTF-8 byte 0x", std::string_view(hex, 2)}));
+        reportedUtf8++;
+
+        // Skip the continuation bytes that belonged to the broken sequence.
+        size_t next = p + 1;
+        while (next < input.size() && next - p < 4 && (static_cast<unsigned char>(input[next]) & 0xC0) == 0x80)
+        {
+            next++;
+        }
+        p = next;
+    }
+    line = 1;
+
+    while (pos < input.size())
     {
-        char currentChar = inputString[pos];
+        char currentChar = input[pos];
 
         // Skip whitespace
-        if (std::isspace(currentChar))
+        if (isAsciiSpace(currentChar))
         {
             if (currentChar == '\n')
             {
@@ -69,51 +313,199 @@ std::vector<Token> lex(const std::string &inputString)
             continue;
         }
 
-        // Identifiers and keywords
-        if (isIdentifierStart(currentChar))
+        // Comments are skipped without producing tokens
+        if (currentChar == '/' && pos + 1 < input.size() && (input[pos + 1] == '/' || input[pos + 1] == '*'))
         {
-            size_t start = pos;
+            if (input[pos + 1] == '/')
+            {
+                // Leave the newline itself to the whitespace handling above.
+                const void *newline = std::memchr(input.data() + pos, '\n', input.size() - pos);
+                size_t end = newline ? static_cast<size_t>(static_cast<const char *>(newline) - input.data()) : input.size();
+                column += width(pos, end);
+                pos = end;
+                continue;
+            }
+
             int startColumn = column;
-            while (pos < inputString.length() && isIdentifierContinuation(inputString[pos]))
+            size_t close = findBlockCommentEnd(input, pos + 2);
+            size_t end = close == std::string_view::npos ? input.size() : close + 2;
+            if (close == std::string_view::npos)
             {
-                pos++;
-                column++;
+                addDiagnostic(startColumn, startColumn + 1, "Unterminated block comment");
+            }
+
+            // Keep line/column in step with the skipped text.
+            const char *scan = input.data() + pos;
+            const char *stop = input.data() + end;
+            const char *lastNewline = nullptr;
+            while (const void *newline = std::memchr(scan, '\n', static_cast<size_t>(stop - scan)))
+            {
+                lastNewline = static_cast<const char *>(newline);
+                scan = lastNewline + 1;
+                line++;
+            }
+            column = lastNewline ? width(static_cast<size_t>(lastNewline - input.data()), end) : column + width(pos, end);
+            pos = end;
+            continue;
+        }
+
+        // Character literals
+        if (currentChar == '\'')
+        {
+            int startColumn = column;
+            size_t length = input.size();
+            size_t p = pos + 1;
+            NumericLiteral literal = {};
+            literal.token = static_cast<std::uint32_t>(tokens.size());
+            std::string_view error;
+
+            if (p + 1 < length && input[p] == '\\' && input[p + 1] != '\n')
+            {
+                if (!decodeEscape(input[p + 1], literal.integer))
+                {
+                    error = arena.concat({"Unknown escape sequence '\\", input.substr(p + 1, 1), "' in character literal"});
+                }
+                p += 2;
             }
-            std::string identifier = inputString.substr(start, pos - start);
-            auto it = keywords.find(identifier);
-            if (it != keywords.end())
+            else if (p < length && input[p] == '\\')
             {
-                addToken(it->second, identifier, startColumn);
+                // A backslash at the end of the line or file escapes nothing; the newline stays for the line count.
+                error = "Unterminated character literal";
+                p++;
+            }
+            else if (p < length && input[p] != '\'' && input[p] != '\n')
+            {
+                // A multi-byte character is one character; an invalid byte was already reported.
+                std::uint32_t codepoint;
+                int sequence = Utf8::decode(input.data() + p, inputEnd, codepoint);
+                literal.integer = sequence ? codepoint : static_cast<unsigned char>(input[p]);
+                p += sequence ? static_cast<size_t>(sequence) : 1;
+            }
+            else if (p < length && input[p] == '\'')
+            {
+                error = "Empty character literal";
+            }
+            else
+            {
+                error = "Unterminated character literal";
+            }
+
+            if (p < length && input[p] == '\'')
+            {
+                p++;
             }
             else
             {
-                addToken(TK_Identifier, identifier, startColumn);
+                // 'ab' on one line is one bad literal; otherwise stop at what was read.
+                size_t lineEnd = input.find('\n', p);
+                size_t close = input.substr(0, lineEnd).find('\'', p);
+                if (close != std::string_view::npos)
+                {
+                    p = close + 1;
+                    error = "Character literal must contain exactly one character";
+                }
+                else if (error.empty())
+                {
+                    error = "Unterminated character literal";
+                }
+            }
+
+            column += width(pos, p);
+            if (!error.empty())
+            {
+                addDiagnostic(startColumn, column - 1, error);
             }
+            literal.valid = error.empty();
+            literals.push_back(literal);
+            addToken(TK_Char, arena.copyString(input.substr(pos, p - pos)), startColumn, NoSymbol, static_cast<std::uint32_t>(literals.size()));
+            tokens.back().malformed = !literal.valid;
+            pos = p;
             continue;
         }
 
-        // Numbers (integers and floats)
-        if (std::isdigit(currentChar))
+        // Identifiers and keywords: ASCII bytes directly, anything else by XID property
+        std::uint32_t codepoint = 0;
+        int sequence = 1;
+        bool multibyte = static_cast<unsigned char>(currentChar) >= 0x80;
+        if (multibyte)
+        {
+            sequence = Utf8::decode(input.data() + pos, inputEnd, codepoint);
+        }
+        if (multibyte ? sequence && Utf8::isXidStart(codepoint) : isIdentifierStart(currentChar))
         {
             size_t start = pos;
             int startColumn = column;
-            bool isFloat = false;
-            while (pos < inputString.length() && (std::isdigit(inputString[pos]) || inputString[pos] == '.'))
+            std::uint64_t hash = Interner::hashSeed;
+            while (pos < input.size())
             {
-                if (inputString[pos] == '.')
+                size_t next = pos + 1;
+                if (static_cast<unsigned char>(input[pos]) < 0x80)
+                {
+                    if (!isIdentifierContinuation(input[pos]))
+                    {
+                        break;
+                    }
+                }
+                else
                 {
-                    if (isFloat)
+                    int length = Utf8::decode(input.data() + pos, inputEnd, codepoint);
+                    if (length == 0 || !Utf8::isXidContinue(codepoint))
                     {
-                        Utils::general_log("Error: Multiple decimal points in number at line " + std::to_string(line) + ", column " + std::to_string(column), logBool);
                         break;
                     }
-                    isFloat = true;
+                    next = pos + static_cast<size_t>(length);
+                }
+                for (; pos < next; pos++)
+                {
+                    hash = Interner::hashStep(hash, static_cast<unsigned char>(input[pos]));
                 }
+            }
+            column += width(start, pos);
+            SymbolId symbol = interner.intern(input.substr(start, pos - start), hash);
+            addToken(keywordKind(symbol), interner.name(symbol), startColumn, symbol);
+            continue;
+        }
+
+        // Numbers (integers and floats)
+        if (isAsciiDigit(currentChar))
+        {
+            size_t start = pos;
+            int startColumn = column;
+            int decimalPoints = 0;
+            while (pos < input.size() && (isAsciiDigit(input[pos]) || input[pos] == '.'))
+            {
+                decimalPoints += input[pos] == '.';
                 pos++;
                 column++;
             }
-            std::string number = inputString.substr(start, pos - start);
-            addToken(isFloat ? TK_Float : TK_Integer, number, startColumn);
+            std::string_view number = input.substr(start, pos - start);
+
+            // Decode now so later stages never parse number text again.
+            NumericLiteral literal = {};
+            literal.token = static_cast<std::uint32_t>(tokens.size());
+            Numbers::ParseStatus status = Numbers::NP_Malformed;
+            if (decimalPoints == 0)
+            {
+                status = Numbers::parseInteger(number, literal.integer);
+            }
+            else if (decimalPoints == 1)
+            {
+                status = Numbers::parseFloat(number, literal.floating);
+            }
+            literal.valid = status == Numbers::NP_Ok;
+
+            if (status == Numbers::NP_Malformed)
+            {
+                addDiagnostic(startColumn, column - 1, arena.concat({"Malformed number '", number, "' (multiple decimal points)"}));
+            }
+            else if (status == Numbers::NP_OutOfRange)
+            {
+                addDiagnostic(startColumn, column - 1, arena.concat({decimalPoints ? "Float literal '" : "Integer literal '", number, "' is out of range"}));
+            }
+
+            literals.push_back(literal);
+            addToken(decimalPoints ? TK_Float : TK_Integer, arena.copyString(number), startColumn, NoSymbol, static_cast<std::uint32_t>(literals.size()));
+            tokens.back().malformed = !literal.valid;
             continue;
         }
 
@@ -123,164 +515,149 @@ std::vector<Token> lex(const std::string &inputString)
             size_t start = pos;
             int startColumn = column;
             pos++;
-            column++;
-            while (pos < inputString.length() && inputString[pos] != '"')
+            while (pos < input.size() && input[pos] != '"' && input[pos] != '\n')
             {
-                if (inputString[pos] == '\\' && pos + 1 < inputString.length())
-                {
-                    pos += 2;
-                    column += 2;
-                }
-                else
-                {
-                    pos++;
-                    column++;
-                }
+                pos += input[pos] == '\\' && pos + 1 < input.size() && input[pos + 1] != '\n' ? 2 : 1;
             }
-            if (pos >= inputString.length())
+            bool terminated = pos < input.size() && input[pos] == '"';
+            if (terminated)
             {
-                Utils::general_log("Error: Unterminated string at line " + std::to_string(line) + ", column " + std::to_string(startColumn), logBool);
-                break;
+                pos++;
             }
-            pos++;
-            column++;
-            std::string str = inputString.substr(start, pos - start);
-            addToken(TK_String, str, startColumn);
-            continue;
-        }
-
-        // Operators and punctuation
-        std::string op(1, currentChar);
-        if (pos + 1 < inputString.length())
-        {
-            std::string doubleOp = op + inputString[pos + 1];
-            auto it = operators.find(doubleOp);
-            if (it != operators.end())
+            column += width(start, pos);
+            if (!terminated)
             {
-                addToken(it->second, doubleOp, column);
-                pos += 2;
-                column += 2;
-                continue;
+                // The string ends with its line, so the next line is lexed normally.
+                addDiagnostic(startColumn, column - 1, "Unterminated string");
             }
-        }
-        auto it = operators.find(op);
-        if (it != operators.end())
-        {
-            addToken(it->second, op, column);
-            pos++;
-            column++;
+            addToken(TK_String, arena.copyString(input.substr(start, pos - start)), startColumn);
+            tokens.back().malformed = !terminated;
             continue;
         }
 
-        // Other single-character tokens
+        // Operators and punctuation: the longest match wins ("<=" over "<").
+        char nextChar = pos + 1 < input.size() ? input[pos + 1] : '\0';
+        TokenKind kind = TK_Unknown;
+        size_t length = 1;
         switch (currentChar)
         {
         case ';':
-            addToken(TK_Semicolon, ";", column);
+            kind = TK_Semicolon;
+            break;
+        case ',':
+            kind = TK_Comma;
             break;
         case '(':
-            addToken(TK_OpenParen, "(", column);
+            kind = TK_OpenParen;
             break;
         case ')':
-            addToken(TK_CloseParen, ")", column);
+            kind = TK_CloseParen;
             break;
         case '{':
-            addToken(TK_OpenBrace, "{", column);
+            kind = TK_OpenBrace;
             break;
         case '}':
-            addToken(TK_CloseBrace, "}", column);
+            kind = TK_CloseBrace;
             break;
-        case ',':
-            addToken(TK_Comma, ",", column);
+        case '+':
+            kind = TK_Plus;
+            break;
+        case '-':
+            kind = TK_Minus;
+            break;
+        case '*':
+            kind = TK_Star;
+            break;
+        case '/':
+            kind = TK_Slash;
+            break;
+        case '%':
+            kind = TK_Percent;
+            break;
+        case '=':
+            kind = nextChar == '=' ? TK_EqualEqual : TK_EqualsSign;
+            break;
+        case '!':
+            kind = nextChar == '=' ? TK_NotEqual : TK_Not;
+            break;
+        case '<':
+            kind = nextChar == '=' ? TK_LessEqual : TK_Less;
+            break;
+        case '>':
+            kind = nextChar == '=' ? TK_GreaterEqual : TK_Greater;
+            break;
+        case '&':
+            kind = nextChar == '&' ? TK_AndAnd : TK_Unknown;
+            break;
+        case '|':
+            kind = nextChar == '|' ? TK_OrOr : TK_Unknown;
             break;
         default:
-            Utils::general_log("Error: Unknown character '" + std::string(1, currentChar) + "' at line " + std::to_string(line) + ", column " + std::to_string(column), logBool);
-            addToken(TK_Unknown, std::string(1, currentChar), column);
+            break;
+        }
+
+        // The column moves past the token before it is added, so that end_column is its last column.
+        int startColumn = column;
+        if (kind == TK_Unknown)
+        {
+            // A whole UTF-8 character is one token; invalid bytes were reported up front, one at a time.
+            length = multibyte && sequence ? static_cast<size_t>(sequence) : 1;
+            column += countCodepoints || length == 1 ? 1 : static_cast<int>(length);
+            std::string_view text = arena.copyString(input.substr(pos, length));
+            if (!multibyte || sequence)
+            {
+                addDiagnostic(startColumn, startColumn, arena.concat({"Unknown character '", text, "'"}));
+            }
+            addToken(TK_Unknown, text, startColumn);
+            tokens.back().malformed = true;
         }
-        pos++;
-        column++;
+        else
+        {
+            // Operator values point at static spellings, so only literals are copied.
+            std::string_view spelling = tokenSpellings[kind];
+            length = spelling.size();
+            column += static_cast<int>(length);
+            addToken(kind, spelling, startColumn);
+        }
+        pos += length;
+    }
+
+    if (reportedUtf8 != 0)
+    {
+        // Keep diagnostics in source order.
+        std::inplace_merge(diagnostics.begin(), diagnostics.begin() + static_cast<std::ptrdiff_t>(reportedUtf8), diagnostics.end(),
+                           [](const Diagnostic &a, const Diagnostic &b)
+                           { return a.line < b.line || (a.line == b.line && a.start_column < b.start_column); });
     }
 
     return tokens;
 }
 
+/**
+ * @brief Name of a token kind as shown by display_tokens
+ * @param kind The kind
+ * @return Static string; "Unknown" for out-of-range values
+ */
+const char *tokenKindName(TokenKind kind)
+{
+    return kind < TK_KindCount ? tokenKindNames[kind] : "Unknown";
+}
+
 /**
  * @brief Display the generated tokens
  * @param tokens Vector of tokens to be displayed
  */
 void display_tokens(const std::vector<Token> &tokens)
 {
+    BASSIL_TRACE_SCOPE("display_tokens");
     Utils::general_log("[display_tokens] Displaying tokens:", logBool);
     for (const auto &token : tokens)
     {
-        std::string tokenType;
-        switch (token.type)
-        {
-        case TK_Identifier:
-            tokenType = "Identifier";
-            break;
-        case TK_Argument:
-            tokenType = "Argument";
-            break;
-        case TK_String:
-            tokenType = "String";
-            break;
-        case TK_Semicolon:
-            tokenType = "Semicolon";
-            break;
-        case TK_Integer:
-            tokenType = "Integer";
-            break;
-        case TK_Float:
-            tokenType = "Float";
-            break;
-        case TK_MathOperator:
-            tokenType = "MathOperator";
-            break;
-        case TK_EqualsSign:
-            tokenType = "EqualsSign";
-            break;
-        case TK_TypeInteger:
-            tokenType = "TypeInteger";
-            break;
-        case TK_TypeChar:
-            tokenType = "TypeChar";
-            break;
-        case TK_TypeFloat:
-            tokenType = "TypeFloat";
-            break;
-        case TK_TypeString:
-            tokenType = "TypeString";
-            break;
-        case TK_OpenParen:
-            tokenType = "OpenParen";
-            break;
-        case TK_CloseParen:
-            tokenType = "CloseParen";
-            break;
-        case TK_OpenBrace:
-            tokenType = "OpenBrace";
-            break;
-        case TK_CloseBrace:
-            tokenType = "CloseBrace";
-            break;
-        case TK_Comma:
-            tokenType = "Comma";
-            break;
-        case TK_LogicalOperator:
-            tokenType = "LogicalOperator";
-            break;
-        case TK_ComparisonOperator:
-            tokenType = "ComparisonOperator";
-            break;
-        case TK_Unknown:
-            tokenType = "Unknown";
-            break;
-        }
+        std::string tokenType = tokenKindName(token.type);
         Utils::general_log("Token at line " + std::to_string(token.line) +
                                ", columns " + std::to_string(token.start_column) +
                                "-" + std::to_string(token.end_column) + ": " +
-                               tokenType + ": " + token.value,
+                               tokenType + ": " + std::string(token.value),
                            logBool);
     }
 }
@@ -291,6 +668,7 @@ void display_tokens(const std::vector<Token> &tokens)
  */
 void save_tokens(const std::vector<Token> &tokens, const std::string &filename)
 {
+    BASSIL_TRACE_SCOPE("save_tokens");
     Utils::general_log("[save_tokens] Saving tokens:", logBool);
     std::ofstream outputFile(filename, std::ios::app);
     if (!outputFile.is_open())
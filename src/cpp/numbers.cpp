@@ -0,0 +1,325 @@
+/**
+ * @file numbers.cpp
+ * @brief Implementation of the numeric literal decoders.
+ */
+
+#include "../headers/numbers.h"
+#include "../headers/pow5_table.h"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace Numbers
+{
+    namespace
+    {
+        struct U128
+        {
+            std::uint64_t low;
+            std::uint64_t high;
+        };
+
+        U128 multiply(std::uint64_t a, std::uint64_t b)
+        {
+#if defined(__SIZEOF_INT128__)
+            unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+            return {static_cast<std::uint64_t>(product), static_cast<std::uint64_t>(product >> 64)};
+#elif defined(_MSC_VER) && defined(_M_X64)
+            U128 result;
+            result.low = _umul128(a, b, &result.high);
+            return result;
+#else
+            std::uint64_t aLow = a & 0xFFFFFFFF, aHigh = a >> 32;
+            std::uint64_t bLow = b & 0xFFFFFFFF, bHigh = b >> 32;
+            std::uint64_t lowLow = aLow * bLow;
+            std::uint64_t highLow = aHigh * bLow;
+            std::uint64_t lowHigh = aLow * bHigh;
+            std::uint64_t highHigh = aHigh * bHigh;
+            std::uint64_t middle = (lowLow >> 32) + (highLow & 0xFFFFFFFF) + lowHigh;
+            return {(middle << 32) | (lowLow & 0xFFFFFFFF), highHigh + (highLow >> 32) + (middle >> 32)};
+#endif
+        }
+
+        int leadingZeroes(std::uint64_t x)
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_clzll(x);
+#else
+            int n = 0;
+            while (!(x & 0x8000000000000000ull))
+            {
+                x <<= 1;
+                n++;
+            }
+            return n;
+#endif
+        }
+
+        bool isLittleEndian()
+        {
+            const std::uint16_t probe = 1;
+            unsigned char first;
+            std::memcpy(&first, &probe, 1);
+            return first == 1;
+        }
+
+        const bool littleEndian = isLittleEndian();
+
+        /**
+         * @brief True if all eight bytes of a little-endian word are ASCII digits.
+         */
+        bool isEightDigits(std::uint64_t chunk)
+        {
+            return ((chunk & 0xF0F0F0F0F0F0F0F0ull) |
+                    (((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull;
+        }
+
+        /**
+         * @brief Converts eight ASCII digits (little-endian word) with three multiplications.
+         */
+        std::uint32_t parseEightDigits(std::uint64_t chunk)
+        {
+            const std::uint64_t mask = 0x000000FF000000FFull;
+            const std::uint64_t mul1 = 0x000F424000000064ull; // 100 + (1000000 << 32)
+            const std::uint64_t mul2 = 0x0000271000000001ull; // 1 + (10000 << 32)
+            chunk -= 0x3030303030303030ull;
+            chunk = (chunk * 10) + (chunk >> 8);
+            chunk = (((chunk & mask) * mul1) + (((chunk >> 16) & mask) * mul2)) >> 32;
+            return static_cast<std::uint32_t>(chunk);
+        }
+
+        /**
+         * @brief Accumulates the digits of [p, end) into value, eight at a time where possible.
+         * @return const char* The first non-digit.
+         */
+        const char *accumulateDigits(const char *p, const char *end, std::uint64_t &value)
+        {
+            if (littleEndian)
+            {
+                std::uint64_t chunk;
+                while (end - p >= 8 && (std::memcpy(&chunk, p, 8), isEightDigits(chunk)))
+                {
+                    value = value * 100000000 + parseEightDigits(chunk);
+                    p += 8;
+                }
+            }
+            while (p != end && static_cast<unsigned char>(*p - '0') < 10)
+            {
+                value = value * 10 + static_cast<unsigned>(*p - '0');
+                p++;
+            }
+            return p;
+        }
+
+        const double exactPowersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                           1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+        ParseStatus fallback(std::string_view text, double &value)
+        {
+            auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+            if (result.ec == std::errc::result_out_of_range)
+            {
+                return NP_OutOfRange;
+            }
+            return result.ec == std::errc() && result.ptr == text.data() + text.size() ? NP_Ok : NP_Malformed;
+        }
+    }
+
+    ParseStatus parseInteger(std::string_view text, std::int64_t &value)
+    {
+        value = 0;
+        const char *p = text.data();
+        const char *end = p + text.size();
+        if (p == end)
+        {
+            return NP_Malformed;
+        }
+
+        while (p != end && *p == '0')
+        {
+            p++;
+        }
+
+        // 19 digits always fit in 64 unsigned bits; more are out of range for int64.
+        if (end - p > 19)
+        {
+            for (const char *q = p; q != end; q++)
+            {
+                if (static_cast<unsigned char>(*q - '0') >= 10)
+                {
+                    return NP_Malformed;
+                }
+            }
+            return NP_OutOfRange;
+        }
+
+        std::uint64_t magnitude = 0;
+        if (accumulateDigits(p, end, magnitude) != end)
+        {
+            return NP_Malformed;
+        }
+        if (magnitude > static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()))
+        {
+            return NP_OutOfRange;
+        }
+
+        value = static_cast<std::int64_t>(magnitude);
+        return NP_Ok;
+    }
+
+    bool eiselLemire(std::uint64_t w, int q, double &value)
+    {
+        const int mantissaBits = 52;
+        const int minimumExponent = -1023;
+        const int infinitePower = 0x7FF;
+
+        std::uint64_t mantissa;
+        int power2;
+
+        if (w == 0 || q < pow5SmallestPower)
+        {
+            value = 0.0;
+            return true;
+        }
+        if (q > pow5LargestPower)
+        {
+            value = std::numeric_limits<double>::infinity();
+            return true;
+        }
+
+        int lz = leadingZeroes(w);
+        w <<= lz;
+
+        // w * 5^q, keeping the top 128 bits; a second multiplication refines it
+        // only when the bits below the rounding position might carry.
+        const std::uint64_t *power = pow5Table[q - pow5SmallestPower];
+        const std::uint64_t precisionMask = 0xFFFFFFFFFFFFFFFFull >> (mantissaBits + 3);
+        U128 product = multiply(w, power[0]);
+        if ((product.high & precisionMask) == precisionMask)
+        {
+            U128 second = multiply(w, power[1]);
+            product.low += second.high;
+            if (second.high > product.low)
+            {
+                product.high++;
+            }
+        }
+        if (product.low == 0xFFFFFFFFFFFFFFFFull && (q < -27 || q > 55))
+        {
+            return false; // Cannot tell which way to round
+        }
+
+        int upperBit = static_cast<int>(product.high >> 63);
+        int shift = upperBit + 64 - mantissaBits - 3;
+        mantissa = product.high >> shift;
+        power2 = (((152170 + 65536) * q) >> 16) + 63 + upperBit - lz - minimumExponent;
+
+        if (power2 <= 0)
+        {
+            // Subnormal result
+            if (-power2 + 1 >= 64)
+            {
+                value = 0.0;
+                return true;
+            }
+            mantissa >>= -power2 + 1;
+            mantissa += (mantissa & 1);
+            mantissa >>= 1;
+            power2 = mantissa < (std::uint64_t(1) << mantissaBits) ? 0 : 1;
+        }
+        else
+        {
+            // Exactly halfway between two doubles: round to even.
+            if (product.low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == product.high)
+            {
+                mantissa &= ~std::uint64_t(1);
+            }
+            mantissa += (mantissa & 1);
+            mantissa >>= 1;
+            if (mantissa >= (std::uint64_t(2) << mantissaBits))
+            {
+                mantissa = std::uint64_t(1) << mantissaBits;
+                power2++;
+            }
+            mantissa &= ~(std::uint64_t(1) << mantissaBits);
+            if (power2 >= infinitePower)
+            {
+                value = std::numeric_limits<double>::infinity();
+                return true;
+            }
+        }
+
+        std::uint64_t bits = mantissa | (static_cast<std::uint64_t>(power2) << mantissaBits);
+        std::memcpy(&value, &bits, sizeof(value));
+        return true;
+    }
+
+    ParseStatus parseFloat(std::string_view text, double &value)
+    {
+        value = 0.0;
+        const char *p = text.data();
+        const char *end = p + text.size();
+
+        while (p != end && *p == '0')
+        {
+            p++;
+        }
+
+        std::uint64_t w = 0;
+        const char *integerStart = p;
+        p = accumulateDigits(p, end, w);
+        int integerDigits = static_cast<int>(p - integerStart);
+        int fractionDigits = 0;
+        int significantDigits = integerDigits;
+
+        if (p != end && *p == '.')
+        {
+            p++;
+            const char *fractionStart = p;
+            if (w == 0)
+            {
+                // 0.000123: leading fraction zeros only move the exponent.
+                while (p != end && *p == '0')
+                {
+                    p++;
+                }
+            }
+            const char *digitsStart = p;
+            p = accumulateDigits(p, end, w);
+            fractionDigits = static_cast<int>(p - fractionStart);
+            significantDigits += static_cast<int>(p - digitsStart);
+        }
+
+        if (p != end || text.empty())
+        {
+            return NP_Malformed;
+        }
+
+        if (significantDigits > 19)
+        {
+            // w wrapped; let the exact slow path handle long literals.
+            return fallback(text, value);
+        }
+
+        int q = -fractionDigits;
+
+        // Clinger: both operands are exact doubles, so one IEEE operation rounds correctly.
+        if (w <= (std::uint64_t(1) << 53) && q >= -22 && q <= 22)
+        {
+            double significand = static_cast<double>(w);
+            value = q < 0 ? significand / exactPowersOfTen[-q] : significand * exactPowersOfTen[q];
+            return NP_Ok;
+        }
+
+        if (!eiselLemire(w, q, value))
+        {
+            return fallback(text, value);
+        }
+        return std::isinf(value) ? NP_OutOfRange : NP_Ok;
+    }
+}
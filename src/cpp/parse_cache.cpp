@@ -0,0 +1,718 @@
+/**
+ * @file parse_cache.cpp
+ * @brief Implementation of the on-disk parse cache.
+ */
+
+#include "../headers/parse_cache.h"
+#include "../headers/interner.h"
+#include "../headers/trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    constexpr std::uint32_t Magic = 0x4C534142; ///< "BASL" in the byte order of the writer
+
+    typedef enum : std::uint8_t
+    {
+        S_Tokens,
+        S_Literals,
+        S_Kinds,
+        S_NodeTokens,
+        S_NodeData,
+        S_Extra,
+        S_Diagnostics,
+        S_Strings,
+        S_Count
+    } Section;
+
+    /**
+     * @brief Bits of the first byte of a token in the tokens section
+     *
+     * Tokens are only ever rebuilt front to back, so the section is a byte
+     * stream rather than records: per token, this byte (kind and flags), then
+     * as varints the line (minus the previous token's), the start column, the
+     * end column minus the start column (zigzag), a text reference and the
+     * text length in bytes. The reference is 0 for text stored right after
+     * the previous token's new text, and 1 + its offset in the string table
+     * for text seen before (names, keywords, operators). A token takes about
+     * 7 bytes instead of a 24-byte record.
+     */
+    typedef enum : std::uint8_t
+    {
+        TB_KindMask = 0x3F,  ///< TokenKind
+        TB_Malformed = 0x40, ///< Token::malformed
+        TB_Interned = 0x80   ///< Has a symbol: a name or keyword
+    } TokenByte;
+
+    static_assert(static_cast<unsigned>(TK_KindCount) <= TB_KindMask, "a token kind fits in the token byte");
+
+    typedef struct
+    {
+        std::uint32_t token;
+        std::uint32_t valid;
+        std::int64_t bits; ///< NumericLiteral::integer, or the bits of NumericLiteral::floating
+    } CachedLiteral;
+
+    typedef struct
+    {
+        std::int32_t line;
+        std::int32_t startColumn;
+        std::int32_t endColumn;
+        std::uint32_t message; ///< Offset in the string table
+        std::uint32_t length;
+    } CachedDiagnostic;
+
+    static_assert(sizeof(CachedLiteral) == 16 && sizeof(CachedDiagnostic) == 20, "records have no padding");
+    static_assert(sizeof(NodeData) == 8, "node data is two words");
+
+    constexpr std::uint64_t alignUp(std::uint64_t offset) { return (offset + 7) & ~std::uint64_t(7); }
+
+    inline std::uint64_t load64(const char *p)
+    {
+        std::uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        return word;
+    }
+
+    inline std::uint64_t rotate(std::uint64_t value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+
+    constexpr size_t MaxTokenBytes = 1 + 5 * 10; ///< Token byte and five 64-bit varints
+
+    inline void putVarint(char *&out, std::uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            *out++ = static_cast<char>(value | 0x80);
+            value >>= 7;
+        }
+        *out++ = static_cast<char>(value);
+    }
+
+    constexpr std::uint64_t zigzag(std::int64_t value) { return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63); }
+    constexpr std::int64_t unzigzag(std::uint64_t value) { return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1); }
+
+    /**
+     * @brief Reads the tokens section.
+     */
+    class StreamReader
+    {
+    public:
+        StreamReader(const char *data, std::uint64_t size)
+            : p(reinterpret_cast<const unsigned char *>(data)), end(p + size) {}
+
+        std::uint8_t byte()
+        {
+            if (p == end)
+            {
+                throw std::runtime_error("[ParseCache::Entry] Tokens section ends early");
+            }
+            return *p++;
+        }
+
+        std::uint64_t varint()
+        {
+            std::uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                std::uint8_t next = byte();
+                value |= std::uint64_t(next & 0x7F) << shift;
+                if (next < 0x80)
+                {
+                    return value;
+                }
+            }
+            throw std::runtime_error("[ParseCache::Entry] Bad varint in the tokens section");
+        }
+
+    private:
+        const unsigned char *p;
+        const unsigned char *end;
+    };
+
+    /// Final avalanche of splitmix64.
+    inline std::uint64_t mix(std::uint64_t value)
+    {
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+        return value ^ (value >> 31);
+    }
+
+    /**
+     * @brief Collects the strings of the strings section.
+     *
+     * Token text comes from a few places: names and keywords from the
+     * interner, operators from static spellings, literals from the arena. So
+     * shared strings are told apart by address, which finds every repeated
+     * name and operator without hashing or comparing any text, and text that
+     * is never shared (literals) is appended without a lookup.
+     */
+    class StringTable
+    {
+    public:
+        /**
+         * @return std::uint32_t Offset of the string in the table.
+         * @throw std::length_error once the table passes 4 GB.
+         */
+        std::uint32_t add(std::string_view text)
+        {
+            if (2 * (used + 1) > slots.size())
+            {
+                grow();
+            }
+            size_t mask = slots.size() - 1;
+            for (size_t i = slotOf(text.data()) & mask;; i = (i + 1) & mask)
+            {
+                Slot &slot = slots[i];
+                if (slot.text == text.data() && slot.length == text.size())
+                {
+                    return slot.offset;
+                }
+                if (!slot.text)
+                {
+                    slot = {text.data(), text.size(), append(text)};
+                    used++;
+                    return slot.offset;
+                }
+            }
+        }
+
+        /**
+         * @return std::uint32_t Offset of the string, stored again even if it is already in the table.
+         */
+        std::uint32_t append(std::string_view text)
+        {
+            if (bytes.size() + text.size() > UINT32_MAX)
+            {
+                throw std::length_error("[ParseCache::store] String table over 4 GB");
+            }
+            std::uint32_t offset = static_cast<std::uint32_t>(bytes.size());
+            bytes.append(text);
+            return offset;
+        }
+
+        std::string bytes;
+
+    private:
+        struct Slot
+        {
+            const char *text = nullptr;
+            size_t length = 0;
+            std::uint32_t offset = 0;
+        };
+
+        static size_t slotOf(const char *text)
+        {
+            return static_cast<size_t>((reinterpret_cast<std::uintptr_t>(text) * 0x9E3779B97F4A7C15ull) >> 20);
+        }
+
+        void grow()
+        {
+            std::vector<Slot> old(std::max<size_t>(1024, slots.size() * 2));
+            old.swap(slots);
+            size_t mask = slots.size() - 1;
+            for (const Slot &slot : old)
+            {
+                if (slot.text)
+                {
+                    size_t i = slotOf(slot.text) & mask;
+                    while (slots[i].text)
+                    {
+                        i = (i + 1) & mask;
+                    }
+                    slots[i] = slot;
+                }
+            }
+        }
+
+        std::vector<Slot> slots;
+        size_t used = 0;
+    };
+
+    /// Whether every node has a valid kind and token, and children in range that precede it, ending at a Program root.
+    bool wellFormed(const AstView &tree, std::uint32_t extraCount, std::uint32_t tokenCount)
+    {
+        for (NodeIndex node = 0; node < tree.size(); node++)
+        {
+            if (tree.kinds[node] >= NK_KindCount || tree.tokens[node] >= tokenCount)
+            {
+                return false;
+            }
+            const NodeData &data = tree.data[node];
+            if (childLayout(tree.kinds[node]) == CL_Extra &&
+                std::uint64_t(data.word[0]) + data.word[1] > extraCount)
+            {
+                return false;
+            }
+            for (NodeIndex child : tree.children(node))
+            {
+                if (child >= node)
+                {
+                    return false;
+                }
+            }
+        }
+        return tree.kind(tree.root()) == NK_Program;
+    }
+
+    /**
+     * @brief Start of an image (see the layout in parse_cache.h)
+     */
+    struct Header
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint64_t sourceHash;
+        std::uint64_t sourceSize;
+        std::uint32_t columnMode;
+        std::uint32_t tokenCount;
+        std::uint32_t literalCount;
+        std::uint32_t nodeCount;
+        std::uint32_t extraCount;
+        std::uint32_t diagnosticCount;
+        std::uint32_t stringBytes;
+        std::uint32_t reserved;
+        std::uint64_t tokenBytes;
+        std::uint64_t sections[S_Count]; ///< Offset of each section from the start of the image
+        std::uint64_t imageSize;
+        std::uint64_t checksum;          ///< hashSource() of the image after the header
+
+        /// Bytes of a section, from the counts.
+        std::uint64_t sectionBytes(Section section) const
+        {
+            switch (section)
+            {
+            case S_Tokens:
+                return tokenBytes;
+            case S_Literals:
+                return std::uint64_t(literalCount) * sizeof(CachedLiteral);
+            case S_Kinds:
+                return std::uint64_t(nodeCount) * sizeof(NodeKind);
+            case S_NodeTokens:
+                return std::uint64_t(nodeCount) * sizeof(std::uint32_t);
+            case S_NodeData:
+                return std::uint64_t(nodeCount) * sizeof(NodeData);
+            case S_Extra:
+                return std::uint64_t(extraCount) * sizeof(NodeIndex);
+            case S_Diagnostics:
+                return std::uint64_t(diagnosticCount) * sizeof(CachedDiagnostic);
+            default:
+                return stringBytes;
+            }
+        }
+    };
+
+    const Header &headerOf(const char *image) { return *reinterpret_cast<const Header *>(image); }
+}
+
+namespace ParseCache
+{
+    std::uint64_t hashSource(std::string_view content)
+    {
+        constexpr std::uint64_t Prime1 = 0x9E3779B185EBCA87ull;
+        constexpr std::uint64_t Prime2 = 0xC2B2AE3D27D4EB4Full;
+        std::uint64_t lanes[4] = {Prime1 + Prime2, Prime2, 0, 0 - Prime1};
+        const char *p = content.data();
+        const char *end = p + content.size();
+        for (; end - p >= 32; p += 32)
+        {
+            for (int lane = 0; lane < 4; lane++)
+            {
+                lanes[lane] = rotate(lanes[lane] + load64(p + 8 * lane) * Prime2, 31) * Prime1;
+            }
+        }
+
+        std::uint64_t hash = rotate(lanes[0], 1) + rotate(lanes[1], 7) + rotate(lanes[2], 12) + rotate(lanes[3], 18);
+        hash ^= content.size() * Prime1;
+        for (; end - p >= 8; p += 8)
+        {
+            hash = rotate(hash ^ load64(p) * Prime2, 27) * Prime1;
+        }
+        for (; p < end; p++)
+        {
+            hash = rotate(hash ^ static_cast<unsigned char>(*p) * Prime1, 11) * Prime2;
+        }
+        return mix(hash);
+    }
+
+    std::string entryPath(const std::string &directory, std::uint64_t hash, ColumnMode columnMode)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx-%u.bast", static_cast<unsigned long long>(hash), static_cast<unsigned>(columnMode));
+        return (fs::path(directory) / name).string();
+    }
+
+    Entry::~Entry()
+    {
+#ifndef _WIN32
+        if (mapped)
+        {
+            munmap(const_cast<char *>(image), imageSize);
+        }
+#endif
+    }
+
+    std::shared_ptr<const Entry> Entry::open(const std::string &directory, std::uint64_t hash, std::uint64_t sourceSize, ColumnMode columnMode)
+    {
+        BASSIL_TRACE_SCOPE("ParseCache::open");
+        std::string path = entryPath(directory, hash, columnMode);
+        std::shared_ptr<Entry> entry(new Entry());
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+        struct stat status;
+        if (fstat(fd, &status) != 0 || static_cast<std::uint64_t>(status.st_size) < sizeof(Header))
+        {
+            ::close(fd);
+            return nullptr;
+        }
+        void *image = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (image == MAP_FAILED)
+        {
+            return nullptr;
+        }
+        entry->image = static_cast<const char *>(image);
+        entry->imageSize = static_cast<size_t>(status.st_size);
+        entry->mapped = true;
+#else
+        // No mmap(): read the image into 8-byte aligned memory, which is used the same way.
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open() || static_cast<std::uint64_t>(file.tellg()) < sizeof(Header))
+        {
+            return nullptr;
+        }
+        entry->imageSize = static_cast<size_t>(file.tellg());
+        entry->buffer.resize((entry->imageSize + 7) / 8);
+        file.seekg(0);
+        file.read(reinterpret_cast<char *>(entry->buffer.data()), static_cast<std::streamsize>(entry->imageSize));
+        if (!file)
+        {
+            return nullptr;
+        }
+        entry->image = reinterpret_cast<const char *>(entry->buffer.data());
+#endif
+
+        const Header &header = headerOf(entry->image);
+        if (header.magic != Magic || header.version != FormatVersion || header.sourceHash != hash ||
+            header.sourceSize != sourceSize || header.columnMode != static_cast<std::uint32_t>(columnMode) ||
+            header.imageSize != entry->imageSize || header.nodeCount == 0)
+        {
+            return nullptr;
+        }
+        for (int section = 0; section < S_Count; section++)
+        {
+            std::uint64_t offset = header.sections[section];
+            if (offset % 8 != 0 || offset < sizeof(Header) || offset > entry->imageSize ||
+                header.sectionBytes(static_cast<Section>(section)) > entry->imageSize - offset)
+            {
+                return nullptr;
+            }
+        }
+
+        // The tree is used in place by every pass, so a damaged image must not get that far: the
+        // checksum catches changed bytes, and the tree must be well formed whatever its bytes say.
+        if (hashSource(std::string_view(entry->image + sizeof(Header), entry->imageSize - sizeof(Header))) != header.checksum ||
+            !wellFormed(entry->tree(), header.extraCount, header.tokenCount))
+        {
+            return nullptr;
+        }
+        return entry;
+    }
+
+    std::uint32_t Entry::tokenCount() const
+    {
+        return headerOf(image).tokenCount;
+    }
+
+    AstView Entry::tree() const
+    {
+        const Header &h = headerOf(image);
+        return {reinterpret_cast<const NodeKind *>(image + h.sections[S_Kinds]),
+                reinterpret_cast<const std::uint32_t *>(image + h.sections[S_NodeTokens]),
+                reinterpret_cast<const NodeData *>(image + h.sections[S_NodeData]),
+                reinterpret_cast<const NodeIndex *>(image + h.sections[S_Extra]),
+                h.nodeCount};
+    }
+
+    std::string_view Entry::string(std::uint32_t offset, std::uint32_t length) const
+    {
+        const Header &h = headerOf(image);
+        if (offset > h.stringBytes || length > h.stringBytes - offset)
+        {
+            throw std::runtime_error("[ParseCache::Entry] String outside the string table");
+        }
+        return std::string_view(image + h.sections[S_Strings] + offset, length);
+    }
+
+    std::vector<Diagnostic> Entry::diagnostics() const
+    {
+        const Header &h = headerOf(image);
+        const CachedDiagnostic *records = reinterpret_cast<const CachedDiagnostic *>(image + h.sections[S_Diagnostics]);
+        std::vector<Diagnostic> result;
+        result.reserve(h.diagnosticCount);
+        for (std::uint32_t i = 0; i < h.diagnosticCount; i++)
+        {
+            const CachedDiagnostic &record = records[i];
+            result.push_back({record.line, record.startColumn, record.endColumn, string(record.message, record.length)});
+        }
+        return result;
+    }
+
+    std::vector<Token> Entry::tokens() const
+    {
+        BASSIL_TRACE_SCOPE("ParseCache::tokens");
+        const Header &h = headerOf(image);
+        StreamReader in(image + h.sections[S_Tokens], h.tokenBytes);
+        Interner &interner = Interner::global();
+        std::vector<Token> result;
+        result.reserve(h.tokenCount);
+        std::int64_t line = 0;
+        std::uint64_t cursor = 0;
+        for (std::uint32_t i = 0; i < h.tokenCount; i++)
+        {
+            std::uint8_t bits = in.byte();
+            line += unzigzag(in.varint());
+            std::int64_t startColumn = static_cast<std::int64_t>(in.varint());
+            std::int64_t endColumn = startColumn + unzigzag(in.varint());
+            std::uint64_t reference = in.varint();
+            std::uint64_t length = in.varint();
+            std::uint64_t offset = reference == 0 ? cursor : reference - 1;
+            if (offset + length > UINT32_MAX)
+            {
+                throw std::runtime_error("[ParseCache::Entry] String outside the string table");
+            }
+            std::string_view text = string(static_cast<std::uint32_t>(offset), static_cast<std::uint32_t>(length));
+            if (reference == 0)
+            {
+                cursor += length;
+            }
+            SymbolId symbol = NoSymbol;
+            if (bits & TB_Interned)
+            {
+                symbol = interner.intern(text);
+                text = interner.name(symbol);
+            }
+            TokenKind type = (bits & TB_KindMask) < TK_KindCount ? static_cast<TokenKind>(bits & TB_KindMask) : TK_Unknown;
+            result.push_back({type, text, static_cast<int>(line), static_cast<int>(startColumn), static_cast<int>(endColumn), symbol, 0, (bits & TB_Malformed) != 0});
+        }
+
+        const CachedLiteral *literals = reinterpret_cast<const CachedLiteral *>(image + h.sections[S_Literals]);
+        for (std::uint32_t i = 0; i < h.literalCount; i++)
+        {
+            if (literals[i].token < result.size())
+            {
+                result[literals[i].token].literal = i + 1;
+            }
+        }
+        return result;
+    }
+
+    std::vector<NumericLiteral> Entry::literals() const
+    {
+        const Header &h = headerOf(image);
+        const CachedLiteral *records = reinterpret_cast<const CachedLiteral *>(image + h.sections[S_Literals]);
+        std::vector<NumericLiteral> result(h.literalCount);
+        for (std::uint32_t i = 0; i < h.literalCount; i++)
+        {
+            result[i].token = records[i].token;
+            result[i].valid = records[i].valid != 0;
+            std::memcpy(&result[i].integer, &records[i].bits, sizeof(records[i].bits));
+        }
+        return result;
+    }
+
+    bool store(const std::string &directory, std::uint64_t hash, std::uint64_t sourceSize, ColumnMode columnMode,
+               const std::vector<Token> &tokens, const std::vector<NumericLiteral> &literals, const Ast &tree,
+               const std::vector<Diagnostic> &diagnostics, std::string &error)
+    {
+        BASSIL_TRACE_SCOPE("ParseCache::store");
+        if (tokens.size() > UINT32_MAX || tree.extra.size() > UINT32_MAX || tree.empty())
+        {
+            error = "file too large for the parse cache";
+            return false;
+        }
+
+        // Tokens are encoded first (see TokenByte), so their new text is the start of the string table.
+        StringTable strings;
+        std::string tokenStream(tokens.size() * 8 + MaxTokenBytes, '\0');
+        size_t streamSize = 0;
+        try
+        {
+            // An operator or punctuation kind always has the same text, kept once per kind.
+            std::uint32_t kindText[TK_KindCount];
+            std::fill(std::begin(kindText), std::end(kindText), UINT32_MAX);
+            int line = 0;
+            for (const Token &token : tokens)
+            {
+                std::uint8_t bits = static_cast<std::uint8_t>(token.type) | (token.malformed ? TB_Malformed : 0) | (token.symbol != NoSymbol ? TB_Interned : 0);
+                size_t before = strings.bytes.size();
+                std::uint32_t offset;
+                if (isPunctuation(token.type) || isOperator(token.type))
+                {
+                    std::uint32_t &known = kindText[token.type];
+                    if (known == UINT32_MAX || std::string_view(strings.bytes).substr(known, token.value.size()) != token.value)
+                    {
+                        known = strings.add(token.value);
+                    }
+                    offset = known;
+                }
+                else
+                {
+                    offset = token.symbol != NoSymbol ? strings.add(token.value) : strings.append(token.value);
+                }
+                bool appended = strings.bytes.size() > before;
+
+                if (tokenStream.size() - streamSize < MaxTokenBytes)
+                {
+                    tokenStream.resize(tokenStream.size() * 2);
+                }
+                char *out = &tokenStream[streamSize];
+                *out++ = static_cast<char>(bits);
+                putVarint(out, zigzag(std::int64_t(token.line) - line));
+                putVarint(out, static_cast<std::uint32_t>(token.start_column));
+                putVarint(out, zigzag(std::int64_t(token.end_column) - token.start_column));
+                putVarint(out, appended ? 0 : std::uint64_t(offset) + 1);
+                putVarint(out, token.value.size());
+                streamSize = static_cast<size_t>(out - tokenStream.data());
+                line = token.line;
+            }
+            tokenStream.resize(streamSize);
+        }
+        catch (const std::length_error &e)
+        {
+            error = e.what();
+            return false;
+        }
+
+        // Every section but the strings has a known size now, so the header, which
+        // records their size, is written again once the messages are added.
+        Header header = {};
+        header.magic = Magic;
+        header.version = FormatVersion;
+        header.sourceHash = hash;
+        header.sourceSize = sourceSize;
+        header.columnMode = static_cast<std::uint32_t>(columnMode);
+        header.tokenCount = static_cast<std::uint32_t>(tokens.size());
+        header.literalCount = static_cast<std::uint32_t>(literals.size());
+        header.nodeCount = static_cast<std::uint32_t>(tree.size());
+        header.extraCount = static_cast<std::uint32_t>(tree.extra.size());
+        header.diagnosticCount = static_cast<std::uint32_t>(diagnostics.size());
+        header.tokenBytes = tokenStream.size();
+        std::uint64_t offset = alignUp(sizeof(Header));
+        for (int section = 0; section < S_Count; section++)
+        {
+            header.sections[section] = offset;
+            offset = alignUp(offset + header.sectionBytes(static_cast<Section>(section)));
+        }
+
+        std::error_code ec;
+        fs::create_directories(directory, ec);
+        std::string path = entryPath(directory, hash, columnMode);
+        // Unique per thread and moment, so concurrent writers of the same entry never share a temporary file.
+        std::string temporary = path + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + "-" +
+                                std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+        // The image is built in memory, so that its checksum can go into the header.
+        std::string image;
+        image.reserve(static_cast<size_t>(offset));
+        const char padding[8] = {};
+        auto write = [&](const void *data, std::uint64_t bytes)
+        {
+            image.append(static_cast<const char *>(data), static_cast<size_t>(bytes));
+        };
+        auto endSection = [&](Section section)
+        {
+            std::uint64_t end = section + 1 < S_Count ? header.sections[section + 1] : alignUp(header.sections[section] + header.stringBytes);
+            write(padding, end - image.size());
+        };
+
+        try
+        {
+            write(&header, sizeof(header));
+            write(padding, header.sections[0] - sizeof(header));
+            write(tokenStream.data(), tokenStream.size());
+            endSection(S_Tokens);
+
+            for (const NumericLiteral &literal : literals)
+            {
+                CachedLiteral record = {literal.token, literal.valid ? 1u : 0u, 0};
+                std::memcpy(&record.bits, &literal.integer, sizeof(record.bits));
+                write(&record, sizeof(record));
+            }
+            endSection(S_Literals);
+            write(tree.kinds.data(), header.sectionBytes(S_Kinds));
+            endSection(S_Kinds);
+            write(tree.tokens.data(), header.sectionBytes(S_NodeTokens));
+            endSection(S_NodeTokens);
+            write(tree.data.data(), header.sectionBytes(S_NodeData));
+            endSection(S_NodeData);
+            write(tree.extra.data(), header.sectionBytes(S_Extra));
+            endSection(S_Extra);
+
+            for (const Diagnostic &diagnostic : diagnostics)
+            {
+                CachedDiagnostic record = {diagnostic.line, diagnostic.start_column, diagnostic.end_column,
+                                           strings.add(diagnostic.message), static_cast<std::uint32_t>(diagnostic.message.size())};
+                write(&record, sizeof(record));
+            }
+            endSection(S_Diagnostics);
+        }
+        catch (const std::length_error &e)
+        {
+            error = e.what();
+            return false;
+        }
+
+        header.stringBytes = static_cast<std::uint32_t>(strings.bytes.size());
+        write(strings.bytes.data(), strings.bytes.size());
+        endSection(S_Strings);
+        header.imageSize = image.size();
+        header.checksum = hashSource(std::string_view(image).substr(sizeof(header)));
+        std::memcpy(&image[0], &header, sizeof(header));
+
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+        {
+            error = "unable to write parse cache entry " + temporary;
+            return false;
+        }
+        out.write(image.data(), static_cast<std::streamsize>(image.size()));
+        if (!out.flush())
+        {
+            error = "unable to write parse cache entry " + temporary;
+            out.close();
+            fs::remove(temporary, ec);
+            return false;
+        }
+        out.close();
+
+        fs::rename(temporary, path, ec);
+        if (ec)
+        {
+            error = "unable to write parse cache entry " + path + ": " + ec.message();
+            fs::remove(temporary, ec);
+            return false;
+        }
+        return true;
+    }
+}
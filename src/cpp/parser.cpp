@@ -1 +1,636 @@
-// Coming soon
\ No newline at end of file
+/**
+ * @file parser.cpp
+ * @brief Implementation of the recursive-descent / Pratt parser for the Bassil language.
+ */
+
+#include "../headers/parser.h"
+#include "../headers/trace.h"
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+    // Binding powers, lowest first. An operator binds to its left operand only
+    // if its power exceeds the minimum the caller asked for.
+    constexpr int AssignPower = 1;
+    constexpr int PrefixPower = 8;
+    constexpr int CallPower = 9;
+
+    struct PowerTable
+    {
+        std::uint8_t power[TK_KindCount + 1]; ///< Infix binding power per kind (0: not infix); the extra slot is end of input
+    };
+
+    constexpr PowerTable makePowerTable()
+    {
+        PowerTable table = {};
+        table.power[TK_EqualsSign] = AssignPower;
+        table.power[TK_OrOr] = 2;
+        table.power[TK_AndAnd] = 3;
+        table.power[TK_EqualEqual] = table.power[TK_NotEqual] = 4;
+        table.power[TK_Less] = table.power[TK_Greater] = table.power[TK_LessEqual] = table.power[TK_GreaterEqual] = 5;
+        table.power[TK_Plus] = table.power[TK_Minus] = 6;
+        table.power[TK_Star] = table.power[TK_Slash] = table.power[TK_Percent] = 7;
+        table.power[TK_OpenParen] = CallPower;
+        return table;
+    }
+
+    constexpr PowerTable infixPowers = makePowerTable();
+
+    static_assert(infixPowers.power[TK_Star] > infixPowers.power[TK_Plus], "* binds tighter than +");
+    static_assert(PrefixPower > infixPowers.power[TK_Percent] && PrefixPower < CallPower, "-a * b is (-a) * b, -f(x) is -(f(x))");
+
+    /**
+     * @brief Copies a run's tree, without its NK_Program node, into the merged tree.
+     * @param chunk The run's tree.
+     * @param tree The merged tree, already sized.
+     * @param nodeBase Index of the run's first node in the merged tree.
+     * @param extraBase Index of the run's first extra entry in the merged tree.
+     * @param itemBase Where the run's top-level items go in the merged extra array.
+     */
+    void rebaseChunk(const Ast &chunk, Ast &tree, std::uint32_t nodeBase, std::uint32_t extraBase, std::uint32_t itemBase)
+    {
+        NodeIndex program = chunk.root();
+        ChildRange items = chunk.children(program);
+        size_t ownExtra = chunk.extra.size() - items.size();
+
+        std::copy(chunk.kinds.begin(), chunk.kinds.begin() + program, tree.kinds.begin() + nodeBase);
+        std::copy(chunk.tokens.begin(), chunk.tokens.begin() + program, tree.tokens.begin() + nodeBase);
+        for (NodeIndex node = 0; node < program; node++)
+        {
+            NodeData data = chunk.data[node];
+            switch (childLayout(chunk.kinds[node]))
+            {
+            case CL_None:
+                break;
+            case CL_One:
+                data.word[0] += nodeBase;
+                break;
+            case CL_Two:
+                data.word[0] += nodeBase;
+                data.word[1] += nodeBase;
+                break;
+            case CL_Extra:
+                data.word[0] += extraBase;
+                break;
+            }
+            tree.data[nodeBase + node] = data;
+        }
+        for (size_t i = 0; i < ownExtra; i++)
+        {
+            tree.extra[extraBase + i] = chunk.extra[i] + nodeBase;
+        }
+        for (std::uint32_t i = 0; i < items.size(); i++)
+        {
+            tree.extra[itemBase + i] = items[i] + nodeBase;
+        }
+    }
+}
+
+const Ast &Parser::parse(const std::vector<Token> &input, CompilationArena &messageArena)
+{
+    BASSIL_TRACE_SCOPE("parse");
+    std::uint32_t size = static_cast<std::uint32_t>(input.size());
+    parseRange(input, messageArena, 0, size, size);
+    return treeBuffer;
+}
+
+const Ast &Parser::parseItems(const std::vector<Token> &input, CompilationArena &messageArena, std::uint32_t begin, std::uint32_t end)
+{
+    BASSIL_TRACE_SCOPE("parseItems");
+    parseRange(input, messageArena, begin, end, static_cast<std::uint32_t>(input.size()));
+    return treeBuffer;
+}
+
+const Ast &Parser::parseParallel(const std::vector<Token> &input, CompilationArena &messageArena, ThreadPool &pool)
+{
+    if (input.size() < ParallelMinTokens || pool.size() < 2)
+    {
+        return parse(input, messageArena);
+    }
+
+    BASSIL_TRACE_SCOPE("parseParallel");
+    // A few runs per worker, so one slow run does not leave the others idle.
+    size_t target = std::max(ParallelChunkTokens, input.size() / (pool.size() * 4));
+    if (!findTopLevelChunks(input, target, chunkEnds) || chunkEnds.size() < 2)
+    {
+        return parse(input, messageArena);
+    }
+
+    size_t chunks = chunkEnds.size();
+    if (chunkTrees.size() < chunks)
+    {
+        chunkTrees.resize(chunks);
+    }
+    std::atomic<bool> failed{false};
+    pool.parallelFor(chunks, [&](size_t i)
+                     {
+                         BASSIL_TRACE_SCOPE("parseChunk");
+                         // Messages of a failed run are dropped, so they go to a per-thread scratch arena.
+                         static thread_local Parser chunkParser;
+                         static thread_local CompilationArena chunkMessages(4096);
+                         chunkMessages.reset();
+                         chunkParser.parseRange(input, chunkMessages, i == 0 ? 0 : chunkEnds[i - 1], chunkEnds[i], chunkEnds[i]);
+                         if (!chunkParser.diagnosticBuffer.empty())
+                         {
+                             failed.store(true, std::memory_order_relaxed);
+                         }
+                         std::swap(chunkTrees[i], chunkParser.treeBuffer); });
+    if (failed.load())
+    {
+        return parse(input, messageArena);
+    }
+
+    // Each run's tree ends with its NK_Program node, whose child list is the
+    // last part of its extra array; both are replaced by one root for the file.
+    chunkOffsets.resize(3 * chunks);
+    std::uint32_t nodes = 0, extras = 0, items = 0;
+    for (size_t i = 0; i < chunks; i++)
+    {
+        const Ast &chunk = chunkTrees[i];
+        std::uint32_t chunkItems = chunk.children(chunk.root()).size();
+        chunkOffsets[3 * i] = nodes;
+        chunkOffsets[3 * i + 1] = extras;
+        chunkOffsets[3 * i + 2] = items;
+        nodes += static_cast<std::uint32_t>(chunk.size() - 1);
+        extras += static_cast<std::uint32_t>(chunk.extra.size() - chunkItems);
+        items += chunkItems;
+    }
+
+    diagnosticBuffer.clear();
+    itemBuffer.clear();
+    treeBuffer.kinds.resize(nodes);
+    treeBuffer.tokens.resize(nodes);
+    treeBuffer.data.resize(nodes);
+    treeBuffer.extra.resize(extras + items);
+    pool.parallelFor(chunks, [&](size_t i)
+                     { rebaseChunk(chunkTrees[i], treeBuffer, chunkOffsets[3 * i], chunkOffsets[3 * i + 1], extras + chunkOffsets[3 * i + 2]); });
+    treeBuffer.kinds.push_back(NK_Program);
+    treeBuffer.tokens.push_back(0);
+    treeBuffer.data.push_back({{extras, items}});
+    return treeBuffer;
+}
+
+void Parser::parseRange(const std::vector<Token> &input, CompilationArena &messageArena, std::uint32_t begin, std::uint32_t end, std::uint32_t limit)
+{
+    tokens = &input;
+    arena = &messageArena;
+    position = begin;
+    count = limit;
+    depth = 0;
+    scratch.clear();
+    diagnosticBuffer.clear();
+    itemBuffer.clear();
+    treeBuffer.clear();
+
+    while (position < end)
+    {
+        size_t items = scratch.size();
+        itemBuffer.push_back({position, NoNode, static_cast<std::uint32_t>(diagnosticBuffer.size())});
+        parseItem(true);
+        if (scratch.size() != items)
+        {
+            itemBuffer.back().node = scratch.back();
+        }
+    }
+
+    makeNode(NK_Program, begin, size_t(0));
+}
+
+void Parser::parseItem(bool topLevel)
+{
+    std::uint32_t start = position;
+    size_t scratchSize = scratch.size();
+    size_t nodes = treeBuffer.size();
+    size_t extraSize = treeBuffer.extra.size();
+    if (topLevel && peek() == TK_CloseBrace)
+    {
+        report(position, "Unmatched '}'");
+        position++;
+        return;
+    }
+
+    try
+    {
+        scratch.push_back(topLevel && peek() == TK_Function ? parseFunction() : parseStatement());
+    }
+    catch (const Abort &)
+    {
+        // Drop everything the broken statement added, then skip to where the next one can start.
+        scratch.resize(scratchSize);
+        treeBuffer.truncate(nodes, extraSize);
+        synchronize(start, !topLevel);
+    }
+}
+
+void Parser::synchronize(std::uint32_t statementStart, bool insideBlock)
+{
+    int braces = 0;
+    while (position < count)
+    {
+        TokenKind kind = peek();
+        if (braces == 0)
+        {
+            if (kind == TK_Semicolon)
+            {
+                position++;
+                return;
+            }
+            if (kind == TK_CloseBrace)
+            {
+                if (!insideBlock)
+                {
+                    position++; // A stray '}' at the top level ends the broken statement
+                }
+                return;
+            }
+            // Resuming at the statement that failed would fail again.
+            bool startsStatement = kind == TK_If || kind == TK_For || kind == TK_Return || kind == TK_Function || isTypeKeyword(kind);
+            if (startsStatement && position != statementStart)
+            {
+                return;
+            }
+        }
+
+        if (kind == TK_OpenBrace)
+        {
+            braces++;
+        }
+        else if (kind == TK_CloseBrace && --braces == 0)
+        {
+            // A skipped block ends the broken statement, unless an 'else' continues it.
+            position++;
+            if (peek() != TK_Else)
+            {
+                return;
+            }
+        }
+        position++;
+    }
+}
+
+NodeIndex Parser::parseFunction()
+{
+    position++; // 'function'
+    size_t first = scratch.size();
+    scratch.push_back(isTypeKeyword(peek()) ? parseType() : makeNode(NK_Empty, position));
+    std::uint32_t name = expect(TK_Identifier, "a function name");
+    expect(TK_OpenParen, "'(' after the function name");
+    if (peek() != TK_CloseParen)
+    {
+        do
+        {
+            NodeIndex type = parseType();
+            std::uint32_t parameter = expect(TK_Identifier, "a parameter name");
+            scratch.push_back(makeNode(NK_Parameter, parameter, {type}));
+        } while (accept(TK_Comma));
+    }
+    expect(TK_CloseParen, "')' after the parameters");
+    scratch.push_back(parseBlock());
+    return makeNode(NK_Function, name, first);
+}
+
+NodeIndex Parser::parseStatement()
+{
+    Nesting nesting = enter();
+    switch (peek())
+    {
+    case TK_If:
+        return parseIf();
+    case TK_For:
+        return parseFor();
+    case TK_Return:
+        return parseReturn();
+    case TK_OpenBrace:
+        return parseBlock();
+    case TK_Semicolon:
+        return makeNode(NK_Empty, position++);
+    case TK_Function:
+        failAt(position, "Functions can only be defined at the top level");
+    default:
+        break;
+    }
+
+    if (isTypeKeyword(peek()))
+    {
+        NodeIndex declaration = parseDeclaration();
+        expect(TK_Semicolon, "';' after the declaration");
+        return declaration;
+    }
+
+    std::uint32_t first = position;
+    NodeIndex expression = parseExpression(0);
+    expect(TK_Semicolon, "';' after the expression");
+    return makeNode(NK_ExprStmt, first, {expression});
+}
+
+NodeIndex Parser::parseDeclaration()
+{
+    NodeIndex type = parseType();
+    std::uint32_t name = expect(TK_Identifier, "a variable name");
+    if (accept(TK_EqualsSign))
+    {
+        return makeNode(NK_VarDecl, name, {type, parseExpression(0)});
+    }
+    return makeNode(NK_VarDecl, name, {type});
+}
+
+NodeIndex Parser::parseIf()
+{
+    std::uint32_t keyword = position++;
+    expect(TK_OpenParen, "'(' after 'if'");
+    NodeIndex condition = parseExpression(0);
+    expect(TK_CloseParen, "')' after the condition");
+    NodeIndex thenBranch = parseStatement();
+    if (accept(TK_Else))
+    {
+        return makeNode(NK_If, keyword, {condition, thenBranch, parseStatement()});
+    }
+    return makeNode(NK_If, keyword, {condition, thenBranch});
+}
+
+NodeIndex Parser::parseFor()
+{
+    std::uint32_t keyword = position++;
+    expect(TK_OpenParen, "'(' after 'for'");
+
+    NodeIndex initialiser;
+    if (isTypeKeyword(peek()))
+    {
+        initialiser = parseDeclaration();
+    }
+    else
+    {
+        initialiser = peek() == TK_Semicolon ? makeNode(NK_Empty, position) : parseExpression(0);
+    }
+    expect(TK_Semicolon, "';' after the loop initialiser");
+
+    NodeIndex condition = peek() == TK_Semicolon ? makeNode(NK_Empty, position) : parseExpression(0);
+    expect(TK_Semicolon, "';' after the loop condition");
+
+    NodeIndex step = peek() == TK_CloseParen ? makeNode(NK_Empty, position) : parseExpression(0);
+    expect(TK_CloseParen, "')' after the loop step");
+
+    return makeNode(NK_For, keyword, {initialiser, condition, step, parseStatement()});
+}
+
+NodeIndex Parser::parseReturn()
+{
+    std::uint32_t keyword = position++;
+    if (accept(TK_Semicolon))
+    {
+        return makeNode(NK_Return, keyword);
+    }
+    NodeIndex value = parseExpression(0);
+    expect(TK_Semicolon, "';' after the return value");
+    return makeNode(NK_Return, keyword, {value});
+}
+
+NodeIndex Parser::parseBlock()
+{
+    std::uint32_t brace = expect(TK_OpenBrace, "'{'");
+    size_t first = scratch.size();
+    while (peek() != TK_CloseBrace && peek() != TK_KindCount)
+    {
+        parseItem(false);
+    }
+    if (!accept(TK_CloseBrace))
+    {
+        // Only the end of the input gets here; keep the block rather than drop the enclosing statement.
+        report(position, "Expected '}' to close the block at end of input");
+    }
+    return makeNode(NK_Block, brace, first);
+}
+
+NodeIndex Parser::parseExpression(int minimumPower)
+{
+    Nesting nesting = enter();
+    NodeIndex left = parsePrefix();
+    for (;;)
+    {
+        TokenKind kind = peek();
+        int power = infixPowers.power[kind];
+        if (power <= minimumPower)
+        {
+            return left;
+        }
+        std::uint32_t op = position++;
+
+        if (kind == TK_OpenParen)
+        {
+            size_t first = scratch.size();
+            scratch.push_back(left);
+            if (peek() != TK_CloseParen)
+            {
+                do
+                {
+                    scratch.push_back(parseExpression(0));
+                } while (accept(TK_Comma));
+            }
+            expect(TK_CloseParen, "')' after the arguments");
+            left = makeNode(NK_Call, op, first);
+        }
+        else if (kind == TK_EqualsSign)
+        {
+            if (treeBuffer.kind(left) != NK_Name)
+            {
+                failAt(op, "Only a variable can be assigned to");
+            }
+            // Right associative: a = b = c is a = (b = c).
+            left = makeNode(NK_Assign, op, {left, parseExpression(power - 1)});
+        }
+        else
+        {
+            left = makeNode(NK_Binary, op, {left, parseExpression(power)});
+        }
+    }
+}
+
+NodeIndex Parser::parsePrefix()
+{
+    std::uint32_t at = position;
+    switch (peek())
+    {
+    case TK_Identifier:
+        position++;
+        return makeNode(NK_Name, at);
+    case TK_Integer:
+    case TK_Float:
+    case TK_String:
+    case TK_Char:
+    case TK_True:
+    case TK_False:
+        position++;
+        return makeNode(NK_Literal, at);
+    case TK_OpenParen:
+    {
+        position++;
+        NodeIndex inner = parseExpression(0);
+        expect(TK_CloseParen, "')'");
+        return inner;
+    }
+    case TK_Minus:
+    case TK_Not:
+        position++;
+        return makeNode(NK_Unary, at, {parseExpression(PrefixPower)});
+    default:
+        fail("an expression");
+    }
+}
+
+NodeIndex Parser::parseType()
+{
+    if (!isTypeKeyword(peek()))
+    {
+        fail("a type");
+    }
+    return makeNode(NK_Type, position++);
+}
+
+NodeIndex Parser::makeNode(NodeKind kind, std::uint32_t token)
+{
+    return treeBuffer.add(kind, token, nullptr, 0);
+}
+
+NodeIndex Parser::makeNode(NodeKind kind, std::uint32_t token, std::initializer_list<NodeIndex> children)
+{
+    return treeBuffer.add(kind, token, children.begin(), static_cast<std::uint32_t>(children.size()));
+}
+
+NodeIndex Parser::makeNode(NodeKind kind, std::uint32_t token, size_t firstChild)
+{
+    NodeIndex node = treeBuffer.add(kind, token, scratch.data() + firstChild, static_cast<std::uint32_t>(scratch.size() - firstChild));
+    scratch.resize(firstChild);
+    return node;
+}
+
+bool Parser::accept(TokenKind kind)
+{
+    if (peek() != kind)
+    {
+        return false;
+    }
+    position++;
+    return true;
+}
+
+std::uint32_t Parser::expect(TokenKind kind, const char *what)
+{
+    if (peek() != kind)
+    {
+        // A missing ';' belongs at the end of the statement, not at the next line's first token.
+        fail(what, kind == TK_Semicolon);
+    }
+    return position++;
+}
+
+void Parser::fail(const char *expected, bool afterPrevious)
+{
+    if (position >= count)
+    {
+        failAt(position, arena->concat({"Expected ", expected, " at end of input"}));
+    }
+    failAt(position, arena->concat({"Expected ", expected, " but found '", (*tokens)[position].value, "'"}), afterPrevious);
+}
+
+void Parser::failAt(std::uint32_t token, std::string_view message, bool afterPrevious)
+{
+    report(token, message, afterPrevious);
+    throw Abort();
+}
+
+void Parser::report(std::uint32_t token, std::string_view message, bool afterPrevious)
+{
+    // Errors caused by a token the lexer rejected were reported with it.
+    std::uint32_t previous = token > 0 ? std::min(token - 1, count - 1) : token;
+    if ((token < count && (*tokens)[token].malformed) || (previous < count && (*tokens)[previous].malformed))
+    {
+        return;
+    }
+
+    Diagnostic diagnostic = {1, 1, 1, message};
+    if (token < count && !afterPrevious)
+    {
+        const Token &at = (*tokens)[token];
+        diagnostic = {at.line, at.start_column, at.end_column, message};
+    }
+    else if (previous < count)
+    {
+        // Just after the previous token (also used at the end of the input).
+        const Token &before = (*tokens)[previous];
+        int column = before.end_column + 1;
+        diagnostic = {before.line, column, column, message};
+    }
+
+    if (!diagnosticBuffer.empty() && diagnosticBuffer.back().line == diagnostic.line &&
+        diagnosticBuffer.back().start_column == diagnostic.start_column)
+    {
+        return;
+    }
+    diagnosticBuffer.push_back(diagnostic);
+}
+
+Parser::Nesting Parser::enter()
+{
+    if (depth >= MaxDepth)
+    {
+        failAt(position, "Nesting is too deep");
+    }
+    depth++;
+    return Nesting{depth};
+}
+
+bool findTopLevelChunks(const std::vector<Token> &tokens, size_t targetTokens, std::vector<std::uint32_t> &ends)
+{
+    ends.clear();
+    const size_t count = tokens.size();
+    int braces = 0;
+    int parens = 0;
+    size_t chunkStart = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        switch (tokens[i].type)
+        {
+        case TK_OpenBrace:
+            braces++;
+            continue;
+        case TK_OpenParen:
+            parens++;
+            continue;
+        case TK_CloseParen:
+            if (--parens < 0)
+            {
+                return false;
+            }
+            continue;
+        case TK_CloseBrace:
+            if (--braces < 0)
+            {
+                return false;
+            }
+            break;
+        case TK_Semicolon:
+            break;
+        default:
+            continue;
+        }
+
+        // A ';' or '}' outside all brackets ends an item, unless an 'else' continues it.
+        if (braces == 0 && parens == 0 && i + 1 - chunkStart >= targetTokens &&
+            (i + 1 == count || tokens[i + 1].type != TK_Else))
+        {
+            chunkStart = i + 1;
+            ends.push_back(static_cast<std::uint32_t>(chunkStart));
+        }
+    }
+
+    if (braces != 0 || parens != 0)
+    {
+        return false;
+    }
+    if (chunkStart != count)
+    {
+        ends.push_back(static_cast<std::uint32_t>(count));
+    }
+    return true;
+}
@@ -0,0 +1,345 @@
+/**
+ * @file perf_counters.cpp
+ * @brief Implementation of the perf_event_open based region counters.
+ */
+
+#include "../headers/perf_counters.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace PerfCounters
+{
+    std::atomic<bool> enabledFlag{false};
+
+    namespace
+    {
+        std::uint64_t nowNs()
+        {
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                  std::chrono::steady_clock::now().time_since_epoch())
+                                                  .count());
+        }
+
+        /**
+         * @brief The counters of one thread, opened on first use.
+         */
+        class ThreadCounters
+        {
+        public:
+            ThreadCounters()
+            {
+                for (int c = 0; c < PC_Count; c++)
+                {
+                    fds[c] = -1;
+                }
+#ifdef __linux__
+                struct EventSpec
+                {
+                    std::uint32_t type;
+                    std::uint64_t config;
+                };
+                const EventSpec specs[PC_Count] = {
+                    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+                    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+                    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+                    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+                    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+                };
+
+                int leader = -1;
+                for (int c = 0; c < PC_Count; c++)
+                {
+                    perf_event_attr attr;
+                    std::memset(&attr, 0, sizeof(attr));
+                    attr.size = sizeof(attr);
+                    attr.type = specs[c].type;
+                    attr.config = specs[c].config;
+                    attr.disabled = leader == -1 ? 1 : 0;
+                    attr.exclude_kernel = 1; // Allowed at perf_event_paranoid <= 2
+                    attr.exclude_hv = 1;
+                    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+                    int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+                    if (fd < 0)
+                    {
+                        if (reason.empty())
+                        {
+                            reason = std::string(counterName(static_cast<Counter>(c))) + ": " + std::strerror(errno);
+                            if (errno == EACCES || errno == EPERM)
+                            {
+                                reason += " (check /proc/sys/kernel/perf_event_paranoid)";
+                            }
+                            else if (errno == ENOENT || errno == EOPNOTSUPP)
+                            {
+                                reason += " (no hardware PMU, e.g. inside a VM)";
+                            }
+                        }
+                        continue;
+                    }
+                    fds[c] = fd;
+                    if (leader == -1)
+                    {
+                        leader = fd;
+                    }
+                }
+
+                if (leader != -1)
+                {
+                    reason.clear();
+                    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+                    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+                }
+                else if (reason.empty())
+                {
+                    reason = "perf_event_open failed";
+                }
+#else
+                reason = "perf_event_open is only available on Linux";
+#endif
+            }
+
+            ~ThreadCounters()
+            {
+#ifdef __linux__
+                for (int c = 0; c < PC_Count; c++)
+                {
+                    if (fds[c] >= 0)
+                    {
+                        close(fds[c]);
+                    }
+                }
+#endif
+            }
+
+            /**
+             * @brief Reads every open counter as it is, without scaling for multiplexing.
+             * @param readings Receives value, time enabled and time running per counter;
+             * unopened counters read 0.
+             */
+            void read(std::uint64_t readings[PC_Count][3]) const
+            {
+                for (int c = 0; c < PC_Count; c++)
+                {
+                    readings[c][0] = readings[c][1] = readings[c][2] = 0;
+#ifdef __linux__
+                    if (fds[c] < 0)
+                    {
+                        continue;
+                    }
+                    std::uint64_t data[3] = {0, 0, 0}; // value, time enabled, time running
+                    if (::read(fds[c], data, sizeof(data)) == static_cast<ssize_t>(sizeof(data)))
+                    {
+                        readings[c][0] = data[0];
+                        readings[c][1] = data[1];
+                        readings[c][2] = data[2];
+                    }
+#endif
+                }
+            }
+
+            bool isOpen(int counter) const { return fds[counter] >= 0; }
+            const std::string &unavailableReason() const { return reason; }
+
+        private:
+            int fds[PC_Count];
+            std::string reason;
+        };
+
+        ThreadCounters &threadCounters()
+        {
+            thread_local ThreadCounters counters;
+            return counters;
+        }
+
+        /**
+         * @brief Returns how much a counter advanced between two readings, scaled for multiplexing.
+         *
+         * The value, time enabled and time running are subtracted first and the
+         * difference is scaled once: scaling each reading on its own estimates
+         * them with different ratios, and their difference can then underflow.
+         * @param start The reading at the start of the region.
+         * @param end The reading at the end of the region.
+         * @return std::uint64_t The estimated count inside the region.
+         */
+        std::uint64_t scaledDelta(const std::uint64_t start[3], const std::uint64_t end[3])
+        {
+            std::uint64_t value = end[0] - start[0];
+            std::uint64_t enabled = end[1] - start[1];
+            std::uint64_t running = end[2] - start[2];
+            return running != 0 && running < enabled
+                       ? static_cast<std::uint64_t>(static_cast<double>(value) * enabled / running)
+                       : value;
+        }
+
+        std::mutex totalsMutex;
+        std::vector<RegionTotals> regionTotals;
+    }
+
+    void setEnabled(bool enabled)
+    {
+        enabledFlag.store(enabled, std::memory_order_relaxed);
+    }
+
+    const char *counterName(Counter counter)
+    {
+        switch (counter)
+        {
+        case PC_Cycles:
+            return "cycles";
+        case PC_Instructions:
+            return "instructions";
+        case PC_BranchMisses:
+            return "branch-misses";
+        case PC_L1DMisses:
+            return "L1D-read-misses";
+        case PC_LLCMisses:
+            return "LLC-read-misses";
+        default:
+            return "unknown";
+        }
+    }
+
+    std::string unavailableReason()
+    {
+        return threadCounters().unavailableReason();
+    }
+
+    Region::Region(const char *name, std::uint64_t bytes) : name(name), bytes(bytes), active(isEnabled())
+    {
+        if (active)
+        {
+            threadCounters().read(start);
+            startNs = nowNs();
+        }
+    }
+
+    Region::~Region()
+    {
+        if (!active)
+        {
+            return;
+        }
+
+        std::uint64_t endNs = nowNs();
+        std::uint64_t end[PC_Count][3];
+        const ThreadCounters &counters = threadCounters();
+        counters.read(end);
+
+        std::lock_guard<std::mutex> lock(totalsMutex);
+        RegionTotals *totals = nullptr;
+        for (auto &entry : regionTotals)
+        {
+            if (entry.name == name)
+            {
+                totals = &entry;
+                break;
+            }
+        }
+        if (!totals)
+        {
+            regionTotals.emplace_back();
+            totals = &regionTotals.back();
+            totals->name = name;
+        }
+
+        totals->calls++;
+        totals->bytes += bytes;
+        totals->nanoseconds += endNs - startNs;
+        for (int c = 0; c < PC_Count; c++)
+        {
+            if (counters.isOpen(c))
+            {
+                totals->valid[c] = true;
+                totals->values[c] += scaledDelta(start[c], end[c]);
+            }
+        }
+    }
+
+    std::vector<RegionTotals> totals()
+    {
+        std::lock_guard<std::mutex> lock(totalsMutex);
+        return regionTotals;
+    }
+
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(totalsMutex);
+        regionTotals.clear();
+    }
+
+    void report(std::ostream &out)
+    {
+        std::vector<RegionTotals> snapshot = totals();
+        std::string reason = unavailableReason();
+
+        std::ios::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+
+        out << "Performance counters";
+        if (!reason.empty())
+        {
+            out << " (hardware counters unavailable: " << reason << ")";
+        }
+        out << "\n";
+        out << std::left << std::setw(18) << "region" << std::right
+            << std::setw(8) << "calls" << std::setw(12) << "ms" << std::setw(10) << "MB/s"
+            << std::setw(8) << "IPC" << std::setw(14) << "br-miss/KB" << std::setw(14) << "L1D-miss/KB"
+            << std::setw(14) << "LLC-miss/KB" << "\n";
+        out << std::fixed << std::setprecision(2);
+
+        for (const auto &r : snapshot)
+        {
+            double kb = r.bytes / 1024.0;
+            double seconds = r.nanoseconds / 1e9;
+
+            auto perKb = [&](Counter c)
+            {
+                std::ostringstream cell;
+                cell << std::fixed << std::setprecision(2);
+                if (!r.valid[c] || kb == 0)
+                {
+                    cell << "-";
+                }
+                else
+                {
+                    cell << r.values[c] / kb;
+                }
+                return cell.str();
+            };
+
+            std::ostringstream ipc;
+            ipc << std::fixed << std::setprecision(2);
+            if (r.valid[PC_Cycles] && r.valid[PC_Instructions] && r.values[PC_Cycles] != 0)
+            {
+                ipc << static_cast<double>(r.values[PC_Instructions]) / r.values[PC_Cycles];
+            }
+            else
+            {
+                ipc << "-";
+            }
+
+            out << std::left << std::setw(18) << r.name << std::right
+                << std::setw(8) << r.calls
+                << std::setw(12) << seconds * 1e3
+                << std::setw(10) << (seconds > 0 ? (r.bytes / (1024.0 * 1024.0)) / seconds : 0.0)
+                << std::setw(8) << ipc.str()
+                << std::setw(14) << perKb(PC_BranchMisses)
+                << std::setw(14) << perKb(PC_L1DMisses)
+                << std::setw(14) << perKb(PC_LLCMisses) << "\n";
+        }
+
+        out.flags(flags);
+        out.precision(precision);
+    }
+}
@@ -0,0 +1,338 @@
+/**
+ * @file resolver.cpp
+ * @brief Implementation of name resolution over the flat syntax tree.
+ */
+
+#include "../headers/resolver.h"
+#include "../headers/parser.h"
+#include <algorithm>
+
+namespace
+{
+    /// Scopes that are always open: the builtins and the file.
+    constexpr size_t FileScopeDepth = 2;
+
+    constexpr size_t MinTableSize = 1024;
+
+    const char *const builtinSpellings[] = {"print"};
+
+    static_assert(sizeof(builtinSpellings) / sizeof(builtinSpellings[0]) == BI_Count, "one spelling per builtin");
+}
+
+const char *builtinName(Builtin which)
+{
+    return which < BI_Count ? builtinSpellings[which] : "unknown";
+}
+
+Resolver::Resolver(Interner &interner)
+{
+    for (int builtin = 0; builtin < BI_Count; builtin++)
+    {
+        builtinNames[builtin] = interner.intern(builtinSpellings[builtin]);
+    }
+}
+
+const Resolution &Resolver::resolve(const AstView &input, const std::vector<Token> &inputTokens, CompilationArena &messageArena)
+{
+    tree = input;
+    tokens = &inputTokens;
+    arena = &messageArena;
+    result.symbols.clear();
+    result.bindings.assign(tree.size(), NoBinding);
+    result.frameSizes.assign(1, 0);
+    result.globalCount = 0;
+    diagnosticBuffer.clear();
+    undo.clear();
+    scopes.clear();
+    frame = 0;
+    nextSlot = 0;
+
+    // The table keeps its size, so only files with more names than any before make it grow.
+    if (table.empty())
+    {
+        table.assign(MinTableSize, {NoSymbol, NoBinding});
+    }
+    else if (names != 0)
+    {
+        std::fill(table.begin(), table.end(), Slot{NoSymbol, NoBinding});
+    }
+    names = 0;
+
+    if (tree.empty())
+    {
+        return result;
+    }
+
+    enterScope();
+    for (std::uint32_t builtin = 0; builtin < BI_Count; builtin++)
+    {
+        result.symbols.push_back({builtinNames[builtin], NoNode, SK_Builtin, builtin});
+        bind(builtin);
+    }
+
+    enterScope();
+    ChildRange items = tree.children(tree.root());
+    for (NodeIndex item : items)
+    {
+        if (tree.kind(item) == NK_Function)
+        {
+            declare(item, SK_Function, static_cast<std::uint32_t>(result.frameSizes.size()));
+            result.frameSizes.push_back(0);
+        }
+    }
+
+    std::uint32_t functionFrame = 1;
+    for (NodeIndex item : items)
+    {
+        if (tree.kind(item) == NK_Function)
+        {
+            resolveFunction(item, functionFrame++);
+        }
+        else
+        {
+            resolveStatement(item);
+        }
+    }
+    leaveScope();
+    leaveScope();
+
+    // Functions were declared ahead of the statements before them. No two errors share a token.
+    std::sort(diagnosticBuffer.begin(), diagnosticBuffer.end(), [](const Diagnostic &a, const Diagnostic &b)
+              { return a.line != b.line ? a.line < b.line : a.start_column < b.start_column; });
+    return result;
+}
+
+void Resolver::resolveFunction(NodeIndex node, std::uint32_t functionFrame)
+{
+    // Children: return type, parameters..., body. The parameters share the body's outer scope.
+    ChildRange children = tree.children(node);
+    frame = functionFrame;
+    nextSlot = 0;
+    enterScope();
+    for (std::uint32_t i = 1; i + 1 < children.size(); i++)
+    {
+        declareVariable(children[i]);
+    }
+    resolveBlockBody(children[children.size() - 1]);
+    leaveScope();
+    frame = 0;
+    nextSlot = 0;
+}
+
+void Resolver::resolveStatement(NodeIndex node)
+{
+    ChildRange children = tree.children(node);
+    switch (tree.kind(node))
+    {
+    case NK_VarDecl:
+        // The initialiser is resolved first, so `int x = x;` reads an outer x.
+        if (children.size() > 1)
+        {
+            resolveExpression(children[1]);
+        }
+        declareVariable(node);
+        break;
+    case NK_If:
+        resolveExpression(children[0]);
+        resolveNested(children[1]);
+        if (children.size() > 2)
+        {
+            resolveNested(children[2]);
+        }
+        break;
+    case NK_For:
+        enterScope();
+        if (tree.kind(children[0]) == NK_VarDecl)
+        {
+            resolveStatement(children[0]);
+        }
+        else
+        {
+            resolveExpression(children[0]);
+        }
+        resolveExpression(children[1]);
+        resolveExpression(children[2]);
+        resolveNested(children[3]);
+        leaveScope();
+        break;
+    case NK_Block:
+        enterScope();
+        resolveBlockBody(node);
+        leaveScope();
+        break;
+    case NK_Return:
+    case NK_ExprStmt:
+        for (NodeIndex child : children)
+        {
+            resolveExpression(child);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void Resolver::resolveNested(NodeIndex node)
+{
+    // A declaration as the whole branch or loop body is scoped to it, as if it were a block.
+    if (tree.kind(node) == NK_Block)
+    {
+        resolveStatement(node);
+        return;
+    }
+    enterScope();
+    resolveStatement(node);
+    leaveScope();
+}
+
+void Resolver::resolveExpression(NodeIndex node)
+{
+    // Expressions declare nothing, so only their names matter. They are found in the subtree's index
+    // range, not by recursion: a chain like a + b + c + ... is as deep as it is long. The range starts
+    // at the first leaf under the first children.
+    NodeIndex first = node;
+    while (tree.children(first).size() != 0)
+    {
+        first = tree.children(first)[0];
+    }
+    for (NodeIndex at = first; at <= node; at++)
+    {
+        if (tree.kind(at) == NK_Name)
+        {
+            use(at);
+        }
+    }
+}
+
+void Resolver::resolveBlockBody(NodeIndex block)
+{
+    for (NodeIndex statement : tree.children(block))
+    {
+        resolveStatement(statement);
+    }
+}
+
+bool Resolver::declare(NodeIndex node, SymbolKind kind, std::uint32_t slot)
+{
+    const Token &token = (*tokens)[tree.token(node)];
+    std::uint32_t current = slotOf(token.symbol).symbol;
+    // Bindings made since the scope opened are the scope's own; older ones are shadowed.
+    if (current != NoBinding && current >= scopes.back().firstSymbol)
+    {
+        report(tree.token(node), arena->concat({"'", token.value, "' is already declared in this scope"}));
+        return false;
+    }
+
+    std::uint32_t symbol = static_cast<std::uint32_t>(result.symbols.size());
+    result.symbols.push_back({token.symbol, node, kind, slot});
+    result.bindings[node] = symbol;
+    bind(symbol);
+    return true;
+}
+
+void Resolver::bind(std::uint32_t symbol)
+{
+    Slot &slot = slotOf(result.symbols[symbol].name);
+    undo.push_back({symbol, slot.symbol});
+    slot.symbol = symbol;
+}
+
+void Resolver::declareVariable(NodeIndex node)
+{
+    if (frame == 0 && scopes.size() == FileScopeDepth)
+    {
+        if (declare(node, SK_Global, result.globalCount))
+        {
+            result.globalCount++;
+        }
+        return;
+    }
+
+    if (declare(node, SK_Local, nextSlot))
+    {
+        nextSlot++;
+        result.frameSizes[frame] = std::max(result.frameSizes[frame], nextSlot);
+    }
+}
+
+void Resolver::use(NodeIndex node)
+{
+    const Token &token = (*tokens)[tree.token(node)];
+    std::uint32_t symbol = slotOf(token.symbol).symbol;
+    if (symbol == NoBinding)
+    {
+        report(tree.token(node), arena->concat({"Undeclared name '", token.value, "'"}));
+        return;
+    }
+    result.bindings[node] = symbol;
+}
+
+void Resolver::enterScope()
+{
+    scopes.push_back({static_cast<std::uint32_t>(undo.size()), static_cast<std::uint32_t>(result.symbols.size()), nextSlot});
+}
+
+void Resolver::leaveScope()
+{
+    const Scope &scope = scopes.back();
+    while (undo.size() > scope.firstShadowed)
+    {
+        const Shadowed &entry = undo.back();
+        slotOf(result.symbols[entry.symbol].name).symbol = entry.previous;
+        undo.pop_back();
+    }
+    nextSlot = scope.nextSlot;
+    scopes.pop_back();
+}
+
+Resolver::Slot &Resolver::slotOf(SymbolId name)
+{
+    // Symbol IDs are dense, so a multiplicative hash spreads them well enough.
+    for (;;)
+    {
+        size_t mask = table.size() - 1;
+        for (size_t i = static_cast<size_t>((name * 0x9E3779B97F4A7C15ull) >> 32) & mask;; i = (i + 1) & mask)
+        {
+            if (table[i].name == name)
+            {
+                return table[i];
+            }
+            if (table[i].name == NoSymbol)
+            {
+                if (2 * (names + 1) > table.size())
+                {
+                    break;
+                }
+                names++;
+                table[i] = {name, NoBinding};
+                return table[i];
+            }
+        }
+        grow();
+    }
+}
+
+void Resolver::grow()
+{
+    std::vector<Slot> old(table.size() * 2, Slot{NoSymbol, NoBinding});
+    old.swap(table);
+    size_t mask = table.size() - 1;
+    for (const Slot &slot : old)
+    {
+        if (slot.name != NoSymbol)
+        {
+            size_t i = static_cast<size_t>((slot.name * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+            while (table[i].name != NoSymbol)
+            {
+                i = (i + 1) & mask;
+            }
+            table[i] = slot;
+        }
+    }
+}
+
+void Resolver::report(std::uint32_t token, std::string_view message)
+{
+    const Token &at = (*tokens)[token];
+    diagnosticBuffer.push_back({at.line, at.start_column, at.end_column, message});
+}
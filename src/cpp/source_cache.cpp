@@ -0,0 +1,174 @@
+/**
+ * @file source_cache.cpp
+ * @brief Implementation of the in-memory source cache.
+ */
+
+#include "../headers/source_cache.h"
+#include "../headers/alloc_tracker.h"
+#include "../headers/driver.h"
+#include "../headers/parse_cache.h"
+#include <cstring>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+std::string_view CachedSource::lineText(int lineNumber) const
+{
+    if (lineNumber < 1 || static_cast<size_t>(lineNumber) > lineOffsets.size())
+    {
+        return {};
+    }
+
+    size_t begin = lineOffsets[lineNumber - 1];
+    size_t end = static_cast<size_t>(lineNumber) < lineOffsets.size() ? lineOffsets[lineNumber] - 1 : content.size();
+    if (end > begin && content[end - 1] == '\r')
+    {
+        end--;
+    }
+    return std::string_view(content).substr(begin, end - begin);
+}
+
+/**
+ * @brief Builds the line start table of a file.
+ * @param content The file content.
+ * @return std::vector<size_t> Offset of the first byte of every line.
+ */
+static std::vector<size_t> buildLineOffsets(const std::string &content)
+{
+    std::vector<size_t> offsets;
+    offsets.push_back(0);
+
+    const char *data = content.data();
+    const char *end = data + content.size();
+    const char *cursor = data;
+    while (cursor < end)
+    {
+        const char *newline = static_cast<const char *>(std::memchr(cursor, '\n', end - cursor));
+        if (!newline)
+        {
+            break;
+        }
+        offsets.push_back(static_cast<size_t>(newline - data) + 1);
+        cursor = newline + 1;
+    }
+
+    return offsets;
+}
+
+std::shared_ptr<const CachedSource> SourceCache::get(const std::string &path, bool *changed)
+{
+    if (changed)
+    {
+        *changed = false;
+    }
+
+    std::error_code ec;
+    auto writeTime = fs::last_write_time(path, ec);
+    std::uintmax_t size = ec ? 0 : fs::file_size(path, ec);
+    if (ec)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.erase(path);
+        counters.failures++;
+        return nullptr;
+    }
+    std::int64_t mtime = std::chrono::duration_cast<std::chrono::nanoseconds>(writeTime.time_since_epoch()).count();
+
+    std::shared_ptr<const CachedSource> previous;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(path);
+        if (it != entries.end())
+        {
+            previous = it->second;
+            if (previous->mtime == mtime && previous->size == size)
+            {
+                counters.hits++;
+                return previous;
+            }
+        }
+    }
+
+    std::string content;
+    try
+    {
+        BASSIL_ALLOC_PHASE(AllocTracker::AP_Read);
+        content = Utils::readFileToString(path);
+    }
+    catch (const std::exception &)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.erase(path);
+        counters.failures++;
+        return nullptr;
+    }
+
+    std::uint64_t hash = ParseCache::hashSource(content);
+    auto entry = std::make_shared<CachedSource>();
+
+    if (previous && previous->hash == hash && previous->content == content)
+    {
+        // Touched but not modified (e.g. a no-op save): keep the lexed data.
+        *entry = *previous;
+        entry->mtime = mtime;
+        entry->size = size;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        entries[path] = entry;
+        counters.rehashed++;
+        return entry;
+    }
+
+    entry->path = path;
+    entry->mtime = mtime;
+    entry->size = size;
+    entry->hash = hash;
+    entry->content = std::move(content);
+    entry->lineOffsets = buildLineOffsets(entry->content);
+    // One lexer per thread keeps its tables and scratch buffers warm across files.
+    static thread_local Lexer lexer;
+    {
+        BASSIL_ALLOC_PHASE(AllocTracker::AP_Lex);
+        entry->arena = std::make_shared<CompilationArena>(entry->content.size() + 1024);
+        lexer.setColumnMode(columnMode);
+        lexer.lex(entry->content, *entry->arena);
+        entry->tokens = lexer.tokens();
+        entry->diagnostics = lexer.diagnostics();
+    }
+    {
+        BASSIL_ALLOC_PHASE(AllocTracker::AP_Parse);
+        static thread_local Parser parser;
+        entry->tree = parser.parse(entry->tokens, *entry->arena);
+        mergeDiagnostics(entry->diagnostics, parser.diagnostics());
+    }
+    // The same semantic passes as bassilc, so CHECK reports what the command line does.
+    Driver::checkTree(entry->tree.view(), entry->tokens, lexer.literals(), entry->content.size(), *entry->arena, entry->diagnostics);
+
+    if (changed)
+    {
+        *changed = true;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    entries[path] = entry;
+    counters.relexed++;
+    return entry;
+}
+
+void SourceCache::invalidate(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.erase(path);
+}
+
+size_t SourceCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+SourceCacheStats SourceCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
@@ -0,0 +1,597 @@
+/**
+ * @file syntax_tree.cpp
+ * @brief Implementation of the red-green syntax tree and incremental reparsing.
+ */
+
+#include "../headers/syntax_tree.h"
+#include "../headers/parser.h"
+#include "../headers/trace.h"
+#include "../headers/utf8.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+    /**
+     * @brief The text to lex again and the tokens expected around it (see SyntaxTree::edit())
+     *
+     * Offsets are in the new source. The items to rebuild cover [begin, end).
+     * The token before them, if any, is lexed too (from lexBegin) so errors
+     * right after a malformed token stay suppressed; the token after them, if
+     * any (up to lexEnd), shows where the next, reused item starts.
+     */
+    typedef struct
+    {
+        std::uint32_t lexBegin;
+        std::uint32_t begin;
+        std::uint32_t end;
+        std::uint32_t lexEnd;
+        GreenToken before; ///< Expected token before the items, if lexBegin < begin
+        GreenToken after;  ///< Expected token after the items, if lexEnd > end
+    } Region;
+
+    typedef enum
+    {
+        RR_Done,
+        RR_WidenLeft, ///< The token before the items came out differently
+        RR_WidenRight ///< The items do not end where the next one starts
+    } RegionResult;
+
+    /**
+     * @brief Items rebuilt from a Region, and the end of the file if the region reached it
+     */
+    struct RegionItems
+    {
+        std::vector<GreenNodePtr> items;
+        GreenToken endOfFile = {TK_KindCount, false, 0, 0};
+        std::vector<GreenDiagnostic> trailing; ///< Errors in the trivia after the last token
+    };
+
+    std::uint32_t widthOf(const GreenChild &child)
+    {
+        return child.node ? child.node->width : child.token.width;
+    }
+
+    /// First token of a node (items always have one); zero-width nodes hold none.
+    GreenToken firstTokenOf(const GreenNode &node)
+    {
+        for (const GreenChild &child : node.children)
+        {
+            if (!child.node)
+            {
+                return child.token;
+            }
+            if (child.node->width != 0)
+            {
+                return firstTokenOf(*child.node);
+            }
+        }
+        return {TK_KindCount, false, 0, 0};
+    }
+
+    GreenToken lastTokenOf(const GreenNode &node)
+    {
+        for (auto child = node.children.rbegin(); child != node.children.rend(); ++child)
+        {
+            if (!child->node)
+            {
+                return child->token;
+            }
+            if (child->node->width != 0)
+            {
+                return lastTokenOf(*child->node);
+            }
+        }
+        return {TK_KindCount, false, 0, 0};
+    }
+
+    /// True if an error of the item was reported at the token after it (see Parser::report()).
+    bool reportsPastEnd(const GreenChild &item)
+    {
+        return item.node && std::any_of(item.node->diagnostics.begin(), item.node->diagnostics.end(), [&](const GreenDiagnostic &diagnostic)
+                                        { return diagnostic.offset >= item.node->width; });
+    }
+
+    std::vector<std::uint32_t> lineStarts(std::string_view text)
+    {
+        std::vector<std::uint32_t> starts = {0};
+        for (size_t at = 0; const void *newline = std::memchr(text.data() + at, '\n', text.size() - at);)
+        {
+            at = static_cast<size_t>(static_cast<const char *>(newline) - text.data()) + 1;
+            starts.push_back(static_cast<std::uint32_t>(at));
+        }
+        return starts;
+    }
+
+    /**
+     * @brief Builds green nodes from a parse of lexed tokens
+     *
+     * A node covers the tokens from the first to the last of its subtree; the
+     * tokens between its children that no child covers (a statement's ';',
+     * the 'function' keyword, parentheses) are its own. An omitted part
+     * (NK_Empty as a return type or for-loop clause) covers nothing.
+     */
+    class GreenBuilder
+    {
+    public:
+        GreenBuilder(const std::vector<Token> &tokens, const std::vector<std::uint32_t> &starts, const Ast &tree)
+            : tokens(tokens), starts(starts), tree(tree), first(tree.size()), end(tree.size())
+        {
+            for (NodeIndex node = 0; node + 1 < tree.size(); node++)
+            {
+                first[node] = tree.token(node);
+                end[node] = tree.token(node) + 1;
+                ChildRange children = tree.children(node);
+                for (std::uint32_t i = 0; i < children.size(); i++)
+                {
+                    NodeIndex child = children[i];
+                    if (omitted(tree.kind(node), i, tree.kind(child)))
+                    {
+                        first[child] = end[child] = tree.token(child);
+                    }
+                    first[node] = std::min(first[node], first[child]);
+                    end[node] = std::max(end[node], end[child]);
+                }
+            }
+        }
+
+        /// Byte where the trivia of token @p index starts (the end of the token before it).
+        std::uint32_t triviaStart(std::uint32_t index) const
+        {
+            return index == 0 ? 0 : starts[index - 1] + static_cast<std::uint32_t>(tokens[index - 1].value.size());
+        }
+
+        /**
+         * @brief A top-level item: @p node (or an NK_Error node if it is NoNode) plus every token in [firstToken, endToken).
+         */
+        std::shared_ptr<GreenNode> item(NodeIndex node, std::uint32_t firstToken, std::uint32_t endToken) const
+        {
+            if (node != NoNode)
+            {
+                return build(node, firstToken, endToken);
+            }
+            auto green = std::make_shared<GreenNode>();
+            green->kind = NK_Error;
+            for (std::uint32_t token = firstToken; token < endToken; token++)
+            {
+                addToken(*green, token);
+            }
+            return green;
+        }
+
+    private:
+        static bool omitted(NodeKind parent, std::uint32_t index, NodeKind child)
+        {
+            return child == NK_Empty && ((parent == NK_Function && index == 0) || (parent == NK_For && index < 3));
+        }
+
+        std::shared_ptr<GreenNode> build(NodeIndex node, std::uint32_t firstToken, std::uint32_t endToken) const
+        {
+            auto green = std::make_shared<GreenNode>();
+            green->kind = tree.kind(node);
+            std::uint32_t token = firstToken;
+            for (NodeIndex child : tree.children(node))
+            {
+                while (token < first[child])
+                {
+                    addToken(*green, token++);
+                }
+                GreenNodePtr built = build(child, first[child], end[child]);
+                green->children.push_back({built, {}, green->width});
+                green->width += built->width;
+                token = std::max(token, end[child]);
+            }
+            while (token < endToken)
+            {
+                addToken(*green, token++);
+            }
+            return green;
+        }
+
+        void addToken(GreenNode &green, std::uint32_t index) const
+        {
+            std::uint32_t trivia = starts[index] - triviaStart(index);
+            std::uint32_t width = trivia + static_cast<std::uint32_t>(tokens[index].value.size());
+            green.children.push_back({nullptr, {tokens[index].type, tokens[index].malformed, trivia, width}, green.width});
+            green.width += width;
+        }
+
+        const std::vector<Token> &tokens;
+        const std::vector<std::uint32_t> &starts;
+        const Ast &tree;
+        std::vector<std::uint32_t> first; ///< First token of each node
+        std::vector<std::uint32_t> end;   ///< One past the last token of each node
+    };
+
+    /**
+     * @brief Lexes and parses the items of a region into green nodes.
+     * @param source The new source.
+     * @param region What to rebuild.
+     * @param out Receives the items.
+     * @return RegionResult RR_Done, or the side to widen the region on if it does not line up with its neighbours.
+     */
+    RegionResult rebuild(std::string_view source, const Region &region, RegionItems &out)
+    {
+        // Like the driver's, one lexer and parser per thread keep their buffers warm.
+        static thread_local Lexer lexer;
+        static thread_local Parser parser;
+        static thread_local CompilationArena arena(64 * 1024);
+        arena.reset();
+        lexer.setColumnMode(CM_Bytes);
+
+        std::string_view text = source.substr(region.lexBegin, region.lexEnd - region.lexBegin);
+        const std::vector<Token> &tokens = lexer.lex(text, arena);
+        std::vector<std::uint32_t> lines = lineStarts(text);
+        auto offsetOf = [&](int line, int column)
+        {
+            return lines[static_cast<size_t>(line - 1)] + static_cast<std::uint32_t>(column - 1);
+        };
+        std::vector<std::uint32_t> starts(tokens.size());
+        for (size_t i = 0; i < tokens.size(); i++)
+        {
+            starts[i] = offsetOf(tokens[i].line, tokens[i].start_column);
+        }
+        auto endOf = [&](size_t i)
+        {
+            return starts[i] + static_cast<std::uint32_t>(tokens[i].value.size());
+        };
+
+        const std::uint32_t begin = region.begin - region.lexBegin;
+        const std::uint32_t end = region.end - region.lexBegin;
+        std::uint32_t firstToken = 0;
+        std::uint32_t lastToken = static_cast<std::uint32_t>(tokens.size());
+        if (begin != 0)
+        {
+            if (tokens.empty() || starts[0] != 0 || endOf(0) != begin || tokens[0].type != region.before.kind)
+            {
+                return RR_WidenLeft;
+            }
+            firstToken = 1;
+        }
+        const bool toEnd = region.lexEnd == region.end;
+        if (!toEnd)
+        {
+            // The next item is reused, so its first token must come out where it was,
+            // right after the last token of the items, and not depend on what follows.
+            lastToken--;
+            const Token &next = tokens.back();
+            std::uint32_t nextStart = static_cast<std::uint32_t>(text.size()) - (region.after.width - region.after.trivia);
+            if (tokens.size() <= firstToken || next.type != region.after.kind || next.malformed ||
+                starts.back() != nextStart || endOf(tokens.size() - 1) != text.size())
+            {
+                return RR_WidenRight;
+            }
+            std::uint32_t itemsEnd = lastToken == 0 ? 0 : endOf(lastToken - 1);
+            if (itemsEnd != end || (lastToken > firstToken && tokens[lastToken - 1].malformed))
+            {
+                return RR_WidenRight;
+            }
+            // A bad character literal looks for its closing quote up to the end of its line, past this text.
+            for (std::uint32_t i = firstToken; i < lastToken; i++)
+            {
+                if (tokens[i].type == TK_Char && tokens[i].malformed)
+                {
+                    return RR_WidenRight;
+                }
+            }
+        }
+
+        const Ast &tree = parser.parseItems(tokens, arena, firstToken, lastToken);
+        if (parser.stoppedAt() > lastToken)
+        {
+            return RR_WidenRight;
+        }
+        const std::vector<Diagnostic> &syntaxErrors = parser.diagnostics();
+        if (!toEnd && std::any_of(syntaxErrors.begin(), syntaxErrors.end(), [&](const Diagnostic &diagnostic)
+                                  { return offsetOf(diagnostic.line, diagnostic.start_column) >= end; }))
+        {
+            // Reported at the next item's first token, where a full parse might merge it with that item's own error.
+            return RR_WidenRight;
+        }
+
+        GreenBuilder builder(tokens, starts, tree);
+        const std::vector<TopLevelItem> &items = parser.items();
+        std::vector<std::shared_ptr<GreenNode>> built;
+        std::vector<std::uint32_t> itemStarts;
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            std::uint32_t itemEnd = i + 1 < items.size() ? items[i + 1].firstToken : lastToken;
+            built.push_back(builder.item(items[i].node, items[i].firstToken, itemEnd));
+            itemStarts.push_back(builder.triviaStart(items[i].firstToken));
+        }
+        const std::uint32_t itemsEnd = builder.triviaStart(lastToken);
+
+        auto attach = [&](std::vector<GreenDiagnostic> &to, std::uint32_t base, const Diagnostic &diagnostic, bool lexical)
+        {
+            std::uint32_t at = offsetOf(diagnostic.line, diagnostic.start_column);
+            std::uint32_t length = static_cast<std::uint32_t>(std::max(1, diagnostic.end_column - diagnostic.start_column + 1));
+            to.push_back({at > base ? at - base : 0, length, lexical, std::string(diagnostic.message)});
+        };
+        for (const Diagnostic &diagnostic : lexer.diagnostics())
+        {
+            std::uint32_t at = offsetOf(diagnostic.line, diagnostic.start_column);
+            if (at < begin)
+            {
+                continue; // In the token before the items, which keeps its own errors
+            }
+            if (at >= itemsEnd)
+            {
+                if (toEnd)
+                {
+                    attach(out.trailing, itemsEnd, diagnostic, true);
+                }
+                continue;
+            }
+            size_t item = static_cast<size_t>(std::upper_bound(itemStarts.begin(), itemStarts.end(), at) - itemStarts.begin()) - 1;
+            attach(built[item]->diagnostics, itemStarts[item], diagnostic, true);
+        }
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            size_t last = i + 1 < items.size() ? items[i + 1].firstDiagnostic : syntaxErrors.size();
+            for (size_t d = items[i].firstDiagnostic; d < last; d++)
+            {
+                attach(built[i]->diagnostics, itemStarts[i], syntaxErrors[d], false);
+            }
+        }
+
+        out.items.assign(built.begin(), built.end());
+        if (toEnd)
+        {
+            std::uint32_t trailing = static_cast<std::uint32_t>(text.size()) - itemsEnd;
+            out.endOfFile = {TK_KindCount, false, trailing, trailing};
+        }
+        return RR_Done;
+    }
+
+    std::shared_ptr<const std::string> checkedSource(std::string source)
+    {
+        if (source.size() > std::numeric_limits<std::uint32_t>::max())
+        {
+            throw std::length_error("[SyntaxTree] Sources are limited to 4 GB");
+        }
+        return std::make_shared<const std::string>(std::move(source));
+    }
+
+    void appendChild(GreenNode &root, GreenChild child)
+    {
+        child.offset = root.width;
+        root.width += widthOf(child);
+        root.children.push_back(std::move(child));
+    }
+}
+
+std::string_view SyntaxNode::text() const
+{
+    return std::string_view(*red->source).substr(red->offset, width());
+}
+
+SyntaxNode SyntaxNode::child(size_t index) const
+{
+    const GreenChild &child = red->green->children[index];
+    return SyntaxNode(std::make_shared<const Red>(Red{child.node, red, red->source, red->offset + child.offset}));
+}
+
+SyntaxToken SyntaxNode::token(size_t index) const
+{
+    const GreenChild &child = red->green->children[index];
+    std::uint32_t at = red->offset + child.offset + child.token.trivia;
+    return {child.token.kind, at, std::string_view(*red->source).substr(at, child.token.width - child.token.trivia)};
+}
+
+SyntaxNode SyntaxNode::parent() const
+{
+    return SyntaxNode(red->parent);
+}
+
+SyntaxNode SyntaxNode::nodeAt(std::uint32_t offset) const
+{
+    SyntaxNode node = *this;
+    for (;;)
+    {
+        const std::vector<GreenChild> &children = node.green().children;
+        std::uint32_t relative = offset - node.offset();
+        auto after = std::upper_bound(children.begin(), children.end(), relative, [](std::uint32_t at, const GreenChild &child)
+                                      { return at < child.offset; });
+        if (after == children.begin())
+        {
+            return node;
+        }
+        size_t index = static_cast<size_t>(after - children.begin()) - 1;
+        if (!children[index].node || relative >= children[index].offset + children[index].node->width)
+        {
+            return node;
+        }
+        node = node.child(index);
+    }
+}
+
+SyntaxTree SyntaxTree::parse(std::string source, ColumnMode columnMode)
+{
+    BASSIL_TRACE_SCOPE("SyntaxTree::parse");
+    std::shared_ptr<const std::string> text = checkedSource(std::move(source));
+    std::uint32_t size = static_cast<std::uint32_t>(text->size());
+
+    RegionItems rebuilt;
+    rebuild(*text, {0, 0, size, size, {}, {}}, rebuilt);
+    auto root = std::make_shared<GreenNode>();
+    for (GreenNodePtr &item : rebuilt.items)
+    {
+        appendChild(*root, {std::move(item), {}, 0});
+    }
+    appendChild(*root, {nullptr, rebuilt.endOfFile, 0});
+    root->diagnostics = std::move(rebuilt.trailing);
+    return SyntaxTree(std::move(text), std::move(root), columnMode);
+}
+
+SyntaxTree SyntaxTree::edit(const TextEdit &change, ReparseStats *stats) const
+{
+    BASSIL_TRACE_SCOPE("SyntaxTree::edit");
+    const std::string &old = *text;
+    if (change.offset > old.size() || change.removed > old.size() - change.offset)
+    {
+        throw std::out_of_range("[SyntaxTree::edit] The edit is outside the source");
+    }
+    std::string edited;
+    edited.reserve(old.size() - change.removed + change.inserted.size());
+    edited.append(old, 0, change.offset).append(change.inserted).append(old, change.offset + change.removed, std::string::npos);
+    std::shared_ptr<const std::string> source = checkedSource(std::move(edited));
+    const std::int64_t delta = static_cast<std::int64_t>(change.inserted.size()) - change.removed;
+
+    // The root's children are the items and, last, the end-of-file token. Every
+    // child the edit touches is damaged, including one that merely ends where
+    // it starts or starts where it ends (the edit may extend its tokens).
+    const std::vector<GreenChild> &children = rootNode->children;
+    const size_t count = children.size() - 1;
+    const std::uint32_t editEnd = change.offset + change.removed;
+    // A bad character literal was cut short after looking for its quote up to the
+    // end of its line, so with a quote earlier on the line the damage starts there.
+    std::uint32_t damageStart = change.offset;
+    size_t lineStart = change.offset == 0 ? 0 : old.rfind('\n', change.offset - 1) + 1;
+    if (old.find('\'', lineStart) < change.offset)
+    {
+        damageStart = static_cast<std::uint32_t>(lineStart);
+    }
+    size_t first = static_cast<size_t>(std::partition_point(children.begin(), children.end(), [&](const GreenChild &child)
+                                                            { return child.offset + widthOf(child) < damageStart; }) -
+                                       children.begin());
+    size_t last = static_cast<size_t>(std::partition_point(children.begin(), children.end(), [&](const GreenChild &child)
+                                                           { return child.offset <= editEnd; }) -
+                                      children.begin()) - 1;
+    if (first > 0)
+    {
+        first--; // Its parse looked at the first damaged token (for an 'else', say)
+    }
+
+    RegionItems rebuilt;
+    Region region;
+    for (;;)
+    {
+        while (first > 0 && reportsPastEnd(children[first - 1]))
+        {
+            first--;
+        }
+        if (last + 1 == count)
+        {
+            last = count; // Only trailing trivia would follow; take it along rather than look ahead at nothing
+        }
+
+        region = {};
+        region.begin = children[first].offset;
+        region.lexBegin = region.begin;
+        if (first > 0)
+        {
+            region.before = lastTokenOf(*children[first - 1].node);
+            region.lexBegin -= region.before.width - region.before.trivia;
+        }
+        std::uint32_t oldEnd = last == count ? static_cast<std::uint32_t>(old.size()) : children[last].offset + widthOf(children[last]);
+        region.end = static_cast<std::uint32_t>(oldEnd + delta);
+        region.lexEnd = region.end;
+        if (last < count)
+        {
+            region.after = firstTokenOf(*children[last + 1].node);
+            region.lexEnd += region.after.width;
+        }
+
+        RegionResult result = rebuild(*source, region, rebuilt);
+        if (result == RR_Done)
+        {
+            break;
+        }
+        if (result == RR_WidenLeft)
+        {
+            first--;
+        }
+        else
+        {
+            last = last + 1 == count ? count : last + 1;
+        }
+    }
+
+    auto root = std::make_shared<GreenNode>();
+    for (size_t i = 0; i < first; i++)
+    {
+        appendChild(*root, children[i]);
+    }
+    for (GreenNodePtr &item : rebuilt.items)
+    {
+        appendChild(*root, {std::move(item), {}, 0});
+    }
+    for (size_t i = last + 1; i < count; i++)
+    {
+        appendChild(*root, children[i]);
+    }
+    if (last == count)
+    {
+        appendChild(*root, {nullptr, rebuilt.endOfFile, 0});
+        root->diagnostics = std::move(rebuilt.trailing);
+    }
+    else
+    {
+        appendChild(*root, children[count]);
+        root->diagnostics = rootNode->diagnostics;
+    }
+
+    if (stats)
+    {
+        stats->reparsedItems = static_cast<std::uint32_t>(rebuilt.items.size());
+        stats->reusedItems = static_cast<std::uint32_t>(root->children.size() - 1) - stats->reparsedItems;
+        stats->relexedBytes = region.lexEnd - region.lexBegin;
+    }
+    return SyntaxTree(std::move(source), std::move(root), columns);
+}
+
+SyntaxNode SyntaxTree::root() const
+{
+    return SyntaxNode(std::make_shared<const SyntaxNode::Red>(SyntaxNode::Red{rootNode, nullptr, text, 0}));
+}
+
+std::vector<Diagnostic> SyntaxTree::diagnostics() const
+{
+    std::vector<Diagnostic> result;
+    std::vector<Diagnostic> syntaxErrors;
+    std::string_view content = *text;
+    std::vector<std::uint32_t> lines = lineStarts(content);
+
+    // Columns of the first and last byte of [at, at + length), in the tree's column mode.
+    auto add = [&](std::uint32_t base, const GreenDiagnostic &diagnostic)
+    {
+        std::uint32_t at = std::min(base + diagnostic.offset, static_cast<std::uint32_t>(content.size()));
+        std::uint32_t stop = std::min(at + diagnostic.length, static_cast<std::uint32_t>(content.size()));
+        size_t line = static_cast<size_t>(std::upper_bound(lines.begin(), lines.end(), at) - lines.begin());
+        std::uint32_t lineStart = lines[line - 1];
+        auto columnsIn = [&](std::uint32_t from, std::uint32_t to)
+        {
+            std::uint32_t bytes = to - from;
+            return static_cast<int>(columns == CM_Codepoints ? bytes - Utf8::countContinuationBytes(content.substr(from, bytes)) : bytes);
+        };
+        int start = columnsIn(lineStart, at) + 1;
+        int end = std::max(start, columnsIn(lineStart, std::max(stop, at + 1)));
+        (diagnostic.lexical ? result : syntaxErrors).push_back({static_cast<int>(line), start, end, diagnostic.message});
+    };
+
+    const std::vector<GreenChild> &children = rootNode->children;
+    for (const GreenChild &child : children)
+    {
+        if (child.node)
+        {
+            for (const GreenDiagnostic &diagnostic : child.node->diagnostics)
+            {
+                add(child.offset, diagnostic);
+            }
+        }
+    }
+    for (const GreenDiagnostic &diagnostic : rootNode->diagnostics)
+    {
+        add(children.back().offset, diagnostic);
+    }
+
+    // Lexical errors first at equal positions, like the driver (see mergeDiagnostics()).
+    auto before = [](const Diagnostic &a, const Diagnostic &b)
+    { return a.line < b.line || (a.line == b.line && a.start_column < b.start_column); };
+    std::stable_sort(result.begin(), result.end(), before);
+    std::stable_sort(syntaxErrors.begin(), syntaxErrors.end(), before);
+    mergeDiagnostics(result, syntaxErrors);
+    return result;
+}
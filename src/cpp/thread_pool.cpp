@@ -0,0 +1,203 @@
+/**
+ * @file thread_pool.cpp
+ * @brief Implementation of the work-stealing thread pool.
+ */
+
+#include "../headers/thread_pool.h"
+#include "../headers/trace.h"
+#include <algorithm>
+#include <string>
+
+namespace
+{
+    // Identifies the pool and deque of the worker running on this thread, if any.
+    thread_local ThreadPool *currentPool = nullptr;
+    thread_local unsigned currentIndex = 0;
+}
+
+ThreadPool::ThreadPool(unsigned threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::thread::hardware_concurrency();
+    }
+    if (threadCount == 0)
+    {
+        threadCount = 1;
+    }
+
+    queues.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; i++)
+    {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    workers.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; i++)
+    {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    unsigned index = currentPool == this
+                         ? currentIndex
+                         : nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+
+    pending.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    {
+        // Taking the sleep mutex orders this push before any worker's "nothing to do" check.
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    workAvailable.notify_one();
+}
+
+bool ThreadPool::popLocal(unsigned index, std::function<void()> &task)
+{
+    WorkerQueue &queue = *queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+    {
+        return false;
+    }
+    task = std::move(queue.tasks.front());
+    queue.tasks.pop_front();
+    return true;
+}
+
+bool ThreadPool::steal(unsigned thiefIndex, std::function<void()> &task)
+{
+    const unsigned count = static_cast<unsigned>(queues.size());
+    for (unsigned offset = 1; offset <= count; offset++)
+    {
+        WorkerQueue &queue = *queues[(thiefIndex + offset) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::runTask(std::function<void()> &task)
+{
+    task();
+    task = nullptr;
+    if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        allDone.notify_all();
+    }
+}
+
+void ThreadPool::workerLoop(unsigned index)
+{
+    currentPool = this;
+    currentIndex = index;
+    if (Trace::isEnabled())
+    {
+        Trace::setThreadName("worker " + std::to_string(index));
+    }
+
+    std::function<void()> task;
+    while (true)
+    {
+        if (popLocal(index, task) || steal(index, task))
+        {
+            runTask(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        if (stopping)
+        {
+            return;
+        }
+
+        bool hasWork = false;
+        for (auto &queue : queues)
+        {
+            std::lock_guard<std::mutex> queueLock(queue->mutex);
+            if (!queue->tasks.empty())
+            {
+                hasWork = true;
+                break;
+            }
+        }
+        if (!hasWork)
+        {
+            workAvailable.wait(lock);
+        }
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &body)
+{
+    struct Progress
+    {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> finished{0};
+    };
+
+    // Helpers that only start after the loop is over find no iteration left and
+    // never touch body, but they still read the counters, hence the shared_ptr.
+    auto progress = std::make_shared<Progress>();
+    auto runIterations = [progress, &body, count]
+    {
+        for (size_t i; (i = progress->next.fetch_add(1, std::memory_order_relaxed)) < count;)
+        {
+            body(i);
+            progress->finished.fetch_add(1, std::memory_order_release);
+        }
+    };
+
+    size_t helpers = std::min<size_t>(count, queues.size()) - (count != 0);
+    for (size_t i = 0; i < helpers; i++)
+    {
+        submit(runIterations);
+    }
+    runIterations();
+    while (progress->finished.load(std::memory_order_acquire) != count)
+    {
+        std::this_thread::yield();
+    }
+}
+
+void ThreadPool::wait()
+{
+    std::function<void()> task;
+    while (pending.load(std::memory_order_acquire) != 0)
+    {
+        if (steal(0, task))
+        {
+            runTask(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        allDone.wait(lock, [this]
+                     { return pending.load(std::memory_order_acquire) == 0; });
+    }
+}
@@ -0,0 +1,144 @@
+/**
+ * @file trace.cpp
+ * @brief Implementation of the per-thread trace buffers and the JSON writer.
+ */
+
+#include "../headers/trace.h"
+#include "../headers/utils.h"
+#include <algorithm>
+#include <climits>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Trace
+{
+    std::atomic<bool> enabledFlag{false};
+
+    namespace
+    {
+        struct Event
+        {
+            const char *name;
+            std::uint64_t start;
+            std::uint64_t end;
+            std::string detail;
+        };
+
+        /**
+         * @brief Events of one thread. Owned by the registry so they outlive the thread.
+         */
+        struct ThreadBuffer
+        {
+            unsigned tid;
+            std::string threadName;
+            std::vector<Event> events;
+        };
+
+        std::mutex registryMutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> registry;
+
+        ThreadBuffer &threadBuffer()
+        {
+            thread_local ThreadBuffer *buffer = nullptr;
+            if (!buffer)
+            {
+                std::lock_guard<std::mutex> lock(registryMutex);
+                registry.push_back(std::make_unique<ThreadBuffer>());
+                buffer = registry.back().get();
+                buffer->tid = static_cast<unsigned>(registry.size());
+                buffer->events.reserve(1024);
+            }
+            return *buffer;
+        }
+    }
+
+    void setEnabled(bool enabled)
+    {
+        enabledFlag.store(enabled, std::memory_order_relaxed);
+    }
+
+    void record(const char *name, std::uint64_t startNs, std::uint64_t endNs, std::string_view detail)
+    {
+        threadBuffer().events.push_back({name, startNs, endNs, std::string(detail)});
+    }
+
+    void setThreadName(const std::string &name)
+    {
+        threadBuffer().threadName = name;
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto &buffer : registry)
+        {
+            buffer->events.clear();
+        }
+    }
+
+    bool writeChromeJson(const std::string &path)
+    {
+        std::ofstream output(path, std::ios::trunc);
+        if (!output.is_open())
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(registryMutex);
+
+        // Timestamps are relative to the first event so the viewer starts at zero.
+        std::uint64_t origin = UINT64_MAX;
+        for (const auto &buffer : registry)
+        {
+            for (const auto &event : buffer->events)
+            {
+                origin = std::min(origin, event.start);
+            }
+        }
+        if (origin == UINT64_MAX)
+        {
+            origin = 0;
+        }
+
+        output << std::fixed << std::setprecision(3);
+        output << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+        bool first = true;
+        auto separator = [&]()
+        {
+            if (!first)
+            {
+                output << ",\n";
+            }
+            first = false;
+        };
+
+        for (const auto &buffer : registry)
+        {
+            if (!buffer->threadName.empty())
+            {
+                separator();
+                output << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+                       << ",\"args\":{\"name\":\"" << Utils::escapeJson(buffer->threadName) << "\"}}";
+            }
+
+            for (const auto &event : buffer->events)
+            {
+                separator();
+                output << "{\"name\":\"" << Utils::escapeJson(event.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+                       << ",\"ts\":" << (event.start - origin) / 1000.0
+                       << ",\"dur\":" << (event.end - event.start) / 1000.0;
+                if (!event.detail.empty())
+                {
+                    output << ",\"args\":{\"detail\":\"" << Utils::escapeJson(event.detail) << "\"}";
+                }
+                output << "}";
+            }
+        }
+
+        output << "\n]}\n";
+        return output.good();
+    }
+}
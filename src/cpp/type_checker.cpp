@@ -0,0 +1,498 @@
+/**
+ * @file type_checker.cpp
+ * @brief Implementation of the type table and the type checker.
+ */
+
+#include "../headers/type_checker.h"
+#include <algorithm>
+
+namespace
+{
+    const char *const primitiveNames[] = {"<error>", "void", "int", "float", "char", "string", "bool"};
+
+    static_assert(sizeof(primitiveNames) / sizeof(primitiveNames[0]) == TypePrimitiveCount, "one name per primitive type");
+
+    constexpr size_t MinSlots = 64;
+
+    std::uint64_t mixType(std::uint64_t hash, std::uint64_t value)
+    {
+        return (hash ^ value) * 0x9E3779B97F4A7C15ull;
+    }
+
+    /// Operand types of arithmetic and ordering; char counts as an integer.
+    constexpr bool isNumeric(TypeId type)
+    {
+        return type == TypeInt || type == TypeFloat || type == TypeChar;
+    }
+
+    constexpr bool isInteger(TypeId type)
+    {
+        return type == TypeInt || type == TypeChar;
+    }
+
+    /// Whether a value of type @p value may be stored where @p target is expected (see the file comment).
+    constexpr bool assignable(TypeId target, TypeId value)
+    {
+        return target == value || target == TypeError || value == TypeError ||
+               (target == TypeFloat && isInteger(value)) || (target == TypeInt && value == TypeChar);
+    }
+
+    constexpr TypeId typeOfKeyword(TokenKind kind)
+    {
+        switch (kind)
+        {
+        case TK_TypeInteger:
+            return TypeInt;
+        case TK_TypeFloat:
+            return TypeFloat;
+        case TK_TypeChar:
+            return TypeChar;
+        case TK_TypeString:
+            return TypeString;
+        case TK_TypeBool:
+            return TypeBool;
+        default:
+            return TypeError;
+        }
+    }
+
+    constexpr TypeId typeOfLiteral(TokenKind kind)
+    {
+        switch (kind)
+        {
+        case TK_Integer:
+            return TypeInt;
+        case TK_Float:
+            return TypeFloat;
+        case TK_Char:
+            return TypeChar;
+        case TK_String:
+            return TypeString;
+        case TK_True:
+        case TK_False:
+            return TypeBool;
+        default:
+            return TypeError;
+        }
+    }
+}
+
+TypeTable::TypeTable()
+{
+    for (TypeId type = 0; type < TypePrimitiveCount; type++)
+    {
+        types.push_back({TY_Primitive, 0, 0, 0});
+        names.push_back(primitiveNames[type]);
+    }
+    slots.assign(MinSlots, TypeError);
+}
+
+TypeId TypeTable::function(TypeId result, const TypeId *parameters, std::uint32_t count)
+{
+    // Stored as one run of components, result first, which is also what is hashed and compared.
+    size_t mark = components.size();
+    components.push_back(result);
+    components.insert(components.end(), parameters, parameters + count);
+    TypeId type = intern(TY_Function, static_cast<std::uint32_t>(mark), components.data() + mark, count + 1);
+    if (types[type].first != mark)
+    {
+        components.resize(mark);
+    }
+    return type;
+}
+
+TypeId TypeTable::builtin(Builtin which)
+{
+    return intern(TY_Builtin, which, nullptr, 0);
+}
+
+TypeId TypeTable::intern(TypeKind kind, std::uint32_t first, const TypeId *parts, std::uint32_t count)
+{
+    std::uint64_t hash = mixType(kind, kind == TY_Builtin ? first : count);
+    for (std::uint32_t i = 0; i < count; i++)
+    {
+        hash = mixType(hash, parts[i]);
+    }
+
+    size_t mask = slots.size() - 1;
+    size_t i = static_cast<size_t>(hash >> 32) & mask;
+    for (; slots[i] != TypeError; i = (i + 1) & mask)
+    {
+        const Type &candidate = types[slots[i]];
+        if (candidate.hash != hash || candidate.kind != kind)
+        {
+            continue;
+        }
+        if (kind == TY_Builtin ? candidate.first == first
+                               : candidate.count == count && std::equal(parts, parts + count, components.data() + candidate.first))
+        {
+            return slots[i];
+        }
+    }
+
+    TypeId type = static_cast<TypeId>(types.size());
+    types.push_back({kind, first, count, hash});
+    if (kind == TY_Builtin)
+    {
+        names.push_back(std::string("builtin ") + builtinName(builtinOf(type)));
+    }
+    else
+    {
+        std::string text = "function(";
+        for (std::uint32_t p = 1; p < count; p++)
+        {
+            text.append(p == 1 ? "" : ", ").append(names[parts[p]]);
+        }
+        names.push_back(text.append(") ").append(names[parts[0]]));
+    }
+    slots[i] = type;
+    if (2 * (types.size() - TypePrimitiveCount) > slots.size())
+    {
+        grow();
+    }
+    return type;
+}
+
+void TypeTable::grow()
+{
+    slots.assign(slots.size() * 2, TypeError);
+    size_t mask = slots.size() - 1;
+    for (TypeId type = TypePrimitiveCount; type < types.size(); type++)
+    {
+        size_t i = static_cast<size_t>(types[type].hash >> 32) & mask;
+        while (slots[i] != TypeError)
+        {
+            i = (i + 1) & mask;
+        }
+        slots[i] = type;
+    }
+}
+
+void TypeTable::clear()
+{
+    if (types.size() > TypePrimitiveCount)
+    {
+        types.resize(TypePrimitiveCount);
+        names.resize(TypePrimitiveCount);
+        components.clear();
+        std::fill(slots.begin(), slots.end(), TypeError);
+    }
+}
+
+const std::vector<TypeId> &TypeChecker::check(const AstView &input, const std::vector<Token> &inputTokens, const Resolution &names, CompilationArena &messageArena)
+{
+    tree = input;
+    tokens = &inputTokens;
+    resolution = &names;
+    arena = &messageArena;
+    typeTable.clear();
+    nodeTypes.assign(tree.size(), TypeVoid);
+    diagnosticBuffer.clear();
+    if (tree.empty())
+    {
+        return nodeTypes;
+    }
+
+    // Function types first: children are the result type, the parameters and the body.
+    ChildRange items = tree.children(tree.root());
+    for (NodeIndex item : items)
+    {
+        if (tree.kind(item) == NK_Function)
+        {
+            ChildRange children = tree.children(item);
+            parameterScratch.clear();
+            for (std::uint32_t i = 1; i + 1 < children.size(); i++)
+            {
+                parameterScratch.push_back(declaredType(tree.children(children[i])[0]));
+            }
+            nodeTypes[item] = typeTable.function(declaredType(children[0]), parameterScratch.data(),
+                                                 static_cast<std::uint32_t>(parameterScratch.size()));
+        }
+    }
+
+    // Each item's nodes are the range after the previous item's, ending at the item itself.
+    NodeIndex node = 0;
+    for (NodeIndex item : items)
+    {
+        insideFunction = tree.kind(item) == NK_Function;
+        returnType = insideFunction ? typeTable.result(nodeTypes[item]) : TypeVoid;
+        for (; node < item; node++)
+        {
+            nodeTypes[node] = typeOf(node);
+        }
+        if (!insideFunction)
+        {
+            nodeTypes[item] = typeOf(item);
+        }
+        node = item + 1;
+    }
+
+    // Operators are reported after their operands, which may start later on the line.
+    std::sort(diagnosticBuffer.begin(), diagnosticBuffer.end(), [](const Diagnostic &a, const Diagnostic &b)
+              { return a.line != b.line ? a.line < b.line : a.start_column < b.start_column; });
+    return nodeTypes;
+}
+
+TypeId TypeChecker::typeOf(NodeIndex node)
+{
+    ChildRange children = tree.children(node);
+    const Token &token = (*tokens)[tree.token(node)];
+    switch (tree.kind(node))
+    {
+    case NK_Type:
+    case NK_Empty:
+        return declaredType(node);
+    case NK_Literal:
+        return typeOfLiteral(token.type);
+    case NK_Name:
+    {
+        std::uint32_t symbol = resolution->bindings[node];
+        if (symbol == NoBinding)
+        {
+            return TypeError;
+        }
+        const SymbolInfo &info = resolution->symbols[symbol];
+        switch (info.kind)
+        {
+        case SK_Builtin:
+            return typeTable.builtin(static_cast<Builtin>(info.slot));
+        case SK_Function:
+            return nodeTypes[info.declaration];
+        default:
+            return declaredType(tree.children(info.declaration)[0]);
+        }
+    }
+    case NK_Parameter:
+        return declaredType(children[0]);
+    case NK_VarDecl:
+    {
+        TypeId declared = declaredType(children[0]);
+        if (children.size() > 1 && !assignable(declared, nodeTypes[children[1]]))
+        {
+            report(tree.token(node), {"Cannot initialise '", token.value, "' of type ", typeTable.name(declared),
+                                      " with ", typeTable.name(nodeTypes[children[1]])});
+        }
+        return declared;
+    }
+    case NK_Unary:
+        return unary(node);
+    case NK_Binary:
+        return binary(node);
+    case NK_Assign:
+        return assign(node);
+    case NK_Call:
+        return call(node);
+    case NK_If:
+        expectCondition(node, children[0]);
+        return TypeVoid;
+    case NK_For:
+        expectCondition(node, children[1]);
+        return TypeVoid;
+    case NK_Return:
+        if (children.size() == 0)
+        {
+            if (returnType != TypeVoid)
+            {
+                report(tree.token(node), {"Missing return value in a function returning ", typeTable.name(returnType)});
+            }
+        }
+        else if (!insideFunction)
+        {
+            report(tree.token(node), {"Return with a value outside a function"});
+        }
+        else if (returnType == TypeVoid)
+        {
+            report(tree.token(node), {"Return with a value in a function returning void"});
+        }
+        else if (!assignable(returnType, nodeTypes[children[0]]))
+        {
+            report(tree.token(node), {"Return value must be ", typeTable.name(returnType), " but is ", typeTable.name(nodeTypes[children[0]])});
+        }
+        return TypeVoid;
+    case NK_Function:
+        return nodeTypes[node];
+    default:
+        return TypeVoid;
+    }
+}
+
+TypeId TypeChecker::declaredType(NodeIndex typeNode) const
+{
+    // An omitted result type is an NK_Empty node.
+    return tree.kind(typeNode) == NK_Type ? typeOfKeyword((*tokens)[tree.token(typeNode)].type) : TypeVoid;
+}
+
+TypeId TypeChecker::binary(NodeIndex node)
+{
+    ChildRange children = tree.children(node);
+    TypeId left = nodeTypes[children[0]];
+    TypeId right = nodeTypes[children[1]];
+    if (left == TypeError || right == TypeError)
+    {
+        return TypeError;
+    }
+
+    const Token &op = (*tokens)[tree.token(node)];
+    switch (op.type)
+    {
+    case TK_Plus:
+    case TK_Minus:
+    case TK_Star:
+    case TK_Slash:
+        if (isNumeric(left) && isNumeric(right))
+        {
+            return left == TypeFloat || right == TypeFloat ? TypeFloat : TypeInt;
+        }
+        break;
+    case TK_Percent:
+        if (isInteger(left) && isInteger(right))
+        {
+            return TypeInt;
+        }
+        break;
+    case TK_EqualEqual:
+    case TK_NotEqual:
+        if (left == right && (left == TypeBool || left == TypeString))
+        {
+            return TypeBool;
+        }
+        [[fallthrough]];
+    case TK_Less:
+    case TK_Greater:
+    case TK_LessEqual:
+    case TK_GreaterEqual:
+        if (isNumeric(left) && isNumeric(right))
+        {
+            return TypeBool;
+        }
+        break;
+    case TK_AndAnd:
+    case TK_OrOr:
+        if (left == TypeBool && right == TypeBool)
+        {
+            return TypeBool;
+        }
+        break;
+    default:
+        break;
+    }
+
+    report(tree.token(node), {"Operator '", op.value, "' cannot be applied to ", typeTable.name(left), " and ", typeTable.name(right)});
+    return TypeError;
+}
+
+TypeId TypeChecker::unary(NodeIndex node)
+{
+    TypeId operand = nodeTypes[tree.children(node)[0]];
+    const Token &op = (*tokens)[tree.token(node)];
+    if (operand == TypeError)
+    {
+        return TypeError;
+    }
+    if (op.type == TK_Minus && isNumeric(operand))
+    {
+        return operand == TypeFloat ? TypeFloat : TypeInt;
+    }
+    if (op.type == TK_Not && operand == TypeBool)
+    {
+        return TypeBool;
+    }
+
+    report(tree.token(node), {"Operator '", op.value, "' cannot be applied to ", typeTable.name(operand)});
+    return TypeError;
+}
+
+TypeId TypeChecker::assign(NodeIndex node)
+{
+    ChildRange children = tree.children(node);
+    NodeIndex target = children[0];
+    TypeId targetType = nodeTypes[target];
+    TypeId value = nodeTypes[children[1]];
+    std::uint32_t symbol = resolution->bindings[target];
+    if (symbol == NoBinding)
+    {
+        return TypeError;
+    }
+
+    std::string_view name = (*tokens)[tree.token(target)].value;
+    SymbolKind kind = resolution->symbols[symbol].kind;
+    if (kind != SK_Global && kind != SK_Local)
+    {
+        report(tree.token(target), {"Cannot assign to '", name, "', which is not a variable"});
+        return TypeError;
+    }
+    if (!assignable(targetType, value))
+    {
+        report(tree.token(node), {"Cannot assign ", typeTable.name(value), " to '", name, "' of type ", typeTable.name(targetType)});
+    }
+    return targetType;
+}
+
+TypeId TypeChecker::call(NodeIndex node)
+{
+    ChildRange children = tree.children(node);
+    NodeIndex callee = children[0];
+    TypeId function = nodeTypes[callee];
+    std::uint32_t given = children.size() - 1;
+    if (function == TypeError)
+    {
+        return TypeError;
+    }
+
+    std::string_view name = tree.kind(callee) == NK_Name ? (*tokens)[tree.token(callee)].value : std::string_view("the callee");
+    std::string givenText = std::to_string(given);
+    if (typeTable.kind(function) == TY_Builtin)
+    {
+        // print(value) takes one value of any primitive type.
+        if (given != 1)
+        {
+            report(tree.token(callee), {"'", name, "' takes 1 argument but is given ", givenText});
+            return TypeError;
+        }
+        TypeId argument = nodeTypes[children[1]];
+        if (argument == TypeVoid || typeTable.kind(argument) != TY_Primitive)
+        {
+            report(tree.token(children[1]), {"Cannot print a value of type ", typeTable.name(argument)});
+        }
+        return TypeVoid;
+    }
+    if (typeTable.kind(function) != TY_Function)
+    {
+        report(tree.token(callee), {"'", name, "' is not a function"});
+        return TypeError;
+    }
+
+    std::uint32_t expected = typeTable.parameterCount(function);
+    if (given != expected)
+    {
+        report(tree.token(callee), {"'", name, "' takes ", std::to_string(expected), expected == 1 ? " argument" : " arguments",
+                                    " but is given ", givenText});
+        return typeTable.result(function);
+    }
+    for (std::uint32_t i = 0; i < given; i++)
+    {
+        TypeId parameter = typeTable.parameter(function, i);
+        TypeId argument = nodeTypes[children[i + 1]];
+        if (!assignable(parameter, argument))
+        {
+            report(tree.token(children[i + 1]), {"Argument ", std::to_string(i + 1), " of '", name, "' must be ",
+                                                 typeTable.name(parameter), " but is ", typeTable.name(argument)});
+        }
+    }
+    return typeTable.result(function);
+}
+
+void TypeChecker::expectCondition(NodeIndex node, NodeIndex condition)
+{
+    TypeId type = nodeTypes[condition];
+    if (tree.kind(condition) != NK_Empty && type != TypeBool && type != TypeError)
+    {
+        report(tree.token(node), {"Condition must be bool but is ", typeTable.name(type)});
+    }
+}
+
+void TypeChecker::report(std::uint32_t token, std::initializer_list<std::string_view> message)
+{
+    const Token &at = (*tokens)[token];
+    diagnosticBuffer.push_back({at.line, at.start_column, at.end_column, arena->concat(message)});
+}
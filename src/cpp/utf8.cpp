@@ -0,0 +1,314 @@
+/**
+ * @file utf8.cpp
+ * @brief Implementation of the UTF-8 validator, decoder and XID tables.
+ */
+
+#include "../headers/utf8.h"
+#include "../headers/xid_tables.h"
+#include <algorithm>
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define BASSIL_UTF8_SSSE3 1
+#include <immintrin.h>
+#endif
+
+namespace Utf8
+{
+    namespace
+    {
+        bool isContinuation(unsigned char c)
+        {
+            return (c & 0xC0) == 0x80;
+        }
+
+        size_t findInvalidScalar(std::string_view text, bool &ascii)
+        {
+            ascii = true;
+            const char *data = text.data();
+            const char *end = data + text.size();
+            const char *p = data;
+            while (p != end)
+            {
+                std::uint64_t word;
+                if (end - p >= 8 && (std::memcpy(&word, p, 8), (word & 0x8080808080808080ull) == 0))
+                {
+                    p += 8;
+                    continue;
+                }
+                if (static_cast<unsigned char>(*p) < 0x80)
+                {
+                    p++;
+                    continue;
+                }
+                ascii = false;
+                std::uint32_t codepoint;
+                int length = decode(p, end, codepoint);
+                if (length == 0)
+                {
+                    return static_cast<size_t>(p - data);
+                }
+                p += length;
+            }
+            return std::string_view::npos;
+        }
+
+#ifdef BASSIL_UTF8_SSSE3
+        // Error classes of the lookup algorithm; a byte pair is invalid when the
+        // three lookups agree on at least one class.
+        constexpr std::uint8_t TooShort = 1 << 0;     // 11______ 0_______ or 11______ 11______
+        constexpr std::uint8_t TooLong = 1 << 1;      // 0_______ 10______
+        constexpr std::uint8_t Overlong3 = 1 << 2;    // 11100000 100_____
+        constexpr std::uint8_t TooLarge = 1 << 3;     // 11110100 1001____ and above
+        constexpr std::uint8_t Surrogate = 1 << 4;    // 11101101 101_____
+        constexpr std::uint8_t Overlong2 = 1 << 5;    // 1100000_ 10______
+        constexpr std::uint8_t TooLarge1000 = 1 << 6; // 11110101 1000____ and above
+        constexpr std::uint8_t Overlong4 = 1 << 6;    // 11110000 1000____
+        constexpr std::uint8_t TwoConts = 1 << 7;     // 10______ 10______
+        constexpr std::uint8_t Carry = TooShort | TooLong | TwoConts;
+
+        alignas(16) const std::uint8_t byte1HighTable[16] = {
+            TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong,
+            TwoConts, TwoConts, TwoConts, TwoConts,
+            TooShort | Overlong2,
+            TooShort,
+            TooShort | Overlong3 | Surrogate,
+            TooShort | TooLarge | TooLarge1000 | Overlong4};
+
+        alignas(16) const std::uint8_t byte1LowTable[16] = {
+            Carry | Overlong3 | Overlong2 | Overlong4,
+            Carry | Overlong2,
+            Carry,
+            Carry,
+            Carry | TooLarge,
+            Carry | TooLarge | TooLarge1000,
+            Carry | TooLarge | TooLarge1000,
+            Carry | TooLarge | TooLarge1000,
+            Carry | TooLarge | TooLarge1000,
+            Carry | TooLarge | TooLarge1000,
+            Carry | TooLarge | TooLarge1000,
+            Carry | TooLarge | TooLarge1000,
+            Carry | TooLarge | TooLarge1000,
+            Carry | TooLarge | TooLarge1000 | Surrogate,
+            Carry | TooLarge | TooLarge1000,
+            Carry | TooLarge | TooLarge1000};
+
+        alignas(16) const std::uint8_t byte2HighTable[16] = {
+            TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort,
+            TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge1000 | Overlong4,
+            TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge,
+            TooLong | Overlong2 | TwoConts | Surrogate | TooLarge,
+            TooLong | Overlong2 | TwoConts | Surrogate | TooLarge,
+            TooShort, TooShort, TooShort, TooShort};
+
+        // A block ending in the first bytes of a sequence leaves it incomplete.
+        alignas(16) const std::uint8_t incompleteLimits[16] = {
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1};
+
+        struct Ssse3State
+        {
+            __m128i previous;
+            __m128i previousIncomplete;
+            __m128i error;
+            __m128i seen; ///< OR of all input bytes, to tell pure ASCII apart
+        };
+
+        __attribute__((target("ssse3"))) inline void checkBlock(__m128i input, Ssse3State &state)
+        {
+            state.seen = _mm_or_si128(state.seen, input);
+            if (_mm_movemask_epi8(input) == 0)
+            {
+                // Pure ASCII: only a sequence cut off by the previous block can be wrong.
+                state.error = _mm_or_si128(state.error, state.previousIncomplete);
+            }
+            else
+            {
+                const __m128i lowNibble = _mm_set1_epi8(0x0F);
+                __m128i prev1 = _mm_alignr_epi8(input, state.previous, 15);
+                __m128i byte1High = _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(byte1HighTable)),
+                                                     _mm_and_si128(_mm_srli_epi16(prev1, 4), lowNibble));
+                __m128i byte1Low = _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(byte1LowTable)),
+                                                    _mm_and_si128(prev1, lowNibble));
+                __m128i byte2High = _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(byte2HighTable)),
+                                                     _mm_and_si128(_mm_srli_epi16(input, 4), lowNibble));
+                __m128i special = _mm_and_si128(_mm_and_si128(byte1High, byte1Low), byte2High);
+
+                // Bytes 3 and 4 of a sequence must be continuations, which the pair check cannot see.
+                __m128i prev2 = _mm_alignr_epi8(input, state.previous, 14);
+                __m128i prev3 = _mm_alignr_epi8(input, state.previous, 13);
+                __m128i isThirdByte = _mm_subs_epu8(prev2, _mm_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+                __m128i isFourthByte = _mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+                __m128i mustBeContinuation = _mm_and_si128(_mm_or_si128(isThirdByte, isFourthByte), _mm_set1_epi8(static_cast<char>(0x80)));
+
+                state.error = _mm_or_si128(state.error, _mm_xor_si128(mustBeContinuation, special));
+                state.previousIncomplete = _mm_subs_epu8(input, _mm_load_si128(reinterpret_cast<const __m128i *>(incompleteLimits)));
+            }
+            state.previous = input;
+        }
+
+        __attribute__((target("ssse3"))) bool validateSsse3(std::string_view text, bool &ascii)
+        {
+            const char *data = text.data();
+            size_t size = text.size();
+            Ssse3State state = {_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128()};
+
+            size_t i = 0;
+            for (; i + 64 <= size; i += 64)
+            {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 16));
+                __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 32));
+                __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 48));
+                if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d))) == 0)
+                {
+                    // 64 ASCII bytes: settle any sequence left open and skip the lookups.
+                    state.error = _mm_or_si128(state.error, state.previousIncomplete);
+                    state.previousIncomplete = _mm_setzero_si128();
+                    state.previous = d;
+                    continue;
+                }
+                checkBlock(a, state);
+                checkBlock(b, state);
+                checkBlock(c, state);
+                checkBlock(d, state);
+            }
+            for (; i + 16 <= size; i += 16)
+            {
+                checkBlock(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i)), state);
+            }
+            if (i < size)
+            {
+                alignas(16) char tail[16] = {};
+                std::memcpy(tail, data + i, size - i);
+                checkBlock(_mm_load_si128(reinterpret_cast<const __m128i *>(tail)), state);
+            }
+
+            ascii = _mm_movemask_epi8(state.seen) == 0;
+            __m128i error = _mm_or_si128(state.error, state.previousIncomplete);
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+        }
+
+        const bool hasSsse3 = __builtin_cpu_supports("ssse3");
+#endif
+
+        bool inRanges(const std::uint32_t (*ranges)[2], size_t count, std::uint32_t codepoint)
+        {
+            const std::uint32_t (*end)[2] = ranges + count;
+            const std::uint32_t (*range)[2] = std::upper_bound(ranges, end, codepoint,
+                                                                [](std::uint32_t c, const std::uint32_t (&r)[2])
+                                                                { return c < r[0]; });
+            return range != ranges && codepoint <= range[-1][1];
+        }
+    }
+
+    size_t findInvalid(std::string_view text, bool *isAscii)
+    {
+        bool ascii;
+        size_t invalid;
+#ifdef BASSIL_UTF8_SSSE3
+        if (hasSsse3)
+        {
+            // The vector check only says whether there is an error; locate it with the scalar one.
+            invalid = validateSsse3(text, ascii) ? std::string_view::npos : findInvalidScalar(text, ascii);
+        }
+        else
+#endif
+        {
+            invalid = findInvalidScalar(text, ascii);
+        }
+        if (isAscii)
+        {
+            *isAscii = ascii;
+        }
+        return invalid;
+    }
+
+    int decode(const char *p, const char *end, std::uint32_t &codepoint)
+    {
+        const unsigned char *s = reinterpret_cast<const unsigned char *>(p);
+        size_t available = static_cast<size_t>(end - p);
+        unsigned char lead = s[0];
+
+        if (lead < 0x80)
+        {
+            codepoint = lead;
+            return 1;
+        }
+        if (lead < 0xC2)
+        {
+            return 0; // Continuation byte, or an overlong two-byte lead
+        }
+        if (lead < 0xE0)
+        {
+            if (available < 2 || !isContinuation(s[1]))
+            {
+                return 0;
+            }
+            codepoint = (static_cast<std::uint32_t>(lead & 0x1F) << 6) | (s[1] & 0x3F);
+            return 2;
+        }
+        if (lead < 0xF0)
+        {
+            if (available < 3 || !isContinuation(s[1]) || !isContinuation(s[2]) ||
+                (lead == 0xE0 && s[1] < 0xA0) || // Overlong
+                (lead == 0xED && s[1] > 0x9F))   // Surrogate
+            {
+                return 0;
+            }
+            codepoint = (static_cast<std::uint32_t>(lead & 0x0F) << 12) | (static_cast<std::uint32_t>(s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+            return 3;
+        }
+        if (lead < 0xF5)
+        {
+            if (available < 4 || !isContinuation(s[1]) || !isContinuation(s[2]) || !isContinuation(s[3]) ||
+                (lead == 0xF0 && s[1] < 0x90) || // Overlong
+                (lead == 0xF4 && s[1] > 0x8F))   // Above U+10FFFF
+            {
+                return 0;
+            }
+            codepoint = (static_cast<std::uint32_t>(lead & 0x07) << 18) | (static_cast<std::uint32_t>(s[1] & 0x3F) << 12) |
+                        (static_cast<std::uint32_t>(s[2] & 0x3F) << 6) | (s[3] & 0x3F);
+            return 4;
+        }
+        return 0;
+    }
+
+    size_t countContinuationBytes(std::string_view text)
+    {
+        const char *p = text.data();
+        const char *end = p + text.size();
+        size_t count = 0;
+        for (; end - p >= 8; p += 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, p, 8);
+            // Bit 7 set and bit 6 clear, gathered into the top bit of each byte, then summed.
+            std::uint64_t marks = (word & ~(word << 1) & 0x8080808080808080ull) >> 7;
+            count += static_cast<size_t>((marks * 0x0101010101010101ull) >> 56);
+        }
+        for (; p != end; p++)
+        {
+            count += isContinuation(static_cast<unsigned char>(*p));
+        }
+        return count;
+    }
+
+    bool isXidStart(std::uint32_t codepoint)
+    {
+        if (codepoint < 0x80)
+        {
+            return ((codepoint | 0x20) - 'a') < 26 || codepoint == '_';
+        }
+        return inRanges(xidStartRanges, sizeof(xidStartRanges) / sizeof(xidStartRanges[0]), codepoint);
+    }
+
+    bool isXidContinue(std::uint32_t codepoint)
+    {
+        if (codepoint < 0x80)
+        {
+            return ((codepoint | 0x20) - 'a') < 26 || (codepoint - '0') < 10 || codepoint == '_';
+        }
+        return inRanges(xidContinueRanges, sizeof(xidContinueRanges) / sizeof(xidContinueRanges[0]), codepoint);
+    }
+}
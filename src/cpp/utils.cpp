@@ -7,8 +7,8 @@
  * output formatting capabilities. These utilities are designed to support
  * the core functionality of the Bassil language project.
  *
- * @note This file requires Windows-specific headers and may not be
- * compatible with non-Windows environments.
+ * @note The Windows API helpers are only compiled when building for Windows
+ * (_WIN32). On other platforms the console helpers fall back to POSIX calls.
  *
  * @author Nerd Bear
  * @date 31 August 2024
@@ -19,12 +19,19 @@
  * @see utils.h
  */
 
-#include "C:/coding-projects/CPP-Dev/bassil/src/headers/utils.h"
+#include "../headers/utils.h"
+#include "../headers/trace.h"
 #include <algorithm>
 #include <stdexcept>
 #include <fstream>
 #include <limits>
+#include <mutex>
+
+#ifdef _WIN32
 #include <strsafe.h> // include for StringCchCopyW
+#else
+#include <unistd.h>
+#endif
 
 /**
  * @brief Fallback implementation of StringCchCopyW if not available in the system headers.
@@ -39,7 +46,7 @@
  *
  * @note This macro should only be used if StringCchCopyW is not defined.
  */
-#ifndef StringCchCopyW
+#if defined(_WIN32) && !defined(StringCchCopyW)
 #define StringCchCopyW(dest, destSize, src) wcscpy_s(dest, destSize, src)
 #endif
 
@@ -88,6 +95,7 @@ namespace Utils
         return tokens;
     }
 
+#ifdef _WIN32
     /**
      * @brief Converts a standard string to a wide string.
      *
@@ -372,6 +380,7 @@ namespace Utils
         exit(-1)
 #endif
     }
+#endif
 
     /**
      * @brief Trims leading whitespace from a string.
@@ -481,7 +490,8 @@ namespace Utils
      *
      * @return int Returns 0 on successful logging, 1 if there was an error opening the log file.
      *
-     * @note The log file is located at "C:/coding-projects/CPP-Dev/bassil/output/Run-0001/logs.log".
+     * @note The log file defaults to "C:/coding-projects/CPP-Dev/bassil/output/logs.log" and can be
+     *       redirected with setLogFilePath().
      * @note The function opens the file in append mode, so new log entries are added to the end of the file.
      * @note Each log entry is written on a new line.
      *
@@ -495,6 +505,19 @@ namespace Utils
      * }
      * @endcode
      */
+    static std::string logFilePath = "C:/coding-projects/CPP-Dev/bassil/output/logs.log";
+    static std::mutex logMutex; // general_log may be called from driver worker threads
+
+    void setLogFilePath(const std::string &path)
+    {
+        logFilePath = path;
+    }
+
+    const std::string &getLogFilePath()
+    {
+        return logFilePath;
+    }
+
     int general_log(const std::string &str, bool isPrintTrue)
     {
         if (!isPrintTrue)
@@ -502,7 +525,9 @@ namespace Utils
             return 0;
         }
 
-        std::ofstream outputFile("C:/coding-projects/CPP-Dev/bassil/output/logs.log", std::ios::app);
+        BASSIL_TRACE_SCOPE("general_log");
+        std::lock_guard<std::mutex> lock(logMutex);
+        std::ofstream outputFile(logFilePath, std::ios::app);
         if (!outputFile.is_open())
         {
             std::cerr << "[general_log] Failed to open file." << std::endl;
@@ -561,7 +586,20 @@ namespace Utils
         {
             throw std::runtime_error("[readFileToString] Unable to open file");
         }
-        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        // One read of the whole file; a stream that cannot tell its size (a pipe) is copied as it comes.
+        file.seekg(0, std::ios::end);
+        std::streamoff size = file.tellg();
+        if (size < 0)
+        {
+            file.clear();
+            file.seekg(0, std::ios::beg);
+            return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        }
+        file.seekg(0, std::ios::beg);
+        std::string content(static_cast<size_t>(size), '\0');
+        file.read(&content[0], size);
+        content.resize(static_cast<size_t>(file.gcount())); // Text mode may drop carriage returns
+        return content;
     }
 
     /**
@@ -593,6 +631,10 @@ namespace Utils
      */
     int enableAnsiInConsole()
     {
+#ifndef _WIN32
+        // POSIX terminals interpret ANSI sequences natively; only a redirected stream lacks them.
+        return isatty(STDOUT_FILENO) ? 0 : 1;
+#else
         HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
         DWORD mode = 0;
         if (!GetConsoleMode(hConsole, &mode))
@@ -606,6 +648,7 @@ namespace Utils
         }
 
         return 0;
+#endif
     }
 
     /**
@@ -635,6 +678,9 @@ namespace Utils
      */
     bool isAnsiEnabledInConsole()
     {
+#ifndef _WIN32
+        return isatty(STDOUT_FILENO) != 0;
+#else
         HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
         DWORD mode = 0;
         if (!GetConsoleMode(hConsole, &mode))
@@ -642,6 +688,7 @@ namespace Utils
             return false;
         }
         return (mode & ENABLE_VIRTUAL_TERMINAL_PROCESSING) != 0;
+#endif
     }
 
     /**
@@ -1034,6 +1081,65 @@ namespace Utils
         return wrapped.str();
     }
 
+    /**
+     * @brief Escapes a string for use inside a JSON string literal.
+     *
+     * Quotes and backslashes are backslash-escaped, the common control characters
+     * use their short forms and any other byte below 0x20 is written as \u00XX.
+     * Bytes >= 0x80 are copied unchanged, so valid UTF-8 stays valid.
+     *
+     * @param text The raw text.
+     *
+     * @return std::string The escaped text, without surrounding quotes.
+     *
+     * @par Example:
+     * @code
+     * std::string json = "\"" + Utils::escapeJson("say \"hi\"\n") + "\"";
+     * // json == "\"say \\\"hi\\\"\\n\""
+     * @endcode
+     */
+    std::string escapeJson(std::string_view text)
+    {
+        static const char hexDigits[] = "0123456789abcdef";
+
+        std::string escaped;
+        escaped.reserve(text.size() + 2);
+        for (char c : text)
+        {
+            switch (c)
+            {
+            case '"':
+                escaped += "\\\"";
+                break;
+            case '\\':
+                escaped += "\\\\";
+                break;
+            case '\n':
+                escaped += "\\n";
+                break;
+            case '\r':
+                escaped += "\\r";
+                break;
+            case '\t':
+                escaped += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    escaped += "\\u00";
+                    escaped += hexDigits[(c >> 4) & 0xF];
+                    escaped += hexDigits[c & 0xF];
+                }
+                else
+                {
+                    escaped += c;
+                }
+            }
+        }
+        return escaped;
+    }
+
+#ifdef _WIN32
     /**
      * @brief Sets the file association icon for a specific file extension.
      *
@@ -1106,6 +1212,7 @@ namespace Utils
 
         return true;
     }
+#endif
 
     /**
      * @brief Reads a specific line from a file.
@@ -0,0 +1,366 @@
+/**
+ * @file watch.cpp
+ * @brief Implementation of the inotify based watch mode.
+ */
+
+#include "../headers/watch.h"
+#include "../headers/source_cache.h"
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <set>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace Watch
+{
+#ifdef __linux__
+    namespace
+    {
+        /**
+         * @brief A watched directory and the command line input it belongs to.
+         */
+        struct WatchedDirectory
+        {
+            std::string path; ///< The directory
+            std::string root; ///< The directory input it was found under (empty for file inputs)
+        };
+
+        /**
+         * @brief State of a running watch session.
+         */
+        class Watcher
+        {
+        public:
+            Watcher(int inotifyFd, const Driver::Options &options) : fd(inotifyFd), options(options), cache(options.columnMode) {}
+
+            /**
+             * @brief Adds watches for an input and registers the sources it contains.
+             * @param input A file or directory from the command line.
+             */
+            void addInput(const std::string &input)
+            {
+                std::error_code ec;
+                std::string absolute = fs::absolute(input, ec).lexically_normal().string();
+                if (fs::is_directory(absolute, ec))
+                {
+                    roots.insert(absolute);
+                    addDirectory(absolute, absolute);
+                }
+                else
+                {
+                    // inotify can't follow an editor's write-to-temp-and-rename on the file itself.
+                    std::string parent = fs::path(absolute).parent_path().string();
+                    int wd = inotify_add_watch(fd, parent.c_str(), eventMask);
+                    if (wd >= 0)
+                    {
+                        // The parent may be a directory input too (same wd); keep its root then.
+                        directories.emplace(wd, WatchedDirectory{parent, ""});
+                    }
+                    singleFiles.insert(absolute);
+                    dirty.insert(absolute);
+                }
+            }
+
+            /**
+             * @brief Drains all pending inotify events into the dirty set.
+             * @return bool False if reading the inotify descriptor failed.
+             */
+            bool readEvents()
+            {
+                alignas(inotify_event) char buffer[64 * 1024];
+                while (true)
+                {
+                    ssize_t length = ::read(fd, buffer, sizeof(buffer));
+                    if (length < 0)
+                    {
+                        return errno == EAGAIN || errno == EINTR;
+                    }
+                    if (length == 0)
+                    {
+                        return true;
+                    }
+
+                    for (char *cursor = buffer; cursor < buffer + length;)
+                    {
+                        auto *event = reinterpret_cast<inotify_event *>(cursor);
+                        handleEvent(*event);
+                        cursor += sizeof(inotify_event) + event->len;
+                    }
+                }
+            }
+
+            /**
+             * @brief Re-lexes the files touched since the last call and reports them.
+             */
+            void processDirty()
+            {
+                std::set<std::string> batch;
+                batch.swap(dirty);
+
+                for (const auto &path : batch)
+                {
+                    Driver::SourceFile source = sourceFor(path);
+
+                    bool changed = false;
+                    std::shared_ptr<const CachedSource> entry = cache.get(path, &changed);
+                    if (!entry)
+                    {
+                        if (known.erase(path) != 0)
+                        {
+                            std::string outputPath = Driver::tokenOutputPath(source, options);
+                            std::error_code ec;
+                            if (!outputPath.empty())
+                            {
+                                fs::remove(outputPath, ec);
+                            }
+                            std::cout << source.path << ": removed\n";
+                        }
+                        continue;
+                    }
+
+                    known.insert(path);
+                    if (!changed && !rebuildAll)
+                    {
+                        continue; // Saved without modification
+                    }
+
+                    Driver::FileResult result;
+                    result.ok = true;
+                    result.tokenCount = entry->tokens.size();
+                    result.diagnostics = entry->diagnostics;
+                    result.arena = entry->arena;
+                    if (!Driver::writeTokenOutput(source, entry->tokens, options, result.error))
+                    {
+                        result.ok = false;
+                    }
+                    Driver::printResult(source, result, options);
+                }
+                rebuildAll = false;
+                std::cout.flush();
+            }
+
+            bool hasDirty() const { return !dirty.empty(); }
+
+        private:
+            static constexpr uint32_t eventMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_DELETE_SELF;
+
+            void addDirectory(const std::string &path, const std::string &root)
+            {
+                int wd = inotify_add_watch(fd, path.c_str(), eventMask);
+                if (wd < 0)
+                {
+                    std::cerr << "bassilc: cannot watch " << path << "\n";
+                    return;
+                }
+                // A file input's parent (empty root) becomes part of the directory input.
+                WatchedDirectory &directory = directories[wd];
+                if (directory.root.empty())
+                {
+                    directory = {path, root};
+                }
+
+                std::error_code ec;
+                for (fs::directory_iterator it(path, fs::directory_options::skip_permission_denied, ec), end; !ec && it != end; it.increment(ec))
+                {
+                    if (it->is_directory(ec))
+                    {
+                        addDirectory(it->path().string(), root);
+                    }
+                    else if (it->path().extension() == ".basl")
+                    {
+                        dirty.insert(it->path().string());
+                    }
+                }
+            }
+
+            /**
+             * @brief Marks every source dirty after events were lost, to be rebuilt even if unchanged.
+             */
+            void rescan()
+            {
+                rebuildAll = true;
+                dirty.insert(known.begin(), known.end()); // Files that are gone are reported as removed
+                dirty.insert(singleFiles.begin(), singleFiles.end());
+                for (const std::string &root : roots)
+                {
+                    addDirectory(root, root); // Also picks up directories created while events were lost
+                }
+            }
+
+            /**
+             * @brief Stops watching a directory that was moved or deleted and marks its sources dirty.
+             * @param path The directory.
+             */
+            void forgetDirectory(const std::string &path)
+            {
+                std::string prefix = path + "/";
+                for (auto it = directories.begin(); it != directories.end();)
+                {
+                    if (it->second.path == path || it->second.path.compare(0, prefix.size(), prefix) == 0)
+                    {
+                        // A moved directory keeps its watch, under a path we no longer know.
+                        inotify_rm_watch(fd, it->first);
+                        it = directories.erase(it);
+                    }
+                    else
+                    {
+                        ++it;
+                    }
+                }
+                for (auto it = known.lower_bound(prefix); it != known.end() && it->compare(0, prefix.size(), prefix) == 0; ++it)
+                {
+                    dirty.insert(*it);
+                }
+            }
+
+            void handleEvent(const inotify_event &event)
+            {
+                if (event.mask & IN_Q_OVERFLOW)
+                {
+                    rescan();
+                    return;
+                }
+                auto it = directories.find(event.wd);
+                if (it == directories.end())
+                {
+                    return;
+                }
+                if (event.mask & (IN_IGNORED | IN_DELETE_SELF))
+                {
+                    directories.erase(it);
+                    return;
+                }
+                if (event.len == 0)
+                {
+                    return;
+                }
+
+                const WatchedDirectory &directory = it->second;
+                std::string path = directory.path + "/" + event.name;
+
+                if (event.mask & IN_ISDIR)
+                {
+                    if (!directory.root.empty() && (event.mask & (IN_CREATE | IN_MOVED_TO)))
+                    {
+                        addDirectory(path, directory.root);
+                    }
+                    else if (event.mask & (IN_MOVED_FROM | IN_DELETE))
+                    {
+                        forgetDirectory(path);
+                    }
+                    return;
+                }
+
+                bool isSource = directory.root.empty() ? singleFiles.count(path) != 0
+                                                       : fs::path(path).extension() == ".basl";
+                if (isSource)
+                {
+                    dirty.insert(path);
+                }
+            }
+
+            Driver::SourceFile sourceFor(const std::string &path) const
+            {
+                Driver::SourceFile source;
+                source.path = path;
+                if (singleFiles.count(path) != 0)
+                {
+                    source.relativePath = fs::path(path).filename().string();
+                    return source;
+                }
+                // The innermost directory input containing the file: /a/bc/x.basl is not under /a/b.
+                const std::string *best = nullptr;
+                for (const std::string &root : roots)
+                {
+                    bool contains = path.size() > root.size() && path.compare(0, root.size(), root) == 0 &&
+                                    (root.back() == '/' || path[root.size()] == '/');
+                    if (contains && (!best || root.size() > best->size()))
+                    {
+                        best = &root;
+                    }
+                }
+                source.relativePath = best ? fs::path(path).lexically_relative(*best).string() : fs::path(path).filename().string();
+                return source;
+            }
+
+            int fd;
+            const Driver::Options &options;
+            SourceCache cache;
+            std::unordered_map<int, WatchedDirectory> directories;
+            std::set<std::string> roots;       ///< Inputs given as directories
+            std::set<std::string> singleFiles; ///< Inputs given as files rather than directories
+            std::set<std::string> known;       ///< Sources that currently exist and were lexed
+            std::set<std::string> dirty;       ///< Sources touched since the last processDirty()
+            bool rebuildAll = false;           ///< Events were lost; rebuild the next batch even if unchanged
+        };
+    }
+
+    int run(const Driver::Options &options)
+    {
+        int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0)
+        {
+            std::cerr << "bassilc: inotify is not available\n";
+            return 1;
+        }
+
+        Watcher watcher(fd, options);
+        for (const auto &input : options.inputs)
+        {
+            watcher.addInput(input);
+        }
+        watcher.processDirty();
+
+        if (!options.quiet)
+        {
+            std::cout << "Watching for changes...\n";
+            std::cout.flush();
+        }
+
+        pollfd pfd = {fd, POLLIN, 0};
+        while (true)
+        {
+            // Block until something happens, then keep collecting until the burst is over.
+            if (::poll(&pfd, 1, -1) < 0 && errno != EINTR)
+            {
+                break;
+            }
+            if (!watcher.readEvents())
+            {
+                break;
+            }
+            while (::poll(&pfd, 1, static_cast<int>(options.debounceMs)) > 0)
+            {
+                if (!watcher.readEvents())
+                {
+                    break;
+                }
+            }
+            if (watcher.hasDirty())
+            {
+                watcher.processDirty();
+            }
+        }
+
+        ::close(fd);
+        std::cerr << "bassilc: watch stopped: " << std::strerror(errno) << "\n";
+        return 1;
+    }
+#else
+    int run(const Driver::Options &options)
+    {
+        (void)options;
+        std::cerr << "bassilc: --watch requires inotify and is only supported on Linux\n";
+        return 1;
+    }
+#endif
+}
@@ -0,0 +1,136 @@
+/**
+ * @file alloc_tracker.h
+ * @brief Opt-in heap allocation accounting per compilation phase.
+ *
+ * Building with -DBASSIL_ALLOC_TRACKING replaces the global operator new and
+ * operator delete. Every allocation is then attributed to the phase active on
+ * the allocating thread (see BASSIL_ALLOC_PHASE), and a table with the
+ * allocation count, bytes and peak live bytes of every phase is printed to
+ * stderr when the program exits.
+ *
+ * Without the define the phase macro compiles to nothing and no allocator is
+ * replaced, so regular builds pay nothing.
+ */
+
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+#include <cstdint>
+#include <ostream>
+
+namespace AllocTracker
+{
+    /**
+     * @brief The phases allocations are attributed to.
+     */
+    typedef enum
+    {
+        AP_Other,   ///< Anything outside a phase (startup, argument parsing, ...)
+        AP_Read,    ///< Reading source files
+        AP_Lex,     ///< lex()
+        AP_Parse,   ///< Parser::parse()
+        AP_Check,   ///< Name resolution, type checking and constant folding
+        AP_Run,     ///< Bytecode compilation and running programs (--run)
+        AP_Display, ///< display_tokens()
+        AP_Save,    ///< save_tokens() and token output files
+        AP_Report,  ///< Printing diagnostics and results
+        AP_Count
+    } Phase;
+
+    /**
+     * @brief Allocation totals of one phase.
+     */
+    struct PhaseStats
+    {
+        std::uint64_t allocations = 0; ///< Calls to operator new
+        std::uint64_t frees = 0;       ///< Calls to operator delete on this phase's blocks
+        std::uint64_t bytes = 0;       ///< Bytes requested
+        std::uint64_t peakLive = 0;    ///< Highest number of bytes allocated in the phase and not yet freed
+        std::uint64_t live = 0;        ///< Bytes allocated in the phase and not yet freed
+    };
+
+    /**
+     * @brief Returns whether the allocator hooks were compiled in.
+     * @return bool True when built with BASSIL_ALLOC_TRACKING.
+     */
+    constexpr bool isCompiledIn()
+    {
+#ifdef BASSIL_ALLOC_TRACKING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Returns the name of a phase as printed in the report.
+     * @param phase The phase.
+     * @return const char* E.g. "lex".
+     */
+    const char *phaseName(Phase phase);
+
+    /**
+     * @brief Returns the phase allocations of the calling thread are attributed to.
+     * @return Phase The current phase.
+     */
+    Phase currentPhase();
+
+    /**
+     * @brief Attributes the calling thread's allocations to another phase.
+     * @param phase The new phase.
+     */
+    void setCurrentPhase(Phase phase);
+
+    /**
+     * @brief Returns a snapshot of the totals of one phase.
+     * @param phase The phase.
+     * @return PhaseStats The totals.
+     */
+    PhaseStats stats(Phase phase);
+
+    /**
+     * @brief Returns the highest number of live bytes over the whole process.
+     * @return std::uint64_t Peak live bytes.
+     */
+    std::uint64_t peakLiveBytes();
+
+    /**
+     * @brief Prints the per-phase table.
+     * @param out The destination stream.
+     */
+    void report(std::ostream &out);
+
+    /**
+     * @brief Attributes allocations to a phase for the lifetime of a C++ scope.
+     */
+    class PhaseScope
+    {
+    public:
+        explicit PhaseScope(Phase phase) : previous(currentPhase())
+        {
+            setCurrentPhase(phase);
+        }
+
+        ~PhaseScope()
+        {
+            setCurrentPhase(previous);
+        }
+
+        PhaseScope(const PhaseScope &) = delete;
+        PhaseScope &operator=(const PhaseScope &) = delete;
+
+    private:
+        Phase previous;
+    };
+}
+
+#ifdef BASSIL_ALLOC_TRACKING
+#define BASSIL_ALLOC_CONCAT_INNER(a, b) a##b
+#define BASSIL_ALLOC_CONCAT(a, b) BASSIL_ALLOC_CONCAT_INNER(a, b)
+/// Attributes the rest of the enclosing block's allocations to @p phase (e.g. AllocTracker::AP_Lex).
+#define BASSIL_ALLOC_PHASE(phase) ::AllocTracker::PhaseScope BASSIL_ALLOC_CONCAT(bassilAllocPhase_, __LINE__)(phase)
+#else
+#define BASSIL_ALLOC_PHASE(phase) ((void)0)
+#endif
+
+#endif // ALLOC_TRACKER_H
@@ -0,0 +1,216 @@
+/**
+ * @file arena.h
+ * @brief Chunked bump allocator for data that lives as long as one file's compilation.
+ *
+ * Token text, diagnostic messages and syntax tree nodes of a file are all
+ * released together, so instead of one malloc/free each they are carved out
+ * of large chunks and dropped at once. Allocation is a pointer bump; reset()
+ * and resetTo() keep the chunks for the next file, so a warm arena does not
+ * touch malloc at all.
+ *
+ * The arena is also a std::pmr::memory_resource, so pmr containers can use it
+ * directly (deallocation is a no-op).
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory_resource>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class CompilationArena : public std::pmr::memory_resource
+{
+public:
+    /**
+     * @brief A position in the arena that resetTo() can rewind to.
+     */
+    struct Mark
+    {
+        size_t chunk = 0;            ///< Index of the current chunk
+        size_t offset = 0;           ///< Bytes used in that chunk
+        void *finalizers = nullptr;  ///< Newest registered destructor
+        size_t bytesUsed = 0;        ///< Total bytes handed out
+    };
+
+    /**
+     * @param firstChunkSize Size of the first chunk; later chunks double up to maxChunkSize.
+     *        Callers that know the input size should pass an estimate so one chunk suffices.
+     */
+    explicit CompilationArena(size_t firstChunkSize = 64 * 1024);
+    ~CompilationArena() override;
+
+    CompilationArena(const CompilationArena &) = delete;
+    CompilationArena &operator=(const CompilationArena &) = delete;
+
+    /**
+     * @brief Returns uninitialised memory.
+     * @param bytes Number of bytes.
+     * @param alignment Power of two alignment.
+     * @return void* The memory; valid until the arena is reset past it.
+     */
+    void *allocateAligned(size_t bytes, size_t alignment = alignof(std::max_align_t))
+    {
+        std::uintptr_t base = reinterpret_cast<std::uintptr_t>(cursor);
+        std::uintptr_t aligned = (base + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1);
+        if (cursor && aligned + bytes <= reinterpret_cast<std::uintptr_t>(limit))
+        {
+            cursor = reinterpret_cast<char *>(aligned + bytes);
+            used += bytes;
+            return reinterpret_cast<void *>(aligned);
+        }
+        return allocateSlow(bytes, alignment);
+    }
+
+    /**
+     * @brief Constructs an object in the arena.
+     *
+     * Objects with a non-trivial destructor are destroyed by reset(), resetTo()
+     * or the arena's destructor, newest first.
+     *
+     * @return T* The object.
+     */
+    template <typename T, typename... Args>
+    T *make(Args &&...args)
+    {
+        void *memory = allocateAligned(sizeof(T), alignof(T));
+        T *object = new (memory) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            registerFinalizer(object, [](void *p)
+                              { static_cast<T *>(p)->~T(); });
+        }
+        return object;
+    }
+
+    /**
+     * @brief Allocates an uninitialised array of trivially destructible elements.
+     * @param count Number of elements.
+     * @return T* The first element.
+     */
+    template <typename T>
+    T *makeArray(size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "arena arrays are never destroyed");
+        return static_cast<T *>(allocateAligned(sizeof(T) * count, alignof(T)));
+    }
+
+    /**
+     * @brief Copies a string into the arena.
+     * @param text The text.
+     * @return std::string_view The copy.
+     */
+    std::string_view copyString(std::string_view text)
+    {
+        if (text.empty())
+        {
+            return {};
+        }
+        char *copy = static_cast<char *>(allocateAligned(text.size(), 1));
+        std::memcpy(copy, text.data(), text.size());
+        return std::string_view(copy, text.size());
+    }
+
+    /**
+     * @brief Concatenates strings directly into the arena (no temporary std::string).
+     * @param parts The pieces, in order.
+     * @return std::string_view The result.
+     */
+    std::string_view concat(std::initializer_list<std::string_view> parts);
+
+    /**
+     * @brief Returns the current position for a later resetTo().
+     * @return Mark The position.
+     */
+    Mark mark() const
+    {
+        return {current, chunks.empty() ? 0 : static_cast<size_t>(cursor - chunks[current].data), finalizers, used};
+    }
+
+    /**
+     * @brief Frees everything allocated after a mark, keeping the chunks for reuse.
+     * @param mark A mark taken from this arena that has not been reset past.
+     */
+    void resetTo(const Mark &mark);
+
+    /**
+     * @brief Frees everything, keeping the chunks for reuse.
+     */
+    void reset()
+    {
+        resetTo(Mark());
+    }
+
+    /**
+     * @brief Frees everything and returns the chunks to the system.
+     */
+    void release();
+
+    /**
+     * @return size_t Bytes handed out since construction or the last reset.
+     */
+    size_t bytesUsed() const { return used; }
+
+    /**
+     * @return size_t Bytes held in chunks, used or not.
+     */
+    size_t bytesReserved() const;
+
+    /**
+     * @return size_t Number of chunks held.
+     */
+    size_t chunkCount() const { return chunks.size(); }
+
+    static constexpr size_t maxChunkSize = 1024 * 1024; ///< Growth stops at this size
+
+protected:
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+        return allocateAligned(bytes, alignment);
+    }
+
+    void do_deallocate(void *, size_t, size_t) override
+    {
+        // Memory is reclaimed by reset()/resetTo().
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+
+private:
+    struct Chunk
+    {
+        char *data;
+        size_t size;
+    };
+
+    struct Finalizer
+    {
+        void (*destroy)(void *);
+        void *object;
+        Finalizer *next;
+    };
+
+    void *allocateSlow(size_t bytes, size_t alignment);
+    void registerFinalizer(void *object, void (*destroy)(void *));
+    void runFinalizers(void *until);
+
+    std::vector<Chunk> chunks; ///< Chunks in use order; those after `current` are spare
+    size_t current = 0;
+    char *cursor = nullptr;
+    char *limit = nullptr;
+    size_t used = 0;
+    size_t nextChunkSize;
+    Finalizer *finalizers = nullptr;
+};
+
+#endif // ARENA_H
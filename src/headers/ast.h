@@ -0,0 +1,228 @@
+/**
+ * @file ast.h
+ * @brief Flat, index-based syntax tree of a Bassil source file.
+ *
+ * Instead of one heap object per node linked by pointers, the tree is a few
+ * parallel arrays indexed by NodeIndex: the node kind (one byte), its main
+ * token (an index into the file's tokens) and two 32-bit data words. Nodes
+ * with one or two fixed children keep the children's indices in the data
+ * words; nodes with a variable number of children keep a range of the extra
+ * array there instead. A node costs 13 bytes plus 4 per child stored in the
+ * extra array.
+ *
+ * Nodes are appended when they are finished, so children precede their
+ * parent, the root is the last node and the nodes of any subtree form one
+ * contiguous index range ending at its root. Passes that only need each node
+ * once can walk the arrays front to back; the whole tree is freed, copied or
+ * written out as four buffers. AstView reads the same arrays wherever they
+ * live, in an Ast or in a mapped parse cache entry (see parse_cache.h).
+ */
+
+#ifndef AST_H
+#define AST_H
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "lexer.h"
+
+/**
+ * @brief Enumeration for syntax tree node kinds
+ *
+ * The comment of each kind gives its main token and its children, in order.
+ */
+typedef enum : std::uint8_t
+{
+    NK_Program,    ///< First token; functions and statements in source order
+    NK_Function,   ///< Name; return type (NK_Type, or NK_Empty if omitted), parameters..., body (NK_Block)
+    NK_Parameter,  ///< Name; type
+    NK_Type,       ///< Type keyword; none
+    NK_Block,      ///< '{'; statements
+    NK_VarDecl,    ///< Name; type, initialiser (optional)
+    NK_If,         ///< 'if'; condition, then branch, else branch (optional)
+    NK_For,        ///< 'for'; initialiser, condition, step, body (omitted clauses are NK_Empty)
+    NK_Return,     ///< 'return'; value (optional)
+    NK_ExprStmt,   ///< First token; expression
+    NK_Empty,      ///< Where the omitted part would be; none
+    NK_Assign,     ///< '='; target (NK_Name), value
+    NK_Binary,     ///< Operator; left, right
+    NK_Unary,      ///< Operator; operand
+    NK_Call,       ///< '('; callee, arguments...
+    NK_Name,       ///< Identifier; none
+    NK_Literal,    ///< Integer, float, string, char, true or false token; none
+    NK_Error,      ///< Tokens dropped by error recovery; only in syntax_tree.h trees, never in an Ast
+    NK_KindCount   ///< Number of kinds (not a node)
+} NodeKind;
+
+/**
+ * @brief Name of a node kind as printed by dumpAst() ("VarDecl", "Binary", ...).
+ * @param kind The kind.
+ * @return const char* Static string; "Unknown" for out-of-range values.
+ */
+const char *nodeKindName(NodeKind kind);
+
+typedef std::uint32_t NodeIndex; ///< Position of a node in the Ast arrays
+
+/**
+ * @brief Where a node kind keeps its children
+ */
+typedef enum : std::uint8_t
+{
+    CL_None,  ///< No children; the data words are unused
+    CL_One,   ///< One child, in data word 0
+    CL_Two,   ///< Two children, in data words 0 and 1
+    CL_Extra  ///< Data word 0 is the first index into Ast::extra, word 1 the child count
+} ChildLayout;
+
+/**
+ * @brief Child layout of a node kind.
+ */
+constexpr ChildLayout childLayout(NodeKind kind)
+{
+    switch (kind)
+    {
+    case NK_Type:
+    case NK_Empty:
+    case NK_Name:
+    case NK_Literal:
+        return CL_None;
+    case NK_Parameter:
+    case NK_ExprStmt:
+    case NK_Unary:
+        return CL_One;
+    case NK_Assign:
+    case NK_Binary:
+        return CL_Two;
+    default:
+        return CL_Extra;
+    }
+}
+
+/**
+ * @brief The two data words of a node (see ChildLayout)
+ */
+typedef struct
+{
+    std::uint32_t word[2];
+} NodeData;
+
+/**
+ * @brief The children of one node, as a contiguous array of indices
+ */
+struct ChildRange
+{
+    const NodeIndex *first = nullptr;
+    std::uint32_t count = 0;
+
+    const NodeIndex *begin() const { return first; }
+    const NodeIndex *end() const { return first + count; }
+    std::uint32_t size() const { return count; }
+    NodeIndex operator[](std::uint32_t i) const { return first[i]; }
+};
+
+/**
+ * @brief Read-only view of the arrays of a tree, which it does not own
+ */
+struct AstView
+{
+    const NodeKind *kinds = nullptr;
+    const std::uint32_t *tokens = nullptr;
+    const NodeData *data = nullptr;
+    const NodeIndex *extra = nullptr;
+    std::uint32_t nodeCount = 0;
+
+    NodeIndex root() const { return nodeCount - 1; } ///< The NK_Program node (the last one)
+    size_t size() const { return nodeCount; }        ///< Number of nodes
+    bool empty() const { return nodeCount == 0; }
+
+    NodeKind kind(NodeIndex node) const { return kinds[node]; }
+    std::uint32_t token(NodeIndex node) const { return tokens[node]; }
+
+    /**
+     * @brief The children of a node, in the order given by its NodeKind.
+     */
+    ChildRange children(NodeIndex node) const
+    {
+        switch (childLayout(kinds[node]))
+        {
+        case CL_None:
+            return {};
+        case CL_One:
+            return {data[node].word, 1};
+        case CL_Two:
+            return {data[node].word, 2};
+        default:
+            return {extra + data[node].word[0], data[node].word[1]};
+        }
+    }
+};
+
+/**
+ * @brief A syntax tree stored as parallel arrays (see the file comment)
+ */
+struct Ast
+{
+    std::vector<NodeKind> kinds;       ///< Kind of each node
+    std::vector<std::uint32_t> tokens; ///< Main token of each node (index into the file's tokens)
+    std::vector<NodeData> data;        ///< Children or extra range of each node
+    std::vector<NodeIndex> extra;      ///< Child lists of CL_Extra nodes
+
+    NodeIndex root() const { return static_cast<NodeIndex>(kinds.size() - 1); } ///< The NK_Program node (the last one)
+    size_t size() const { return kinds.size(); }                               ///< Number of nodes
+    bool empty() const { return kinds.empty(); }
+
+    NodeKind kind(NodeIndex node) const { return kinds[node]; }
+    std::uint32_t token(NodeIndex node) const { return tokens[node]; }
+
+    /**
+     * @brief The children of a node, in the order given by its NodeKind.
+     */
+    ChildRange children(NodeIndex node) const { return view().children(node); }
+
+    /**
+     * @brief The tree as an AstView, valid until the tree changes.
+     */
+    AstView view() const
+    {
+        return {kinds.data(), tokens.data(), data.data(), extra.data(), static_cast<std::uint32_t>(kinds.size())};
+    }
+
+    /**
+     * @brief Appends a node; children must already be in the tree.
+     * @param kind The kind.
+     * @param token Its main token.
+     * @param children Its children, as many as the kind's layout takes.
+     * @param count Number of children.
+     * @return NodeIndex The new node.
+     */
+    NodeIndex add(NodeKind kind, std::uint32_t token, const NodeIndex *children, std::uint32_t count);
+
+    /**
+     * @brief Drops the nodes from index @p nodes and the extra entries from @p extraSize on.
+     */
+    void truncate(size_t nodes, size_t extraSize);
+
+    /**
+     * @brief Removes every node, keeping the capacity.
+     */
+    void clear() { truncate(0, 0); }
+
+    /**
+     * @return size_t Bytes used by the nodes and extra data (not counting spare capacity).
+     */
+    size_t bytes() const
+    {
+        return kinds.size() * (sizeof(NodeKind) + sizeof(std::uint32_t) + sizeof(NodeData)) + extra.size() * sizeof(NodeIndex);
+    }
+};
+
+/**
+ * @brief Prints the tree, one node per line, indented by depth (for --dump-ast).
+ * @param tree The tree.
+ * @param tokens The tokens it was parsed from.
+ * @param out The stream.
+ */
+void dumpAst(const AstView &tree, const std::vector<Token> &tokens, std::ostream &out);
+inline void dumpAst(const Ast &tree, const std::vector<Token> &tokens, std::ostream &out) { dumpAst(tree.view(), tokens, out); }
+
+#endif // AST_H
@@ -0,0 +1,303 @@
+/**
+ * @file bytecode.h
+ * @brief Stack-based bytecode for Bassil programs and the compiler that emits it.
+ *
+ * A Program is one BytecodeFunction per function of the file, plus function 0
+ * holding the top-level statements in source order. Each function has its own
+ * code, a constant pool for the values too large to be an operand (floats,
+ * wide ints, strings) and the frame size the resolver computed for it.
+ *
+ * Instructions are a one-byte Opcode followed by its operands inline, in host
+ * byte order (bytecode only lives in memory): a signed byte for small ints,
+ * 16 bits for constant, variable and function indices, 32 bits for jump
+ * targets, which are offsets into the function's code. Operands are popped
+ * from and results pushed onto an operand stack above the frame's variables.
+ *
+ * The compiler works on a checked tree, so it needs no run-time type tests:
+ * the node types pick the int or float form of each operator and tell where
+ * an int becomes a float, and every node with a constant value (see
+ * constant_folder.h) is emitted as that constant. Variables that are never
+ * assigned and start constant are not stored at all, except globals, which a
+ * function called before the declaration may read. for loops test their
+ * condition at the bottom, so an iteration takes one conditional jump.
+ *
+ * A peephole pass over the instructions just emitted merges the commonest
+ * sequences into one instruction, which saves dispatches: an int comparison
+ * and the conditional jump on it, also with a small int as the right operand,
+ * and a small int added or subtracted. Sequences with a jump landing inside
+ * are left alone. A local incremented by a small int, as in the step of a for
+ * loop, is one OP_IncLocal.
+ */
+
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "ast.h"
+#include "constant_folder.h"
+#include "error_report.h"
+#include "lexer.h"
+#include "resolver.h"
+#include "type_checker.h"
+
+/**
+ * @brief The instruction set: X(name, operand, stack effect)
+ *
+ * The stack effect is the change in operand stack depth, for OP_Call the
+ * effect before the arguments are popped and the result pushed.
+ */
+#define BASSIL_OPCODES(X)                                                                  \
+    X(OP_Const, OK_Constant, 1)     /* push constants[k] */                                \
+    X(OP_Int8, OK_Int8, 1)          /* push a small int */                                 \
+    X(OP_Pop, OK_None, -1)                                                                 \
+    X(OP_Dup, OK_None, 1)                                                                  \
+    X(OP_LoadLocal, OK_Slot, 1)                                                            \
+    X(OP_StoreLocal, OK_Slot, -1)   /* pops */                                             \
+    X(OP_LoadGlobal, OK_Slot, 1)                                                           \
+    X(OP_StoreGlobal, OK_Slot, -1)  /* pops */                                             \
+    X(OP_IncLocal, OK_SlotInt8, 0)  /* x = x + k on an int local, as a statement */        \
+    X(OP_AddInt, OK_None, -1)                                                              \
+    X(OP_SubInt, OK_None, -1)                                                              \
+    X(OP_MulInt, OK_None, -1)                                                              \
+    X(OP_AddInt8, OK_Int8, 0)       /* adds a small int: x + k and x - k */                \
+    X(OP_DivInt, OK_None, -1)       /* fails on division by zero */                        \
+    X(OP_ModInt, OK_None, -1)       /* fails on division by zero */                        \
+    X(OP_NegInt, OK_None, 0)                                                               \
+    X(OP_AddFloat, OK_None, -1)                                                            \
+    X(OP_SubFloat, OK_None, -1)                                                            \
+    X(OP_MulFloat, OK_None, -1)                                                            \
+    X(OP_DivFloat, OK_None, -1)                                                            \
+    X(OP_NegFloat, OK_None, 0)                                                             \
+    X(OP_IntToFloat, OK_None, 0)                                                           \
+    X(OP_EqInt, OK_None, -1)        /* also chars and bools */                             \
+    X(OP_NeInt, OK_None, -1)                                                               \
+    X(OP_LtInt, OK_None, -1)                                                               \
+    X(OP_LeInt, OK_None, -1)                                                               \
+    X(OP_GtInt, OK_None, -1)                                                               \
+    X(OP_GeInt, OK_None, -1)                                                               \
+    X(OP_EqFloat, OK_None, -1)                                                             \
+    X(OP_NeFloat, OK_None, -1)                                                             \
+    X(OP_LtFloat, OK_None, -1)                                                             \
+    X(OP_LeFloat, OK_None, -1)                                                             \
+    X(OP_GtFloat, OK_None, -1)                                                             \
+    X(OP_GeFloat, OK_None, -1)                                                             \
+    X(OP_EqString, OK_None, -1)                                                            \
+    X(OP_NeString, OK_None, -1)                                                            \
+    X(OP_Not, OK_None, 0)                                                                  \
+    X(OP_Jump, OK_Jump, 0)                                                                 \
+    X(OP_JumpIfFalse, OK_Jump, -1)  /* pops the condition */                               \
+    X(OP_JumpIfTrue, OK_Jump, -1)   /* pops the condition */                               \
+    X(OP_AndJump, OK_Jump, -1)      /* &&: jumps keeping a false left operand, else pops */ \
+    X(OP_OrJump, OK_Jump, -1)       /* ||: jumps keeping a true left operand, else pops */  \
+    X(OP_JumpIfEqInt, OK_Jump, -2)  /* pops two ints, jumps if the comparison holds */     \
+    X(OP_JumpIfNeInt, OK_Jump, -2)                                                         \
+    X(OP_JumpIfLtInt, OK_Jump, -2)                                                         \
+    X(OP_JumpIfLeInt, OK_Jump, -2)                                                         \
+    X(OP_JumpIfGtInt, OK_Jump, -2)                                                         \
+    X(OP_JumpIfGeInt, OK_Jump, -2)                                                         \
+    X(OP_JumpIfEqInt8, OK_Int8Jump, -1) /* pops an int, jumps if it compares so with k */  \
+    X(OP_JumpIfNeInt8, OK_Int8Jump, -1)                                                    \
+    X(OP_JumpIfLtInt8, OK_Int8Jump, -1)                                                    \
+    X(OP_JumpIfLeInt8, OK_Int8Jump, -1)                                                    \
+    X(OP_JumpIfGtInt8, OK_Int8Jump, -1)                                                    \
+    X(OP_JumpIfGeInt8, OK_Int8Jump, -1)                                                    \
+    X(OP_Call, OK_Function, 0)      /* pops the arguments, pushes the result if any */     \
+    X(OP_Return, OK_None, -1)       /* pops the result */                                  \
+    X(OP_ReturnVoid, OK_None, 0)                                                           \
+    X(OP_NoReturn, OK_None, 0)      /* fails: the end of a function with a result */       \
+    X(OP_Halt, OK_None, 0)          /* ends the program */                                 \
+    X(OP_PrintInt, OK_None, -1)                                                            \
+    X(OP_PrintFloat, OK_None, -1)                                                          \
+    X(OP_PrintChar, OK_None, -1)                                                           \
+    X(OP_PrintBool, OK_None, -1)                                                           \
+    X(OP_PrintString, OK_None, -1)
+
+/**
+ * @brief One-byte operation codes (see BASSIL_OPCODES)
+ */
+typedef enum : std::uint8_t
+{
+#define BASSIL_OPCODE_ENUM(name, operand, effect) name,
+    BASSIL_OPCODES(BASSIL_OPCODE_ENUM)
+#undef BASSIL_OPCODE_ENUM
+    OP_Count ///< Number of opcodes (not an opcode)
+} Opcode;
+
+/**
+ * @brief What follows an opcode in the code
+ */
+typedef enum : std::uint8_t
+{
+    OK_None,     ///< Nothing
+    OK_Int8,     ///< A signed byte
+    OK_Constant, ///< 16-bit index into the function's constants
+    OK_Slot,     ///< 16-bit frame slot or global index
+    OK_Function, ///< 16-bit index into Program::functions
+    OK_Jump,     ///< 32-bit offset into the function's code
+    OK_SlotInt8, ///< A frame slot, then a signed byte
+    OK_Int8Jump  ///< A signed byte, then a jump offset
+} OperandKind;
+
+/**
+ * @brief Name of an opcode, as in the disassembly ("OP_AddInt").
+ * @return const char* Static string; "unknown" for out-of-range values.
+ */
+const char *opcodeName(Opcode op);
+
+/**
+ * @brief Operand of an opcode.
+ */
+OperandKind operandKind(Opcode op);
+
+/**
+ * @brief A run-time value. Untagged: the code knows the type of every slot.
+ */
+typedef union
+{
+    std::int64_t integer;      ///< int, the code of a char, 0 or 1 for a bool
+    double floating;           ///< float
+    const std::string *string; ///< string, owned by the Program
+} Value;
+
+/**
+ * @brief Source position of an instruction that can fail at run time
+ */
+typedef struct
+{
+    std::uint32_t offset; ///< Offset of its opcode in the code
+    int line;
+    int start_column;
+    int end_column;
+} SourcePosition;
+
+/**
+ * @brief The code of one function, or of the top-level statements
+ */
+struct BytecodeFunction
+{
+    std::string_view name;                 ///< Function name; "<top level>" for function 0
+    std::vector<std::uint8_t> code;
+    std::vector<Value> constants;          ///< Constant pool, indexed by OP_Const
+    std::vector<TypeId> constantTypes;     ///< TypeInt, TypeFloat or TypeString per constant, for the disassembly
+    std::vector<SourcePosition> positions; ///< Of the failing instructions, by offset
+    std::uint32_t parameterCount = 0;      ///< Arguments, which become frame slots 0 to parameterCount - 1
+    std::uint32_t frameSize = 0;           ///< Frame slots, parameters included
+    std::uint32_t maxStack = 0;            ///< Deepest the operand stack gets above the frame
+};
+
+/**
+ * @brief A compiled file
+ */
+struct Program
+{
+    std::vector<BytecodeFunction> functions; ///< Function 0 runs the top-level statements
+    std::uint32_t globalCount = 0;
+    std::deque<std::string> strings;         ///< Decoded string literals; a deque keeps them in place as it grows
+};
+
+/**
+ * @brief Appends a value as print writes it: ints in decimal, floats in the
+ *        fewest digits that read back the same, chars as UTF-8, bools as true/false.
+ * @param out Receives the text.
+ * @param value The value.
+ * @param type Its type.
+ */
+void appendValue(std::string &out, Value value, TypeId type);
+
+/**
+ * @brief Appends the text a string literal stands for.
+ *
+ * Decodes the same escapes as character literals (\n \t \r \0 \\ \' \");
+ * a backslash before any other character is kept.
+ *
+ * @param token The literal as written, quotes included.
+ * @param out Receives the text.
+ */
+void decodeStringLiteral(std::string_view token, std::string &out);
+
+/**
+ * @brief Writes a readable listing of a program: each function's constants and instructions.
+ * @param program The program.
+ * @param out Receives one instruction per line.
+ */
+void disassemble(const Program &program, std::ostream &out);
+
+/**
+ * @brief Reusable bytecode compiler that keeps its buffers between files.
+ *
+ * Only trees without errors may be compiled; an unresolved name is reported
+ * and nothing is compiled. Results are valid until the next compile(). Not
+ * thread-safe; use one instance per thread.
+ */
+class BytecodeCompiler
+{
+public:
+    BytecodeCompiler() = default;
+
+    BytecodeCompiler(const BytecodeCompiler &) = delete;
+    BytecodeCompiler &operator=(const BytecodeCompiler &) = delete;
+
+    /**
+     * @brief Compiles one checked tree.
+     * @param tree The tree, as built by Parser.
+     * @param tokens The tokens it was parsed from.
+     * @param resolution Its names, as bound by Resolver.
+     * @param types Its node types, as computed by TypeChecker.
+     * @param values Its constants, as computed by ConstantFolder.
+     * @return const Program& The program (same as program()); empty if diagnostics() is not.
+     */
+    const Program &compile(const AstView &tree, const std::vector<Token> &tokens, const Resolution &resolution,
+                           const std::vector<TypeId> &types, const std::vector<ConstantValue> &values);
+
+    const Program &program() const { return result; }                              ///< Result of the last compile()
+    const std::vector<Diagnostic> &diagnostics() const { return diagnosticBuffer; } ///< Limits of the format exceeded by the last compile()
+
+private:
+    void function(NodeIndex node, std::uint32_t index);
+    void statement(NodeIndex node);
+    void discarded(NodeIndex node);
+    void expression(NodeIndex node);
+    void expressionAs(NodeIndex node, TypeId to);
+    void binary(NodeIndex node);
+    void binaryOperator(NodeIndex node, bool leftConverted);
+    void call(NodeIndex node);
+    void constant(NodeIndex node, ConstantValue value, TypeId type);
+    void variable(Opcode globalOp, Opcode localOp, NodeIndex name);
+    void emit(Opcode op);
+    void emitOperand(std::uint32_t value, std::uint32_t token, const char *tooLarge);
+    std::uint32_t emitJump(Opcode op);
+    bool emitAddInt8(Opcode op);
+    bool emitIncLocal(NodeIndex assign);
+    bool fusible(std::uint32_t size) const;
+    void patch(std::uint32_t jump, std::uint32_t target);
+    std::uint32_t here() const { return static_cast<std::uint32_t>(current->code.size()); }
+    void position(std::uint32_t token);
+    void report(std::uint32_t token, std::string_view message);
+
+    AstView tree;
+    const std::vector<Token> *tokens = nullptr;
+    const Resolution *resolution = nullptr;
+    const std::vector<TypeId> *types = nullptr;
+    const std::vector<ConstantValue> *values = nullptr;
+    Program result;
+    BytecodeFunction *current = nullptr;
+    TypeId returnType = TypeVoid;               ///< Result type of the function being compiled
+    std::int32_t depth = 0;                     ///< Operand stack depth at the end of the code so far
+    Opcode lastOp = OP_Count;                   ///< The last instruction emitted
+    std::uint32_t lastOffset = 0;               ///< Its offset
+    Opcode previousOp = OP_Count;               ///< The one before
+    std::uint32_t previousOffset = 0;
+    std::uint32_t labelled = 0;                 ///< Latest offset a forward jump lands on
+    std::unordered_map<std::uint64_t, std::uint16_t> integerConstants; ///< Constant pool index by value, per function
+    std::unordered_map<std::uint64_t, std::uint16_t> floatConstants;   ///< By bit pattern, so 0.0 and -0.0 differ
+    std::vector<NodeIndex> chain; ///< Operators down the left of the binary chains being compiled, outermost first
+    std::vector<Diagnostic> diagnosticBuffer;
+};
+
+#endif // BYTECODE_H
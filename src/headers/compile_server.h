@@ -0,0 +1,72 @@
+/**
+ * @file compile_server.h
+ * @brief The bassild compile server and its thin client.
+ *
+ * bassild keeps sources, line indexes and tokens in a SourceCache and answers
+ * requests over a Unix domain socket, so editors and build tools get lexer
+ * results for unchanged files without re-reading or re-lexing them.
+ *
+ * The protocol is line based. Each request is a single line:
+ *
+ *     CHECK <path>        diagnostics of a file
+ *     LEX <path>          tokens of a file
+ *     LINE <path> <n>     text of line <n> of a file
+ *     INVALIDATE <path>   drop a file from the cache
+ *     STATS               cache counters
+ *     SHUTDOWN            stop the server
+ *
+ * Each response starts with "OK <n>" followed by exactly n payload lines, or
+ * with a single "ERR <message>" line. Paths should be absolute.
+ */
+
+#ifndef COMPILE_SERVER_H
+#define COMPILE_SERVER_H
+
+#include <string>
+#include <vector>
+#include "source_cache.h"
+
+namespace CompileServer
+{
+    /**
+     * @brief Returns the socket path used when none is given.
+     *
+     * @return std::string $XDG_RUNTIME_DIR/bassild.sock, or /tmp/bassild-<uid>.sock.
+     */
+    std::string defaultSocketPath();
+
+    /**
+     * @brief Answers a single protocol request.
+     *
+     * @param cache The cache to serve from.
+     * @param request The request line, without the trailing newline.
+     * @param shutdown Set to true if the request asks the server to stop.
+     * @return std::string The full response, including the final newline.
+     */
+    std::string handleRequest(SourceCache &cache, const std::string &request, bool &shutdown);
+
+    /**
+     * @brief Listens on a Unix domain socket and serves requests until SHUTDOWN.
+     *
+     * Returns once every connection has ended; connections still open at
+     * SHUTDOWN are closed.
+     *
+     * @param socketPath Path of the socket; a stale socket file is replaced, but
+     *        not one a server answers on, nor anything that is not a socket.
+     * @return int 0 after a clean shutdown, 1 if the socket could not be set up.
+     */
+    int serve(const std::string &socketPath);
+
+    /**
+     * @brief Sends one request to a running server and waits for the response.
+     *
+     * @param socketPath Path of the server socket.
+     * @param request The request line, without the trailing newline.
+     * @param payload Receives the payload lines of an OK response.
+     * @param error Receives the message of an ERR response or a connection error.
+     * @return bool True if the server answered OK.
+     */
+    bool request(const std::string &socketPath, const std::string &request, std::vector<std::string> &payload, std::string &error);
+}
+
+#endif // COMPILE_SERVER_H
@@ -0,0 +1,105 @@
+/**
+ * @file constant_folder.h
+ * @brief Constant folding and propagation over a type-checked syntax tree.
+ *
+ * The folder evaluates at compile time every expression whose value does not
+ * depend on the run: literals, operators applied to constants, and variables
+ * that are never assigned after an initialiser that is itself constant, such
+ * as a global `int limit = 10 * 4;`. The tree is not rewritten (it may live
+ * in a mapped parse cache entry); the values go into an array parallel to it,
+ * like the types, and code generation emits a constant wherever a node has
+ * one instead of the code computing it.
+ *
+ * Like the type checker, it makes one pass over the nodes front to back,
+ * after a pre-pass over the assignments that finds the variables that change.
+ * A variable is never used before its declaration (see resolver.h), so its
+ * value is known by the time a use is reached. A function, though, may be
+ * called before a global it reads is declared, and then sees it zero; inside
+ * functions only globals declared before the first top-level statement or
+ * call are propagated.
+ *
+ * Values follow the run-time semantics: ints are 64-bit and wrap around on
+ * overflow, / truncates toward zero and % takes the sign of the dividend, with
+ * the minimum int divided by -1 giving itself (remainder 0). Integer division
+ * or remainder by a constant zero is an error, reported as a Diagnostic.
+ * Floats are IEEE doubles, so dividing one by zero gives an infinity or NaN.
+ * && and || fold as soon as their left operand decides them. Strings are not
+ * folded.
+ */
+
+#ifndef CONSTANT_FOLDER_H
+#define CONSTANT_FOLDER_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "ast.h"
+#include "error_report.h"
+#include "lexer.h"
+#include "resolver.h"
+#include "type_checker.h"
+
+/**
+ * @brief Compile-time value of a node, read as the node's type says
+ */
+typedef struct
+{
+    bool known; ///< False if the value is only known at run time
+    union
+    {
+        std::int64_t integer; ///< Value of an int, the code of a char, 0 or 1 for a bool
+        double floating;      ///< Value of a float
+    };
+} ConstantValue;
+
+/**
+ * @brief Reusable constant folder that keeps its buffers between files.
+ *
+ * Results are valid until the next fold(). Not thread-safe; use one instance
+ * per thread.
+ */
+class ConstantFolder
+{
+public:
+    ConstantFolder() = default;
+
+    ConstantFolder(const ConstantFolder &) = delete;
+    ConstantFolder &operator=(const ConstantFolder &) = delete;
+
+    /**
+     * @brief Folds the constant expressions of one tree.
+     * @param tree The tree, as built by Parser.
+     * @param tokens The tokens it was parsed from.
+     * @param literals The decoded literals of those tokens (see Token::literal).
+     * @param resolution Its names, as bound by Resolver.
+     * @param types Its node types, as computed by TypeChecker.
+     * @return const std::vector<ConstantValue>& The value of each node (same as values()).
+     */
+    const std::vector<ConstantValue> &fold(const AstView &tree, const std::vector<Token> &tokens, const std::vector<NumericLiteral> &literals,
+                                           const Resolution &resolution, const std::vector<TypeId> &types);
+
+    const std::vector<ConstantValue> &values() const { return nodeValues; }        ///< Value of each node of the last fold()
+    const std::vector<Diagnostic> &diagnostics() const { return diagnosticBuffer; } ///< Errors of the last fold(), in source order
+    std::uint32_t foldedCount() const { return folded; }                            ///< Operators and names of the last fold() with a known value
+
+private:
+    ConstantValue valueOf(NodeIndex node);
+    ConstantValue binary(NodeIndex node);
+    ConstantValue unary(NodeIndex node);
+    ConstantValue convert(NodeIndex node, TypeId to) const;
+    void report(std::uint32_t token, std::string_view message);
+
+    AstView tree;
+    const std::vector<Token> *tokens = nullptr;
+    const std::vector<NumericLiteral> *literals = nullptr;
+    const Resolution *resolution = nullptr;
+    const std::vector<TypeId> *types = nullptr;
+    std::vector<ConstantValue> nodeValues;
+    std::vector<bool> assigned;       ///< Per symbol: the target of some assignment
+    std::vector<bool> setBeforeCalls; ///< Per symbol: a global declared before any function can run
+    bool inFunction = false;          ///< The node being folded is inside a function
+    std::uint32_t folded = 0;
+    std::vector<Diagnostic> diagnosticBuffer;
+};
+
+#endif // CONSTANT_FOLDER_H
@@ -0,0 +1,80 @@
+/**
+ * @file corpus.h
+ * @brief Deterministic generator of synthetic Bassil sources for benchmarking.
+ *
+ * The same options (size, mix and seed) always produce byte-identical output,
+ * so benchmark results can be compared across commits and machines.
+ */
+
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace Corpus
+{
+    /**
+     * @brief Which kind of tokens dominates the generated source.
+     */
+    enum class Mix
+    {
+        Balanced,    ///< Declarations, control flow, functions, comments and strings
+        Identifiers, ///< Long and repeated identifiers
+        Strings,     ///< String literals with escapes
+        Comments,    ///< Line and block comments
+        Operators    ///< Dense arithmetic, comparison and logical expressions
+    };
+
+    /**
+     * @brief Generator settings.
+     */
+    struct Options
+    {
+        std::uint64_t bytes = 1 << 20; ///< Approximate output size; generation stops at a statement boundary
+        Mix mix = Mix::Balanced;       ///< Token mix
+        std::uint64_t seed = 1;        ///< PRNG seed
+    };
+
+    /**
+     * @brief Parses a mix name (balanced, identifiers, strings, comments, operators).
+     *
+     * @param name The name.
+     * @param mix Receives the mix.
+     * @return bool False if the name is unknown.
+     */
+    bool parseMix(const std::string &name, Mix &mix);
+
+    /**
+     * @brief Returns the name of a mix as accepted by parseMix().
+     * @param mix The mix.
+     * @return const char* The name.
+     */
+    const char *mixName(Mix mix);
+
+    /**
+     * @brief Parses a size such as "512", "64KB", "10MB" or "2GB" (powers of 1024).
+     *
+     * @param text The size.
+     * @param bytes Receives the size in bytes.
+     * @return bool False if the text is not a valid size.
+     */
+    bool parseSize(const std::string &text, std::uint64_t &bytes);
+
+    /**
+     * @brief Generates a corpus into a string.
+     * @param options Generator settings.
+     * @return std::string The source text.
+     */
+    std::string generate(const Options &options);
+
+    /**
+     * @brief Streams a corpus to an output stream in 64 KB chunks (for multi-GB corpora).
+     * @param options Generator settings.
+     * @param out The destination.
+     */
+    void generate(const Options &options, std::ostream &out);
+}
+
+#endif // CORPUS_H
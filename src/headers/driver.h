@@ -0,0 +1,182 @@
+/**
+ * @file driver.h
+ * @brief Headless compilation driver used by the bassilc command line tool.
+ *
+ * The driver runs the same read/lex/parse/dump pipeline as the GUI build, but
+ * without any Win32 or GLFW initialisation, so it can be invoked from build
+ * scripts thousands of times without paying for window or notification setup.
+ */
+
+#ifndef DRIVER_H
+#define DRIVER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ast.h"
+#include "error_report.h"
+#include "lexer.h"
+
+class ThreadPool;
+
+namespace ParseCache
+{
+    class Entry;
+}
+
+namespace Driver
+{
+    /**
+     * @brief Options controlling a single driver invocation.
+     */
+    struct Options
+    {
+        std::vector<std::string> inputs; ///< Files and/or directories given on the command line
+        std::string tokensOutputDir;     ///< Directory for per-file token JSON (empty = don't write)
+        std::string logFile;             ///< Log file path (empty = logging disabled)
+        bool displayTokens = false;      ///< Log every token through display_tokens()
+        bool dumpAst = false;            ///< Print the syntax tree of every file to stdout
+        bool quiet = false;              ///< Suppress the per-file summary lines
+        unsigned jobs = 0;               ///< Worker threads (0 = one per core)
+        std::string serverSocket;        ///< Forward CHECK requests to a bassild at this socket
+        bool watch = false;              ///< Keep running and re-lex files as they change
+        unsigned debounceMs = 5;         ///< Quiet period that ends a burst of watch events
+        std::string traceFile;           ///< Write a Chrome trace of all phases here (empty = off)
+        bool perfCounters = false;       ///< Print per-phase hardware counters to stderr at exit
+        ColumnMode columnMode = CM_Codepoints; ///< Unit of reported columns
+        std::string cacheDir;            ///< Parse cache directory (empty = always lex and parse; see parse_cache.h)
+        bool run = false;                ///< Compile each file without errors to bytecode and run it
+        bool treeWalk = false;           ///< Run files with the reference tree-walker instead (see interpreter.h)
+        bool dumpBytecode = false;       ///< Print the bytecode of each file without errors to stdout
+    };
+
+    /**
+     * @brief A source file discovered from the command line inputs.
+     */
+    struct SourceFile
+    {
+        std::string path;         ///< Path used to read the file
+        std::string relativePath; ///< Path relative to the directory input it was found in
+        std::uintmax_t size = 0;  ///< File size in bytes, used to schedule large files first
+    };
+
+    /**
+     * @brief Outcome of compiling one source file.
+     *
+     * Workers fill these in any order; the driver prints them in source order
+     * once every job has finished so the output is deterministic.
+     */
+    struct FileResult
+    {
+        bool ok = false;                      ///< False if the file could not be processed
+        size_t tokenCount = 0;                ///< Number of tokens produced
+        std::vector<Diagnostic> diagnostics;  ///< Lexical, syntax and semantic errors, in source order
+        std::string ast;                      ///< Printed syntax tree (with --dump-ast)
+        std::string bytecode;                 ///< Disassembled bytecode (with --dump-bytecode)
+        std::string output;                   ///< What the program printed (with --run or --run-tree)
+        std::shared_ptr<CompilationArena> arena; ///< Owns the diagnostic messages of a lexed file
+        std::shared_ptr<const ParseCache::Entry> cacheEntry; ///< Owns them if the file was served by the parse cache
+        std::string error;                    ///< Fatal error (unreadable file, ...) if !ok
+    };
+
+    /**
+     * @brief Parses command line arguments into driver options.
+     *
+     * @param argc Argument count as passed to main.
+     * @param argv Argument vector as passed to main.
+     * @param options Receives the parsed options.
+     * @return int 0 to continue, -1 if usage was printed and the program should exit
+     *         successfully, or 2 on a usage error.
+     */
+    int parseArguments(int argc, char **argv, Options &options);
+
+    /**
+     * @brief Prints the command line usage to stdout.
+     */
+    void printUsage();
+
+    /**
+     * @brief Expands the inputs into the list of .basl files to compile.
+     *
+     * Directories are searched recursively for files with the .basl extension.
+     * The result is sorted by path so runs are reproducible.
+     *
+     * @param inputs Files and/or directories.
+     * @return std::vector<SourceFile> The discovered source files.
+     * @throw std::runtime_error if an input does not exist.
+     */
+    std::vector<SourceFile> collectSources(const std::vector<std::string> &inputs);
+
+    /**
+     * @brief Reads, lexes, parses, checks and optionally dumps or runs a single source file.
+     *
+     * With Options::cacheDir set, a file whose content is in the parse cache
+     * is not lexed or parsed at all, and a file that is gets stored there.
+     * With Options::run, a file without errors is compiled to bytecode and run;
+     * a run-time error is added to its diagnostics.
+     * Safe to call concurrently for different files, including from tasks of @p pool.
+     *
+     * @param source The file to process.
+     * @param options The driver options.
+     * @param pool If given, large files are parsed on it (see Parser::parseParallel()).
+     * @return FileResult The tokens count and diagnostics of the file.
+     */
+    FileResult compileFile(const SourceFile &source, const Options &options, ThreadPool *pool = nullptr);
+
+    /**
+     * @brief Resolves, type-checks and folds a parsed file.
+     *
+     * The one semantic pipeline of bassilc, watch mode and bassild, so they all
+     * report the same errors. The passes are per thread and keep their results
+     * until the thread's next call.
+     *
+     * @param tree The file's syntax tree.
+     * @param tokens Its tokens.
+     * @param literals Their decoded literals.
+     * @param bytes Size of the source, for the perf regions.
+     * @param arena Holds the diagnostic messages.
+     * @param diagnostics Receives the errors, merged in source order.
+     */
+    void checkTree(const AstView &tree, const std::vector<Token> &tokens, const std::vector<NumericLiteral> &literals,
+                   size_t bytes, CompilationArena &arena, std::vector<Diagnostic> &diagnostics);
+
+    /**
+     * @brief Returns where the token JSON of a source is written.
+     *
+     * @param source The source file.
+     * @param options The driver options.
+     * @return std::string The output path, or an empty string if token output is off.
+     */
+    std::string tokenOutputPath(const SourceFile &source, const Options &options);
+
+    /**
+     * @brief Writes the token JSON of a source if token output is enabled.
+     *
+     * @param source The source file.
+     * @param tokens Its tokens.
+     * @param options The driver options.
+     * @param error Receives a message if the file could not be written.
+     * @return bool False if writing failed.
+     */
+    bool writeTokenOutput(const SourceFile &source, const std::vector<Token> &tokens, const Options &options, std::string &error);
+
+    /**
+     * @brief Prints the outcome of one file in compiler style (path:line:col: error: msg).
+     *
+     * @param source The compiled file.
+     * @param result Its result.
+     * @param options The driver options.
+     */
+    void printResult(const SourceFile &source, const FileResult &result, const Options &options);
+
+    /**
+     * @brief Runs the pipeline over every input on a work-stealing thread pool.
+     *
+     * @param options The driver options.
+     * @return int 0 if every file was processed, 1 otherwise.
+     */
+    int run(const Options &options);
+}
+
+#endif // DRIVER_H
@@ -2,7 +2,30 @@
 #define ERROR_REPORT_H
 
 #include <string>
-#include "C:/coding-projects/CPP-Dev/bassil/src/headers/utils.h"
+#include <string_view>
+#include <vector>
+#include "utils.h"
+
+/**
+ * @brief A single error found while processing a source file.
+ *
+ * Diagnostics are collected instead of printed so that drivers processing
+ * many files concurrently can report them in a deterministic order.
+ */
+typedef struct
+{
+    int line;            ///< Line number of the error (1-based)
+    int start_column;    ///< First column of the offending text
+    int end_column;      ///< Last column of the offending text
+    std::string_view message; ///< Human readable description (a literal or arena storage)
+} Diagnostic;
+
+/**
+ * @brief Adds diagnostics of a later phase, keeping the list in source order.
+ * @param diagnostics Sorted by line and start column; receives the new entries.
+ * @param more Also sorted; on equal positions the existing entries come first.
+ */
+void mergeDiagnostics(std::vector<Diagnostic> &diagnostics, const std::vector<Diagnostic> &more);
 
 void reportAnsiError(const std::string &filePath, int lineNumber, int startColumn, int endColumn, const std::string &line, const std::string &msg);
 void reportNonAnsiError(const std::string &filePath, int lineNumber, int startColumn, int endColumn, const std::string &line, const std::string &msg);
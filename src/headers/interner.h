@@ -0,0 +1,132 @@
+/**
+ * @file interner.h
+ * @brief Thread-safe string interning with stable 32-bit symbol IDs.
+ *
+ * Every distinct identifier or keyword is stored once and named by a SymbolId,
+ * so later stages compare names with an integer compare and repeated names
+ * share one copy of their bytes. IDs and the returned string_views stay valid
+ * for the lifetime of the interner (the global one lives until exit).
+ *
+ * The table is split into shards selected by the top bits of the hash, each
+ * an open-addressing table behind its own mutex, so worker threads lexing
+ * different files rarely contend. Reading a name by ID takes no lock.
+ */
+
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+#include "arena.h"
+
+typedef std::uint32_t SymbolId; ///< Interned name; compare with == instead of comparing strings
+
+constexpr SymbolId NoSymbol = 0; ///< "Not a name" (never returned by intern())
+
+class Interner
+{
+public:
+    Interner();
+    ~Interner();
+
+    Interner(const Interner &) = delete;
+    Interner &operator=(const Interner &) = delete;
+
+    /**
+     * @brief The process-wide interner used by the lexer.
+     * @return Interner& The instance.
+     */
+    static Interner &global();
+
+    /**
+     * @brief Hash used for all lookups (64-bit FNV-1a).
+     *
+     * Callers scanning a name byte by byte can compute it on the fly with
+     * hashStep() and pass it to intern() to avoid hashing twice.
+     */
+    static constexpr std::uint64_t hashSeed = 0xcbf29ce484222325ull;
+
+    static constexpr std::uint64_t hashStep(std::uint64_t hash, unsigned char c)
+    {
+        return (hash ^ c) * 0x100000001b3ull;
+    }
+
+    static std::uint64_t hash(std::string_view text)
+    {
+        std::uint64_t h = hashSeed;
+        for (char c : text)
+        {
+            h = hashStep(h, static_cast<unsigned char>(c));
+        }
+        return h;
+    }
+
+    /**
+     * @brief Returns the ID of a name, adding it if it is new.
+     * @param text The name.
+     * @param precomputedHash hash(text).
+     * @return SymbolId The ID.
+     */
+    SymbolId intern(std::string_view text, std::uint64_t precomputedHash);
+
+    SymbolId intern(std::string_view text)
+    {
+        return intern(text, hash(text));
+    }
+
+    /**
+     * @brief Returns the ID of a name without adding it.
+     * @param text The name.
+     * @return SymbolId The ID, or NoSymbol if the name was never interned.
+     */
+    SymbolId lookup(std::string_view text);
+
+    /**
+     * @brief Returns the text of a symbol.
+     * @param id An ID returned by this interner.
+     * @return std::string_view The text, stored by the interner.
+     */
+    std::string_view name(SymbolId id) const
+    {
+        SymbolId local = (id >> ShardBits) - 1;
+        return shards[id & ShardMask].blocks[local >> BlockBits].load(std::memory_order_acquire)[local & BlockMask].text;
+    }
+
+    /**
+     * @return size_t Number of distinct names.
+     */
+    size_t size() const;
+
+private:
+    static constexpr unsigned ShardBits = 4;
+    static constexpr SymbolId ShardMask = (1u << ShardBits) - 1;
+    static constexpr unsigned BlockBits = 12;
+    static constexpr SymbolId BlockMask = (1u << BlockBits) - 1;
+    static constexpr size_t MaxBlocks = 4096; ///< 16M names per shard
+
+    struct Entry
+    {
+        std::string_view text;
+        std::uint64_t hash;
+    };
+
+    struct Shard
+    {
+        mutable std::mutex mutex;
+        std::vector<std::uint64_t> slots; ///< (hash >> 32) << 32 | (local index + 1); 0 = empty
+        SymbolId count = 0;
+        CompilationArena storage{16 * 1024}; ///< Name bytes and entry blocks
+        std::unique_ptr<std::atomic<Entry *>[]> blocks;
+    };
+
+    SymbolId find(Shard &shard, size_t shardIndex, std::string_view text, std::uint64_t hash, bool insert);
+    void grow(Shard &shard);
+
+    Shard shards[1u << ShardBits];
+};
+
+#endif // INTERNER_H
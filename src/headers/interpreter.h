@@ -0,0 +1,142 @@
+/**
+ * @file interpreter.h
+ * @brief Running Bassil programs: the bytecode interpreter and a reference tree-walker.
+ *
+ * Interpreter executes a Program (see bytecode.h) with its state in local
+ * variables of one function: the instruction pointer, the current frame's
+ * base and the top of the value stack. Where the compiler supports it (GCC,
+ * Clang), each instruction ends by jumping straight to the code of the next
+ * one through a table of label addresses (computed goto), so every opcode has
+ * its own indirect branch for the predictor to learn; elsewhere the loop is a
+ * switch.
+ *
+ * TreeWalker runs the checked tree directly, recursing over the nodes and
+ * picking int or float operations from the node types at every visit. It
+ * defines the semantics the bytecode must reproduce, the same output and the
+ * same run-time errors, and is the baseline the bench "interpret" phase is
+ * measured against.
+ *
+ * Both stop at the first run-time error: integer division or remainder by
+ * zero, a call nested more than MaxCallDepth deep ("Stack overflow"), or the
+ * end of a function with a result reached without a return. print output
+ * goes into a buffer that is written to the stream in large pieces and when
+ * the program ends, error or not.
+ */
+
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ast.h"
+#include "bytecode.h"
+#include "error_report.h"
+#include "lexer.h"
+#include "resolver.h"
+#include "type_checker.h"
+
+constexpr std::uint32_t MaxCallDepth = 2048; ///< Calls that may be active at once; the tree-walker recurses on the C++ stack
+
+/**
+ * @brief Outcome of running a program
+ */
+typedef struct
+{
+    bool ok;          ///< False if it stopped at a run-time error
+    Diagnostic error; ///< The error and the operator or call where it happened, if !ok
+} RunResult;
+
+/**
+ * @brief Reusable bytecode interpreter that keeps its stacks between programs.
+ *
+ * Not thread-safe; use one instance per thread.
+ */
+class Interpreter
+{
+public:
+    static constexpr size_t StackValues = 256 * 1024; ///< Value stack size (variables and operands of all active calls)
+
+    Interpreter();
+
+    Interpreter(const Interpreter &) = delete;
+    Interpreter &operator=(const Interpreter &) = delete;
+
+    /**
+     * @brief Runs a program from the first top-level statement to the end.
+     * @param program The program, as compiled by BytecodeCompiler.
+     * @param out Receives what it prints.
+     * @return RunResult Whether it ran to the end.
+     */
+    RunResult run(const Program &program, std::ostream &out);
+
+private:
+    struct Frame
+    {
+        const std::uint8_t *returnAddress;
+        Value *base;
+        const BytecodeFunction *function;
+    };
+
+    std::vector<Value> stack;
+    std::vector<Frame> frames; ///< MaxCallDepth entries, filled from the front
+    std::vector<Value> globals;
+    std::string output;
+};
+
+/**
+ * @brief Reusable tree-walking interpreter, the reference for Interpreter.
+ *
+ * Not thread-safe; use one instance per thread.
+ */
+class TreeWalker
+{
+public:
+    TreeWalker() = default;
+
+    TreeWalker(const TreeWalker &) = delete;
+    TreeWalker &operator=(const TreeWalker &) = delete;
+
+    /**
+     * @brief Runs a checked tree without errors.
+     * @param tree The tree, as built by Parser.
+     * @param tokens The tokens it was parsed from.
+     * @param literals The decoded literals of those tokens (see Token::literal).
+     * @param resolution Its names, as bound by Resolver.
+     * @param types Its node types, as computed by TypeChecker.
+     * @param out Receives what it prints.
+     * @return RunResult Whether it ran to the end.
+     */
+    RunResult run(const AstView &tree, const std::vector<Token> &tokens, const std::vector<NumericLiteral> &literals,
+                  const Resolution &resolution, const std::vector<TypeId> &types, std::ostream &out);
+
+private:
+    bool execute(NodeIndex node);
+    Value evaluate(NodeIndex node);
+    Value evaluateAs(NodeIndex node, TypeId to);
+    Value binary(NodeIndex node);
+    Value binaryOperator(NodeIndex node, Value left);
+    Value call(NodeIndex node);
+    Value &variable(NodeIndex name);
+    void print(Value value, TypeId type);
+
+    AstView tree;
+    const std::vector<Token> *tokens = nullptr;
+    const std::vector<NumericLiteral> *literals = nullptr;
+    const Resolution *resolution = nullptr;
+    const std::vector<TypeId> *types = nullptr;
+    std::ostream *out = nullptr;
+    std::vector<Value> globals;
+    std::vector<Value> locals;  ///< Frames of the active calls, innermost last
+    size_t base = 0;            ///< First slot of the innermost frame
+    std::uint32_t depth = 0;    ///< Active calls
+    TypeId returnType = TypeVoid;
+    Value returned = {0};       ///< Value of the return statement that ended the current call
+    std::unordered_map<NodeIndex, std::string> strings; ///< Decoded string literals, by node
+    std::vector<NodeIndex> chain; ///< Operators down the left of the binary chains being evaluated, outermost first
+    std::string output;
+};
+
+#endif // INTERPRETER_H
@@ -6,80 +6,261 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <cstdint>
 #include <iostream>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <unordered_map>
-#include "C:/coding-projects/CPP-Dev/bassil/src/headers/utils.h"
+#include "arena.h"
+#include "interner.h"
+#include "utils.h"
+#include "error_report.h"
 #include <fstream>
 
 /**
  * @brief Enumeration for Token types
+ *
+ * Every operator and keyword has its own kind, and each category occupies a
+ * contiguous range, so the category tests below are one or two integer
+ * compares and a parser can dispatch on the kind with a dense switch (a jump
+ * table). The underlying type is one byte. Keep the ranges contiguous when
+ * adding kinds; the range checks after the enum rely on the first and last
+ * member of each group.
  */
-typedef enum
+typedef enum : std::uint8_t
 {
-    TK_Identifier,         ///< Identifiers (variable names, function names, etc.)
-    TK_Argument,           ///< Command arguments
-    TK_String,             ///< String literals
-    TK_Semicolon,          ///< Semicolon (;)
-    TK_Integer,            ///< Integer literals
-    TK_Float,              ///< Floating-point literals
-    TK_MathOperator,       ///< Mathematical operators (+, -, *, /, %)
-    TK_EqualsSign,         ///< Equals sign (=)
-    TK_TypeInteger,        ///< Integer type keyword
-    TK_TypeChar,           ///< Character type keyword
-    TK_TypeFloat,          ///< Float type keyword
-    TK_TypeString,         ///< String type keyword
-    TK_OpenParen,          ///< Opening parenthesis (
-    TK_CloseParen,         ///< Closing parenthesis )
-    TK_OpenBrace,          ///< Opening brace {
-    TK_CloseBrace,         ///< Closing brace }
-    TK_Comma,              ///< Comma (,)
-    TK_LogicalOperator,    ///< Logical operators (&&, ||, !)
-    TK_ComparisonOperator, ///< Comparison operators (==, !=, <, >, <=, >=)
-    TK_Unknown             ///< Unknown token type
+    // Literals and names
+    TK_Identifier,   ///< Identifiers (variable names, function names, etc.)
+    TK_Integer,      ///< Integer literals
+    TK_Float,        ///< Floating-point literals
+    TK_String,       ///< String literals
+    TK_Char,         ///< Character literals ('A', '\n')
+    TK_Argument,     ///< Command arguments
+
+    // Punctuation
+    TK_Semicolon,    ///< Semicolon (;)
+    TK_Comma,        ///< Comma (,)
+    TK_OpenParen,    ///< Opening parenthesis (
+    TK_CloseParen,   ///< Closing parenthesis )
+    TK_OpenBrace,    ///< Opening brace {
+    TK_CloseBrace,   ///< Closing brace }
+
+    // Operators: assignment, then arithmetic, comparison and logical groups
+    TK_EqualsSign,   ///< Equals sign (=)
+    TK_Plus,         ///< +
+    TK_Minus,        ///< -
+    TK_Star,         ///< *
+    TK_Slash,        ///< /
+    TK_Percent,      ///< %
+    TK_EqualEqual,   ///< ==
+    TK_NotEqual,     ///< !=
+    TK_Less,         ///< <
+    TK_Greater,      ///< >
+    TK_LessEqual,    ///< <=
+    TK_GreaterEqual, ///< >=
+    TK_AndAnd,       ///< &&
+    TK_OrOr,         ///< ||
+    TK_Not,          ///< !
+
+    // Keywords: type names first, then statement and value keywords
+    TK_TypeInteger,  ///< Integer type keyword (int)
+    TK_TypeChar,     ///< Character type keyword (char)
+    TK_TypeFloat,    ///< Float type keyword (float)
+    TK_TypeString,   ///< String type keyword (string)
+    TK_TypeBool,     ///< Boolean type keyword (bool)
+    TK_If,           ///< if
+    TK_Else,         ///< else
+    TK_For,          ///< for
+    TK_Function,     ///< function
+    TK_Return,       ///< return
+    TK_True,         ///< true
+    TK_False,        ///< false
+
+    TK_Unknown,      ///< Unknown token type
+    TK_KindCount     ///< Number of kinds (not a token)
 } TokenKind;
 
+/// @name Token categories
+/// Range checks over TokenKind; usable in constant expressions.
+/// @{
+constexpr bool isLiteral(TokenKind kind) { return kind >= TK_Integer && kind <= TK_Char; }
+constexpr bool isPunctuation(TokenKind kind) { return kind >= TK_Semicolon && kind <= TK_CloseBrace; }
+constexpr bool isOperator(TokenKind kind) { return kind >= TK_EqualsSign && kind <= TK_Not; }
+constexpr bool isArithmetic(TokenKind kind) { return kind >= TK_Plus && kind <= TK_Percent; }
+constexpr bool isComparison(TokenKind kind) { return kind >= TK_EqualEqual && kind <= TK_GreaterEqual; }
+constexpr bool isLogical(TokenKind kind) { return kind >= TK_AndAnd && kind <= TK_Not; }
+constexpr bool isBinaryOperator(TokenKind kind) { return kind >= TK_Plus && kind <= TK_OrOr; }
+constexpr bool isTypeKeyword(TokenKind kind) { return kind >= TK_TypeInteger && kind <= TK_TypeBool; }
+constexpr bool isKeyword(TokenKind kind) { return kind >= TK_TypeInteger && kind <= TK_False; }
+/// @}
+
+/**
+ * @brief Name of a token kind as shown by display_tokens ("Identifier", "LessEqual", ...).
+ * @param kind The kind.
+ * @return const char* Static string; "Unknown" for out-of-range values.
+ */
+const char *tokenKindName(TokenKind kind);
+
 /**
  * @brief Structure to represent a token
  */
 typedef struct
 {
     TokenKind type;    ///< Type of the token
-    std::string value; ///< Value of the token
+    std::string_view value; ///< Text of the token, stored in the CompilationArena passed to lex() (names: in the interner)
     int line;          ///< Line number where the token is found
     int start_column;  ///< Start column of the token
     int end_column;    ///< End column of the token
+    SymbolId symbol = NoSymbol; ///< Interned name (Interner::global()) of identifiers and keywords
+    std::uint32_t literal = 0;  ///< 1-based index into the NumericLiteral table of TK_Integer/TK_Float/TK_Char tokens
+    bool malformed = false;     ///< The lexer reported an error for this token, so later stages need not
 } Token;
 
+/**
+ * @brief Binary value of a numeric or character literal, decoded by lex()
+ */
+typedef struct
+{
+    std::uint32_t token; ///< Index of the TK_Integer/TK_Float/TK_Char token
+    bool valid;          ///< False if the literal is malformed or out of range (a diagnostic was emitted)
+    union
+    {
+        std::int64_t integer; ///< Value of a TK_Integer, or the character code of a TK_Char
+        double floating;      ///< Value of a TK_Float
+    };
+} NumericLiteral;
+
 extern bool logBool; ///< Global flag to control logging
 
 /**
- * @brief Check if a character is a valid identifier start.
+ * @brief Check if a byte is an ASCII identifier start (letter or '_').
+ *
+ * Bytes 0x80 and above are never accepted here; the lexer decodes them and
+ * checks the code point with Utf8::isXidStart().
+ *
  * @param c The character to check.
  * @return bool True if the character is a valid identifier start, false otherwise.
  */
 inline bool isIdentifierStart(char c)
 {
-    return std::isalpha(c) || c == '_';
+    return static_cast<unsigned char>((c | 0x20) - 'a') < 26 || c == '_';
 }
 
 /**
- * @brief Check if a character is a valid identifier continuation.
+ * @brief Check if a byte is an ASCII identifier continuation (letter, digit or '_').
  * @param c The character to check.
  * @return bool True if the character is a valid identifier continuation, false otherwise.
  */
 inline bool isIdentifierContinuation(char c)
 {
-    return std::isalnum(c) || c == '_';
+    return isIdentifierStart(c) || static_cast<unsigned char>(c - '0') < 10;
 }
 
+/**
+ * @brief Unit of Token and Diagnostic columns
+ */
+typedef enum
+{
+    CM_Bytes,      ///< Columns count bytes (what editors using byte offsets expect)
+    CM_Codepoints  ///< Columns count UTF-8 characters, so carets line up under the source text
+} ColumnMode;
+
 /**
  * @brief Lexically analyze the input string and generate tokens
  * @param inputString The input string to be analyzed
+ * @param arena Holds the token values; must outlive the returned tokens
+ * @return Vector of tokens
+ */
+std::vector<Token> lex(const std::string &inputString, CompilationArena &arena);
+
+/**
+ * @brief Lexically analyze the input string, collecting lexical errors
+ * @param inputString The input string to be analyzed
+ * @param diagnostics Receives one entry per lexical error, in source order
+ * @param arena Holds the token values and diagnostic messages; must outlive both
  * @return Vector of tokens
  */
-std::vector<Token> lex(const std::string &inputString);
+std::vector<Token> lex(const std::string &inputString, std::vector<Diagnostic> &diagnostics, CompilationArena &arena);
+
+/**
+ * @brief Lexically analyze the input string, also decoding numeric literals
+ * @param inputString The input string to be analyzed
+ * @param diagnostics Receives one entry per lexical error, in source order
+ * @param arena Holds the token values and diagnostic messages; must outlive both
+ * @param literals Receives the value of every number token, in token order (see Token::literal)
+ * @return Vector of tokens
+ */
+std::vector<Token> lex(const std::string &inputString, std::vector<Diagnostic> &diagnostics, CompilationArena &arena, std::vector<NumericLiteral> &literals);
+
+/**
+ * @brief Reusable lexer that keeps its tables and output buffers between files.
+ *
+ * The free lex() functions build a fresh token vector per call and grow it
+ * from empty. A Lexer kept per thread instead reuses the capacity of its
+ * token, diagnostic and literal buffers, and reserves tokens for a new input
+ * from its size (see BytesPerToken) so a file rarely regrows them. Once the
+ * buffers have seen a file as large as the current one, and the arena is
+ * rewound between files, lexing allocates nothing except for names the
+ * interner has not seen before.
+ *
+ * The input is checked as UTF-8 first (Utf8::findInvalid); each invalid
+ * sequence is reported once and lexed as an unknown byte. Errors never stop
+ * lexing: the offending token is kept, flagged Token::malformed, and lexing
+ * resumes after it (an unterminated string ends at its line). Identifiers may
+ * contain Unicode XID characters. Columns count characters unless
+ * setColumnMode(CM_Bytes) is used.
+ *
+ * Results are valid until the next lex() or reset(). Not thread-safe; use one
+ * instance per thread.
+ */
+class Lexer
+{
+public:
+    /// Typical source bytes per token, used to pre-size the token buffer (main.basl has ~9).
+    static constexpr size_t BytesPerToken = 6;
+
+    explicit Lexer(Interner &interner = Interner::global());
+
+    Lexer(const Lexer &) = delete;
+    Lexer &operator=(const Lexer &) = delete;
+
+    /**
+     * @brief Lexes one input, replacing the previous results.
+     * @param input The source text.
+     * @param arena Holds the token values and diagnostic messages; must outlive the results.
+     * @return const std::vector<Token>& The tokens (same as tokens()).
+     */
+    const std::vector<Token> &lex(std::string_view input, CompilationArena &arena);
+
+    /**
+     * @brief Selects how columns are counted (CM_Codepoints by default).
+     */
+    void setColumnMode(ColumnMode mode) { columns = mode; }
+    ColumnMode columnMode() const { return columns; }
+
+    /**
+     * @brief Clears the results but keeps the buffers' capacity for the next input.
+     */
+    void reset();
+
+    const std::vector<Token> &tokens() const { return tokenBuffer; }                  ///< Tokens of the last input
+    const std::vector<Diagnostic> &diagnostics() const { return diagnosticBuffer; }   ///< Lexical errors, in source order
+    const std::vector<NumericLiteral> &literals() const { return literalBuffer; }     ///< Decoded literals (see Token::literal)
+
+private:
+    static constexpr size_t KeywordSlots = 64;
+
+    TokenKind keywordKind(SymbolId symbol) const;
+
+    Interner &interner;
+    ColumnMode columns = CM_Codepoints;
+    SymbolId keywordSymbols[KeywordSlots] = {}; ///< Open-addressing table of keyword symbols
+    TokenKind keywordKinds[KeywordSlots] = {};
+    std::vector<Token> tokenBuffer;
+    std::vector<Diagnostic> diagnosticBuffer;
+    std::vector<NumericLiteral> literalBuffer;
+};
 
 /**
  * @brief Display the generated tokens
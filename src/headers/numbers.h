@@ -0,0 +1,57 @@
+/**
+ * @file numbers.h
+ * @brief Fast decoding of Bassil numeric literals into binary values.
+ *
+ * Integers are converted eight digits at a time with SWAR arithmetic on a
+ * 64-bit word. Decimals use Clinger's exact fast path when the significand
+ * and exponent are small, then the Eisel-Lemire algorithm (one or two 64x128
+ * bit multiplications against a table of powers of five), and only fall back
+ * to std::from_chars in the rare cases Eisel-Lemire cannot decide. Results are
+ * correctly rounded and independent of the C locale.
+ */
+
+#ifndef NUMBERS_H
+#define NUMBERS_H
+
+#include <cstdint>
+#include <string_view>
+
+namespace Numbers
+{
+    /**
+     * @brief Outcome of decoding a literal.
+     */
+    typedef enum
+    {
+        NP_Ok,         ///< Decoded
+        NP_OutOfRange, ///< Too large for int64 / double
+        NP_Malformed   ///< Not digits[.digits]
+    } ParseStatus;
+
+    /**
+     * @brief Decodes a decimal integer literal (digits only).
+     * @param text The literal.
+     * @param value Receives the value.
+     * @return ParseStatus NP_OutOfRange above INT64_MAX.
+     */
+    ParseStatus parseInteger(std::string_view text, std::int64_t &value);
+
+    /**
+     * @brief Decodes a decimal literal of the form digits[.digits].
+     * @param text The literal.
+     * @param value Receives the correctly rounded value.
+     * @return ParseStatus NP_OutOfRange if the value overflows to infinity.
+     */
+    ParseStatus parseFloat(std::string_view text, double &value);
+
+    /**
+     * @brief Computes w * 10^q correctly rounded with the Eisel-Lemire algorithm.
+     * @param w Decimal significand.
+     * @param q Decimal exponent.
+     * @param value Receives the result (may be 0 or infinity).
+     * @return bool False in the rare ambiguous cases where the caller must fall back.
+     */
+    bool eiselLemire(std::uint64_t w, int q, double &value);
+}
+
+#endif // NUMBERS_H
@@ -0,0 +1,160 @@
+/**
+ * @file parse_cache.h
+ * @brief On-disk cache of lexed and parsed files, loaded with mmap, keyed by content hash.
+ *
+ * After a file is lexed and parsed, its tokens, decoded literals, syntax tree
+ * and diagnostics are written to one binary image in the cache directory,
+ * named after a hash of the file's content. The next build that reads the
+ * same content maps the image instead of lexing and parsing again.
+ *
+ * The image is a header followed by 8-byte aligned sections. The tree's
+ * arrays and the diagnostics are fixed-size records used in place: the tree
+ * becomes an AstView of the mapped bytes directly. Every reference (section
+ * positions, token text, diagnostic messages) is an offset from the start of
+ * the image or of the string table, never a pointer, so nothing is fixed up
+ * on load. Loading checks the header, that the sections fit the file, a
+ * checksum of the sections, and that the tree is well formed: valid kinds and
+ * tokens, children in range and before their parent, a Program root. A
+ * damaged image is then a cache miss. Tokens are only rebuilt
+ * when they are printed, front to back, so they are delta-encoded instead of
+ * stored as records, which would make them most of the image.
+ *
+ *     Header
+ *     tokens        tokenCount delta-encoded tokens (a byte stream)
+ *     literals      CachedLiteral[literalCount]
+ *     kinds         NodeKind[nodeCount]
+ *     node tokens   uint32[nodeCount]
+ *     node data     NodeData[nodeCount]
+ *     extra         NodeIndex[extraCount]
+ *     diagnostics   CachedDiagnostic[diagnosticCount]
+ *     strings       token text and messages (each name and operator once)
+ *
+ * Images use the byte order of the machine that wrote them; the magic number
+ * tells a foreign one apart, and FormatVersion changes whenever the layout
+ * or a pass changes what they would contain. Images are written to a
+ * temporary file and renamed into place, so readers never see a partial one.
+ */
+
+#ifndef PARSE_CACHE_H
+#define PARSE_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ast.h"
+#include "error_report.h"
+#include "lexer.h"
+
+namespace ParseCache
+{
+    /// Version of the image layout and of what the compiler's passes put in it (7: image checksum).
+    constexpr std::uint32_t FormatVersion = 7;
+
+    /**
+     * @brief Hash of a file's content, the key of its cache entry.
+     *
+     * Four independent 64-bit multiply lanes over 32-byte blocks, so hashing
+     * runs at memory speed rather than at one byte per multiply like FNV-1a.
+     *
+     * @param content The bytes to hash.
+     * @return std::uint64_t The hash.
+     */
+    std::uint64_t hashSource(std::string_view content);
+
+    /**
+     * @brief Path of the entry for a content hash.
+     * @param directory The cache directory.
+     * @param hash The content hash (see hashSource()).
+     * @param columnMode Columns differ by mode, so each mode has its own entries.
+     * @return std::string The path.
+     */
+    std::string entryPath(const std::string &directory, std::uint64_t hash, ColumnMode columnMode);
+
+    /**
+     * @brief A mapped cache image. Immutable; the views it returns live as long as it does.
+     */
+    class Entry
+    {
+    public:
+        ~Entry();
+
+        Entry(const Entry &) = delete;
+        Entry &operator=(const Entry &) = delete;
+
+        /**
+         * @brief Maps the entry of a file's content, if it is cached.
+         * @param directory The cache directory.
+         * @param hash The content hash.
+         * @param sourceSize Size of the content in bytes.
+         * @param columnMode The column mode of the build.
+         * @return std::shared_ptr<const Entry> The entry, or nullptr if there is none, it is
+         *         of another version, its header does not match, or it is damaged.
+         */
+        static std::shared_ptr<const Entry> open(const std::string &directory, std::uint64_t hash, std::uint64_t sourceSize, ColumnMode columnMode);
+
+        std::uint32_t tokenCount() const; ///< Tokens of the file, without building them
+
+        /**
+         * @brief The syntax tree, in place in the mapping.
+         */
+        AstView tree() const;
+
+        /**
+         * @brief The errors of every pass (lexical, syntax, names, types, constants), in source order.
+         * @return std::vector<Diagnostic> The errors; their messages point into the mapping.
+         * @throw std::runtime_error if a message lies outside the string table.
+         */
+        std::vector<Diagnostic> diagnostics() const;
+
+        /**
+         * @brief Rebuilds the tokens, as lex() returned them.
+         *
+         * Text points into the mapping, except that names and keywords are
+         * interned again (Interner::global()) to get this process's symbols.
+         *
+         * @return std::vector<Token> The tokens.
+         * @throw std::runtime_error if a token's text lies outside the string table.
+         */
+        std::vector<Token> tokens() const;
+
+        /**
+         * @brief The decoded numeric and character literals (see Token::literal).
+         */
+        std::vector<NumericLiteral> literals() const;
+
+    private:
+        Entry() = default;
+
+        std::string_view string(std::uint32_t offset, std::uint32_t length) const;
+
+        const char *image = nullptr;
+        size_t imageSize = 0;
+        bool mapped = false;      ///< image is an mmap() of the file, rather than a copy in buffer
+        std::vector<std::uint64_t> buffer;
+    };
+
+    /**
+     * @brief Writes the entry of a file after it was lexed and parsed.
+     *
+     * Safe to call concurrently, also from several processes: the image is
+     * written to a temporary file and renamed over any existing entry.
+     *
+     * @param directory The cache directory; created if missing.
+     * @param hash The content hash.
+     * @param sourceSize Size of the content in bytes.
+     * @param columnMode The column mode the tokens were lexed with.
+     * @param tokens The tokens.
+     * @param literals The decoded literals.
+     * @param tree The syntax tree.
+     * @param diagnostics The errors of every pass.
+     * @param error Receives a message if the entry could not be written.
+     * @return bool False if writing failed (the build goes on without it).
+     */
+    bool store(const std::string &directory, std::uint64_t hash, std::uint64_t sourceSize, ColumnMode columnMode,
+               const std::vector<Token> &tokens, const std::vector<NumericLiteral> &literals, const Ast &tree,
+               const std::vector<Diagnostic> &diagnostics, std::string &error);
+}
+
+#endif // PARSE_CACHE_H
@@ -1 +1,201 @@
-// Coming Soon
\ No newline at end of file
+/**
+ * @file parser.h
+ * @brief Parser building the syntax tree of a Bassil source file from its tokens.
+ *
+ * Statements are parsed by recursive descent and expressions by precedence
+ * climbing (Pratt): each binary operator kind has a binding power, looked up
+ * in a table indexed by TokenKind. The parser makes a single pass over the
+ * tokens with one token of lookahead and never backtracks; error recovery
+ * also only skips forward, so no token buffer is kept for rewinding. The result is a
+ * flat Ast (see ast.h): nodes are appended to a few arrays the parser reuses
+ * from file to file, with children collected on a scratch stack until their
+ * parent is finished.
+ *
+ * Grammar (main.basl is the reference):
+ *
+ *     program    := (function | statement)*
+ *     function   := 'function' type? NAME '(' (type NAME (',' type NAME)*)? ')' block
+ *     statement  := type NAME ('=' expression)? ';'
+ *                 | 'if' '(' expression ')' statement ('else' statement)?
+ *                 | 'for' '(' (declaration | expression)? ';' expression? ';' expression? ')' statement
+ *                 | 'return' expression? ';'
+ *                 | '{' statement* '}'
+ *                 | expression? ';'
+ *     expression := assignment, ||, &&, == !=, < > <= >=, + -, * / %, unary - !, call
+ *                   (lowest to highest precedence; '=' is right associative)
+ */
+
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <cstdint>
+#include <initializer_list>
+#include <string_view>
+#include <vector>
+#include "arena.h"
+#include "ast.h"
+#include "error_report.h"
+#include "lexer.h"
+#include "thread_pool.h"
+
+/**
+ * @brief Where one top-level item (function or statement) of a parse starts
+ */
+typedef struct
+{
+    std::uint32_t firstToken;      ///< Its first token; it ends where the next item starts
+    NodeIndex node;                ///< Its node, or NoNode if error recovery dropped it
+    std::uint32_t firstDiagnostic; ///< Index of its first syntax error in Parser::diagnostics()
+} TopLevelItem;
+
+constexpr NodeIndex NoNode = ~NodeIndex(0); ///< TopLevelItem::node of a dropped item
+
+/**
+ * @brief Reusable parser that keeps its scratch buffers between files.
+ *
+ * Syntax errors are reported as Diagnostics and recovered from in panic mode:
+ * the broken statement is dropped from the tree and parsing resumes after the
+ * next ';' at the same brace depth, before the '}' closing the enclosing
+ * block, or at the next keyword that starts a statement. One pass therefore
+ * reports every error. An error at or right after a token the lexer already
+ * reported (Token::malformed) is not reported again, nor is a second error
+ * at the same position.
+ *
+ * Once its buffers have grown to the size of the largest file, parsing
+ * allocates nothing. Results are valid until the next parse(). Not
+ * thread-safe; use one instance per thread.
+ */
+class Parser
+{
+public:
+    /// Deepest expression or statement nesting accepted, so hostile input cannot overflow the stack.
+    static constexpr int MaxDepth = 1000;
+
+    /// Files with fewer tokens are not worth splitting across threads (see parseParallel()).
+    static constexpr size_t ParallelMinTokens = 1 << 16;
+
+    /// Fewest tokens handed to one parallel task.
+    static constexpr size_t ParallelChunkTokens = 1 << 14;
+
+    Parser() = default;
+
+    Parser(const Parser &) = delete;
+    Parser &operator=(const Parser &) = delete;
+
+    /**
+     * @brief Parses the tokens of one file.
+     * @param tokens The tokens, as produced by lex().
+     * @param arena Holds the diagnostic messages.
+     * @return const Ast& The tree (same as tree()); its root is an NK_Program node.
+     */
+    const Ast &parse(const std::vector<Token> &tokens, CompilationArena &arena);
+
+    /**
+     * @brief Parses a large file's top-level items on a thread pool.
+     *
+     * Top-level items do not depend on each other syntactically, so after a
+     * pre-pass (findTopLevelChunks()) cuts the tokens into runs of whole items,
+     * each run is parsed by a worker's own parser into its own node arrays.
+     * The runs are then rebased and copied into one tree in source order,
+     * also in parallel. The result is identical to parse(): small files, files
+     * with unbalanced brackets and files with any syntax error are parsed
+     * sequentially (errors are rare, and recovery must see the whole file).
+     *
+     * May be called from inside a task of @p pool (see ThreadPool::parallelFor()).
+     *
+     * @param tokens The tokens, as produced by lex().
+     * @param arena Holds the diagnostic messages.
+     * @param pool Runs the parallel parts.
+     * @return const Ast& The tree (same as tree()).
+     */
+    const Ast &parseParallel(const std::vector<Token> &tokens, CompilationArena &arena, ThreadPool &pool);
+
+    /**
+     * @brief Parses the top-level items that start in tokens [begin, end), for reparsing part of a file.
+     *
+     * The tokens outside the range are context: token begin - 1 is the one
+     * before the first item (no error is reported right after a malformed
+     * token), and the tokens from @p end on are only looked at, unless the
+     * last item runs past @p end; stoppedAt() tells.
+     *
+     * @param tokens The tokens.
+     * @param arena Holds the diagnostic messages.
+     * @param begin First token of the first item.
+     * @param end Token where the next item is expected to start.
+     * @return const Ast& The tree (same as tree()); its root's token is @p begin.
+     */
+    const Ast &parseItems(const std::vector<Token> &tokens, CompilationArena &arena, std::uint32_t begin, std::uint32_t end);
+
+    const Ast &tree() const { return treeBuffer; }                                  ///< Tree of the last parse()
+    const std::vector<Diagnostic> &diagnostics() const { return diagnosticBuffer; } ///< Syntax errors of the last parse()
+    const std::vector<TopLevelItem> &items() const { return itemBuffer; }           ///< Top-level items of the last parse() or parseItems()
+    std::uint32_t stoppedAt() const { return position; }                           ///< Token after the last item parsed
+
+private:
+    struct Abort
+    {
+    };
+
+    /// Leaves one nesting level when destroyed (see enter()).
+    struct Nesting
+    {
+        int &depth;
+        ~Nesting() { depth--; }
+    };
+
+    void parseRange(const std::vector<Token> &input, CompilationArena &messageArena, std::uint32_t begin, std::uint32_t end, std::uint32_t limit);
+    void parseItem(bool topLevel);
+    void synchronize(std::uint32_t statementStart, bool insideBlock);
+    NodeIndex parseFunction();
+    NodeIndex parseStatement();
+    NodeIndex parseDeclaration();
+    NodeIndex parseIf();
+    NodeIndex parseFor();
+    NodeIndex parseReturn();
+    NodeIndex parseBlock();
+    NodeIndex parseExpression(int minimumPower);
+    NodeIndex parsePrefix();
+    NodeIndex parseType();
+
+    NodeIndex makeNode(NodeKind kind, std::uint32_t token);
+    NodeIndex makeNode(NodeKind kind, std::uint32_t token, std::initializer_list<NodeIndex> children);
+    NodeIndex makeNode(NodeKind kind, std::uint32_t token, size_t firstChild);
+
+    /// Kind of the current token, or TK_KindCount at the end of the input.
+    TokenKind peek() const { return position < count ? (*tokens)[position].type : TK_KindCount; }
+    std::uint32_t expect(TokenKind kind, const char *what);
+    bool accept(TokenKind kind);
+    [[noreturn]] void fail(const char *expected, bool afterPrevious = false);
+    [[noreturn]] void failAt(std::uint32_t token, std::string_view message, bool afterPrevious = false);
+    void report(std::uint32_t token, std::string_view message, bool afterPrevious = false);
+    Nesting enter();
+
+    const std::vector<Token> *tokens = nullptr;
+    CompilationArena *arena = nullptr;
+    std::uint32_t position = 0;
+    std::uint32_t count = 0;
+    int depth = 0;
+    Ast treeBuffer;
+    std::vector<NodeIndex> scratch; ///< Children of the nodes being built, popped as each node is finished
+    std::vector<Diagnostic> diagnosticBuffer;
+    std::vector<TopLevelItem> itemBuffer;
+    std::vector<std::uint32_t> chunkEnds;    ///< parseParallel(): end token of each run
+    std::vector<Ast> chunkTrees;             ///< parseParallel(): tree of each run
+    std::vector<std::uint32_t> chunkOffsets; ///< parseParallel(): node, extra and item offset of each run
+};
+
+/**
+ * @brief Cuts the tokens into runs of whole top-level items (pre-pass of Parser::parseParallel()).
+ *
+ * Matches braces and parentheses over the token kinds only: an item ends at
+ * a ';' or '}' outside all brackets that is not followed by 'else'. Each run
+ * but the last has at least @p targetTokens tokens.
+ *
+ * @param tokens The tokens.
+ * @param targetTokens Smallest run length.
+ * @param ends Receives the end (one past the last token) of each run.
+ * @return bool False if the brackets do not balance, so items cannot be found.
+ */
+bool findTopLevelChunks(const std::vector<Token> &tokens, size_t targetTokens, std::vector<std::uint32_t> &ends);
+
+#endif // PARSER_H
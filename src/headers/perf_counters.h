@@ -0,0 +1,130 @@
+/**
+ * @file perf_counters.h
+ * @brief Optional hardware performance counters (Linux perf_event_open) around named regions.
+ *
+ * Wrap a phase in BASSIL_PERF_REGION("lex", sourceBytes) and, once counters are
+ * enabled, the cycles, instructions, branch misses and L1D/LLC read misses of
+ * the calling thread are accumulated under that name. report() prints IPC and
+ * misses per KB of source for every region.
+ *
+ * Counters are opened lazily per thread. When perf_event_open is unavailable
+ * (non-Linux, containers without a PMU, perf_event_paranoid too strict) the
+ * regions still record wall time and the report says why counters are missing.
+ */
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace PerfCounters
+{
+    /**
+     * @brief The hardware events that are counted.
+     */
+    typedef enum
+    {
+        PC_Cycles,       ///< CPU cycles
+        PC_Instructions, ///< Retired instructions
+        PC_BranchMisses, ///< Mispredicted branches
+        PC_L1DMisses,    ///< L1 data cache read misses
+        PC_LLCMisses,    ///< Last level cache read misses
+        PC_Count
+    } Counter;
+
+    /**
+     * @brief Accumulated measurements of one named region.
+     */
+    struct RegionTotals
+    {
+        std::string name;
+        std::uint64_t calls = 0;
+        std::uint64_t bytes = 0;       ///< Source bytes processed, for per-KB rates
+        std::uint64_t nanoseconds = 0; ///< Wall time
+        std::uint64_t values[PC_Count] = {};
+        bool valid[PC_Count] = {}; ///< False if the counter could not be opened
+    };
+
+    extern std::atomic<bool> enabledFlag; ///< Use isEnabled()/setEnabled()
+
+    /**
+     * @brief Returns whether regions are being measured.
+     * @return bool True if enabled.
+     */
+    inline bool isEnabled()
+    {
+        return enabledFlag.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Turns region measurement on or off.
+     * @param enabled True to measure.
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     * @brief Returns a human readable name of a counter.
+     * @param counter The counter.
+     * @return const char* E.g. "branch-misses".
+     */
+    const char *counterName(Counter counter);
+
+    /**
+     * @brief Returns why counters are unavailable on the calling thread.
+     * @return std::string Empty if at least one counter could be opened.
+     */
+    std::string unavailableReason();
+
+    /**
+     * @brief Returns a snapshot of every region measured so far, in first-use order.
+     * @return std::vector<RegionTotals> The totals.
+     */
+    std::vector<RegionTotals> totals();
+
+    /**
+     * @brief Discards all accumulated totals.
+     */
+    void reset();
+
+    /**
+     * @brief Prints a table with time, IPC and misses per KB for every region.
+     * @param out The destination stream.
+     */
+    void report(std::ostream &out);
+
+    /**
+     * @brief Measures the lifetime of a C++ scope on the calling thread.
+     */
+    class Region
+    {
+    public:
+        /**
+         * @param name Region name; must outlive the program (normally a literal).
+         * @param bytes Source bytes processed inside the region.
+         */
+        Region(const char *name, std::uint64_t bytes = 0);
+        ~Region();
+
+        Region(const Region &) = delete;
+        Region &operator=(const Region &) = delete;
+
+    private:
+        const char *name;
+        std::uint64_t bytes;
+        bool active;
+        std::uint64_t startNs = 0;
+        std::uint64_t start[PC_Count][3] = {}; ///< Value, time enabled and time running per counter
+    };
+}
+
+#define BASSIL_PERF_CONCAT_INNER(a, b) a##b
+#define BASSIL_PERF_CONCAT(a, b) BASSIL_PERF_CONCAT_INNER(a, b)
+
+/// Measures the rest of the enclosing block as region @p name over @p bytes of source.
+#define BASSIL_PERF_REGION(name, bytes) ::PerfCounters::Region BASSIL_PERF_CONCAT(bassilPerfRegion_, __LINE__)(name, bytes)
+
+#endif // PERF_COUNTERS_H
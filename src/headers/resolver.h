@@ -0,0 +1,171 @@
+/**
+ * @file resolver.h
+ * @brief Name resolution: binds every name in a syntax tree to its declaration.
+ *
+ * The resolver walks the tree once, in source order, and keeps the names in
+ * scope in one flat open-addressing table keyed by interned name (SymbolId).
+ * A slot holds the innermost declaration of its name; declaring a name that
+ * is already bound pushes the old binding onto an undo log, which is the
+ * shadow chain. Leaving a scope pops the log entries of the names declared
+ * in it and puts the shadowed bindings back, so it costs one step per name
+ * declared there, not per name in the table, and a lookup is one probe into
+ * the table plus the read of the declaration, however many globals there are.
+ *
+ * Scopes, outermost first: the builtins (print), the file's functions and
+ * globals, then each function (its parameters and the outer block of its
+ * body), block, for statement and if branch. Functions are declared before
+ * anything else, so calls may precede the definition and recursion works;
+ * variables are visible from their declaration on, after their initialiser.
+ * An inner scope may shadow a name, the same scope may not declare it twice.
+ *
+ * Each variable gets a storage slot: globals an index into the file's
+ * globals, parameters and locals a slot of their function's frame. Locals of
+ * scopes that have ended are reused, so frameSizes is the most live at once.
+ * The top-level statements run in frame 0, function n in frame n.
+ */
+
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "arena.h"
+#include "ast.h"
+#include "error_report.h"
+#include "interner.h"
+#include "lexer.h"
+
+/**
+ * @brief What a declared name is
+ */
+typedef enum : std::uint8_t
+{
+    SK_Builtin,  ///< A function provided by the runtime (see Builtin)
+    SK_Function, ///< A function of the file
+    SK_Global,   ///< A variable declared outside any function or block
+    SK_Local     ///< A parameter, or a variable declared in a function or block
+} SymbolKind;
+
+/**
+ * @brief Functions every file can call without declaring them
+ */
+typedef enum : std::uint8_t
+{
+    BI_Print,  ///< print(value): writes the value and a newline
+    BI_Count   ///< Number of builtins (not a builtin)
+} Builtin;
+
+/**
+ * @brief Name of a builtin, as written in source ("print").
+ * @param which The builtin.
+ * @return const char* Static string; "unknown" for out-of-range values.
+ */
+const char *builtinName(Builtin which);
+
+/**
+ * @brief One declaration found by the resolver
+ */
+typedef struct
+{
+    SymbolId name;         ///< Its name (Interner::global())
+    NodeIndex declaration; ///< Its NK_Function, NK_VarDecl or NK_Parameter node; NoNode for builtins
+    SymbolKind kind;
+    std::uint32_t slot;    ///< Builtin: a Builtin; function: its frame number; global: its index; local: its frame slot
+} SymbolInfo;
+
+constexpr std::uint32_t NoBinding = ~std::uint32_t(0); ///< Resolution::bindings of nodes that are not names
+
+/**
+ * @brief The result of resolving one tree
+ */
+struct Resolution
+{
+    std::vector<SymbolInfo> symbols;       ///< Every declaration, builtins first, then in source order (functions before the rest)
+    std::vector<std::uint32_t> bindings;   ///< Per node: index into symbols of the declaration it makes or names it uses, else NoBinding
+    std::vector<std::uint32_t> frameSizes; ///< Per frame: local slots (frame 0: top-level statements, n: function n)
+    std::uint32_t globalCount = 0;         ///< Slots of the file's globals
+};
+
+/**
+ * @brief Reusable name resolver that keeps its table and buffers between files.
+ *
+ * Reports undeclared names and names declared twice in one scope as
+ * Diagnostics; an undeclared name is left unbound (NoBinding). Once its
+ * buffers have grown to the largest file, resolving allocates only for the
+ * messages. Results are valid until the next resolve(). Not thread-safe; use
+ * one instance per thread.
+ */
+class Resolver
+{
+public:
+    explicit Resolver(Interner &interner = Interner::global());
+
+    Resolver(const Resolver &) = delete;
+    Resolver &operator=(const Resolver &) = delete;
+
+    /**
+     * @brief Resolves the names of one tree.
+     * @param tree The tree, as built by Parser.
+     * @param tokens The tokens it was parsed from (names need Token::symbol).
+     * @param arena Holds the diagnostic messages.
+     * @return const Resolution& The result (same as resolution()).
+     */
+    const Resolution &resolve(const AstView &tree, const std::vector<Token> &tokens, CompilationArena &arena);
+
+    const Resolution &resolution() const { return result; }                         ///< Result of the last resolve()
+    const std::vector<Diagnostic> &diagnostics() const { return diagnosticBuffer; } ///< Errors of the last resolve(), in source order
+
+private:
+    /// One name of the table: its innermost binding, kept (unbound) after its scopes end.
+    struct Slot
+    {
+        SymbolId name;
+        std::uint32_t symbol;
+    };
+
+    /// Undo log entry: the binding a declaration shadowed, put back when its scope ends.
+    struct Shadowed
+    {
+        std::uint32_t symbol;
+        std::uint32_t previous;
+    };
+
+    /// Where a scope starts, so leaving it can undo its declarations and free its slots.
+    struct Scope
+    {
+        std::uint32_t firstShadowed;
+        std::uint32_t firstSymbol;
+        std::uint32_t nextSlot;
+    };
+
+    void resolveFunction(NodeIndex node, std::uint32_t functionFrame);
+    void resolveStatement(NodeIndex node);
+    void resolveNested(NodeIndex node);
+    void resolveExpression(NodeIndex node);
+    void resolveBlockBody(NodeIndex block);
+    bool declare(NodeIndex node, SymbolKind kind, std::uint32_t slot);
+    void bind(std::uint32_t symbol);
+    void declareVariable(NodeIndex node);
+    void use(NodeIndex node);
+    void enterScope();
+    void leaveScope();
+    Slot &slotOf(SymbolId name);
+    void grow();
+    void report(std::uint32_t token, std::string_view message);
+
+    SymbolId builtinNames[BI_Count];
+    AstView tree;
+    const std::vector<Token> *tokens = nullptr;
+    CompilationArena *arena = nullptr;
+    Resolution result;
+    std::vector<Slot> table; ///< Open addressing, power-of-two size, at most half full
+    std::uint32_t names = 0; ///< Used slots of table
+    std::vector<Shadowed> undo;
+    std::vector<Scope> scopes;
+    std::uint32_t frame = 0;    ///< Frame of the statements being resolved
+    std::uint32_t nextSlot = 0; ///< First free slot of that frame
+    std::vector<Diagnostic> diagnosticBuffer;
+};
+
+#endif // RESOLVER_H
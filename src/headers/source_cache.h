@@ -0,0 +1,106 @@
+/**
+ * @file source_cache.h
+ * @brief In-memory cache of loaded sources, line indexes and lexer output.
+ *
+ * Used by long-running processes (the bassild compile server, watch mode) so
+ * an unchanged file is never read or lexed twice. Entries are revalidated
+ * with a stat() on every lookup; if the modification time or size changed the
+ * file is re-read, and it is only re-lexed when its content hash differs.
+ */
+
+#ifndef SOURCE_CACHE_H
+#define SOURCE_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "lexer.h"
+#include "parser.h"
+#include "error_report.h"
+
+/**
+ * @brief A lexed and parsed source file as held by the cache. Immutable once published.
+ */
+struct CachedSource
+{
+    std::string path;                    ///< Absolute path of the file
+    std::int64_t mtime = 0;              ///< Modification time (ns since epoch) when read
+    std::uintmax_t size = 0;             ///< File size when read
+    std::uint64_t hash = 0;              ///< Content hash (see ParseCache::hashSource)
+    std::string content;                 ///< File content
+    std::vector<size_t> lineOffsets;     ///< Byte offset of the start of every line
+    std::vector<Token> tokens;           ///< Output of lex()
+    Ast tree;                            ///< Output of Parser::parse(), indexing into tokens
+    std::vector<Diagnostic> diagnostics; ///< Lexical, syntax and semantic errors
+    std::shared_ptr<CompilationArena> arena; ///< Owns token values and diagnostic messages
+
+    /**
+     * @brief Returns the text of a line without its line terminator.
+     * @param lineNumber 1-based line number.
+     * @return std::string_view The line, or an empty view if out of range.
+     */
+    std::string_view lineText(int lineNumber) const;
+};
+
+/**
+ * @brief Counters describing how lookups were served.
+ */
+struct SourceCacheStats
+{
+    std::uint64_t hits = 0;       ///< Served without touching the file content
+    std::uint64_t rehashed = 0;   ///< Re-read because of a new mtime, content unchanged
+    std::uint64_t relexed = 0;    ///< Read and lexed (new file or changed content)
+    std::uint64_t failures = 0;   ///< File could not be read
+};
+
+/**
+ * @brief Thread-safe cache of CachedSource entries keyed by path.
+ */
+class SourceCache
+{
+public:
+    /**
+     * @param columnMode Unit of the columns of cached tokens and diagnostics.
+     */
+    explicit SourceCache(ColumnMode columnMode = CM_Codepoints) : columnMode(columnMode) {}
+
+    /**
+     * @brief Returns the up-to-date entry for a file, loading or refreshing it if needed.
+     *
+     * @param path Path of the file; callers should pass absolute paths.
+     * @param changed Optional, set to true if the returned entry differs from the
+     *        previously cached content (or the file was not cached before).
+     * @return std::shared_ptr<const CachedSource> The entry, or nullptr if the file can't be read.
+     */
+    std::shared_ptr<const CachedSource> get(const std::string &path, bool *changed = nullptr);
+
+    /**
+     * @brief Drops the entry for a file.
+     * @param path Path of the file.
+     */
+    void invalidate(const std::string &path);
+
+    /**
+     * @brief Returns the number of cached files.
+     * @return size_t The entry count.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Returns a snapshot of the lookup counters.
+     * @return SourceCacheStats The counters.
+     */
+    SourceCacheStats stats() const;
+
+private:
+    const ColumnMode columnMode;
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<const CachedSource>> entries;
+    SourceCacheStats counters;
+};
+
+#endif // SOURCE_CACHE_H
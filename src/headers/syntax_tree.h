@@ -0,0 +1,216 @@
+/**
+ * @file syntax_tree.h
+ * @brief Lossless red-green syntax tree with incremental reparsing, for editors.
+ *
+ * The green tree is immutable and position independent: a green node knows
+ * its kind, its width in bytes and its children, and a green token knows its
+ * kind and the widths of its leading trivia (whitespace and comments) and
+ * text. Every byte of the source belongs to exactly one token (trailing
+ * trivia to a final end-of-file token), so the tree reproduces the source.
+ * Because nothing in a green node depends on where it is, an edit builds a
+ * new root that shares every unchanged subtree with the previous version.
+ *
+ * Red nodes (SyntaxNode) are the view a caller walks: a green node plus its
+ * parent and absolute offset. They are made on demand, one per visited node,
+ * and never stored in the green tree.
+ *
+ * The root's children are the file's top-level items (functions and
+ * statements, as parsed by Parser) and the end-of-file token. After an edit,
+ * SyntaxTree::edit() re-lexes and reparses only the items the edit touches,
+ * plus the item before them, since that item's parse looked one token ahead
+ * into them. It widens the damaged range while the new tokens or items do not
+ * line up with the old ones at its ends (an edit that opens a comment or
+ * removes a '}', for example), so the result always equals a full parse.
+ */
+
+#ifndef SYNTAX_TREE_H
+#define SYNTAX_TREE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ast.h"
+#include "error_report.h"
+#include "lexer.h"
+
+/**
+ * @brief A token of a green tree
+ */
+typedef struct
+{
+    TokenKind kind;       ///< Kind; TK_KindCount for the end of the file, which only has trivia
+    bool malformed;       ///< The lexer reported an error for it (see Token::malformed)
+    std::uint32_t trivia; ///< Bytes of whitespace and comments before the token text
+    std::uint32_t width;  ///< Bytes of the trivia and the token text
+} GreenToken;
+
+struct GreenNode;
+typedef std::shared_ptr<const GreenNode> GreenNodePtr;
+
+/**
+ * @brief One child of a green node: a node or a token
+ */
+typedef struct
+{
+    GreenNodePtr node;    ///< The child node, or null if the child is a token
+    GreenToken token;     ///< The token, if node is null
+    std::uint32_t offset; ///< Bytes from the start of the parent
+} GreenChild;
+
+/**
+ * @brief A lexical or syntax error, kept with the top-level item it was found in
+ */
+struct GreenDiagnostic
+{
+    std::uint32_t offset; ///< Bytes from the start of the item (may point past its end, at the next token)
+    std::uint32_t length; ///< Bytes marked
+    bool lexical;         ///< Reported by the lexer rather than the parser
+    std::string message;
+};
+
+/**
+ * @brief An immutable node of a green tree
+ */
+struct GreenNode
+{
+    NodeKind kind = NK_Program;
+    std::uint32_t width = 0;                  ///< Bytes of all its tokens, trivia included
+    std::vector<GreenChild> children;         ///< Child nodes and the tokens no child covers, in source order
+    std::vector<GreenDiagnostic> diagnostics; ///< Errors of a top-level item (the root's: of the end-of-file trivia)
+};
+
+/**
+ * @brief A token seen through a red node, with its absolute position
+ */
+typedef struct
+{
+    TokenKind kind;
+    std::uint32_t offset;  ///< Absolute offset of its text (after the trivia)
+    std::string_view text; ///< Its text, without trivia
+} SyntaxToken;
+
+/**
+ * @brief Red node: a green node with its parent and absolute offset, made on demand
+ *
+ * Cheap to copy (one shared pointer). Keeps its tree version alive.
+ */
+class SyntaxNode
+{
+public:
+    NodeKind kind() const { return red->green->kind; }
+    std::uint32_t offset() const { return red->offset; }         ///< Absolute offset of its first byte (trivia included)
+    std::uint32_t width() const { return red->green->width; }    ///< Bytes it covers
+    std::string_view text() const;                               ///< Source text it covers, trivia included
+    const GreenNode &green() const { return *red->green; }
+    size_t childCount() const { return red->green->children.size(); }
+    bool isToken(size_t index) const { return !red->green->children[index].node; }
+    bool hasParent() const { return red->parent != nullptr; }
+
+    /**
+     * @brief The child node at @p index (isToken(index) must be false).
+     */
+    SyntaxNode child(size_t index) const;
+
+    /**
+     * @brief The child token at @p index (isToken(index) must be true).
+     */
+    SyntaxToken token(size_t index) const;
+
+    /**
+     * @brief The parent node (hasParent() must be true).
+     */
+    SyntaxNode parent() const;
+
+    /**
+     * @brief The innermost node whose text contains the byte at @p offset.
+     * @param offset Absolute offset inside this node.
+     * @return SyntaxNode That node (this one if no child contains it).
+     */
+    SyntaxNode nodeAt(std::uint32_t offset) const;
+
+private:
+    friend class SyntaxTree;
+
+    struct Red
+    {
+        GreenNodePtr green;
+        std::shared_ptr<const Red> parent;
+        std::shared_ptr<const std::string> source;
+        std::uint32_t offset;
+    };
+
+    explicit SyntaxNode(std::shared_ptr<const Red> red) : red(std::move(red)) {}
+
+    std::shared_ptr<const Red> red;
+};
+
+/**
+ * @brief Replacement of a byte range of the source
+ */
+struct TextEdit
+{
+    std::uint32_t offset = 0;  ///< First byte replaced
+    std::uint32_t removed = 0; ///< Bytes replaced
+    std::string inserted;      ///< Their replacement
+};
+
+/**
+ * @brief What SyntaxTree::edit() had to redo
+ */
+typedef struct
+{
+    std::uint32_t reusedItems;   ///< Top-level items shared with the previous version
+    std::uint32_t reparsedItems; ///< Top-level items built by the reparse
+    std::uint32_t relexedBytes;  ///< Bytes lexed again
+} ReparseStats;
+
+/**
+ * @brief One version of a source file and its green tree. Immutable; edit() returns a new version.
+ */
+class SyntaxTree
+{
+public:
+    /**
+     * @brief Lexes and parses a whole file.
+     * @param source The file content (at most 4 GB).
+     * @param columnMode Unit of the columns of diagnostics().
+     * @return SyntaxTree The tree.
+     */
+    static SyntaxTree parse(std::string source, ColumnMode columnMode = CM_Codepoints);
+
+    /**
+     * @brief Applies an edit, reparsing only the top-level items it damages (see the file comment).
+     * @param edit The edit, in bytes of source().
+     * @param stats Optional, receives what was redone.
+     * @return SyntaxTree The new version; this one stays valid.
+     * @throw std::out_of_range if the edit is not inside the source.
+     */
+    SyntaxTree edit(const TextEdit &edit, ReparseStats *stats = nullptr) const;
+
+    const std::string &source() const { return *text; }
+    const GreenNode &green() const { return *rootNode; }
+    SyntaxNode root() const;
+
+    /**
+     * @brief Lexical and syntax errors, in source order, as the driver reports them.
+     *
+     * Positions are computed from byte offsets, so on a line with invalid
+     * UTF-8 a stray continuation byte takes no column, as inside a string,
+     * even where the lexer's own columns count it as an unknown character.
+     *
+     * @return std::vector<Diagnostic> The errors; their messages are owned by the tree.
+     */
+    std::vector<Diagnostic> diagnostics() const;
+
+private:
+    SyntaxTree(std::shared_ptr<const std::string> text, GreenNodePtr rootNode, ColumnMode columnMode)
+        : text(std::move(text)), rootNode(std::move(rootNode)), columns(columnMode) {}
+
+    std::shared_ptr<const std::string> text;
+    GreenNodePtr rootNode;
+    ColumnMode columns;
+};
+
+#endif // SYNTAX_TREE_H
@@ -0,0 +1,102 @@
+/**
+ * @file thread_pool.h
+ * @brief Work-stealing thread pool used by the driver to compile files in parallel.
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A fixed-size pool of worker threads with one task deque per worker.
+ *
+ * Tasks submitted from outside the pool are distributed round-robin over the
+ * worker deques, tasks submitted from inside a task go to the submitting
+ * worker's own deque. A worker takes tasks from the front of its own deque
+ * (so submission order is preserved, which lets callers schedule expensive
+ * jobs first) and, once it runs dry, steals from the back of the other deques.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * @brief Starts the worker threads.
+     * @param threadCount Number of workers; 0 uses std::thread::hardware_concurrency().
+     */
+    explicit ThreadPool(unsigned threadCount = 0);
+
+    /**
+     * @brief Waits for all submitted tasks, then joins the workers.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /**
+     * @brief Queues a task for execution.
+     * @param task The task to run. Exceptions escaping a task terminate the program.
+     */
+    void submit(std::function<void()> task);
+
+    /**
+     * @brief Blocks until every submitted task has finished.
+     *
+     * The calling thread helps executing queued tasks while it waits. Must not
+     * be called from inside a task, as the calling task itself counts as pending.
+     */
+    void wait();
+
+    /**
+     * @brief Runs body(0) ... body(count - 1) on the pool and the calling thread.
+     *
+     * Unlike wait(), this may be called from inside a task. Up to size() - 1
+     * helper tasks are queued; they and the caller claim iterations from a
+     * shared counter until none are left, and the caller then waits for the
+     * iterations still running elsewhere. While waiting the caller never runs
+     * unrelated tasks, so a task may use thread-local state around the call.
+     * If every worker is busy the caller simply runs all iterations itself.
+     *
+     * @param count Number of iterations.
+     * @param body The iteration; exceptions escaping it terminate the program.
+     */
+    void parallelFor(size_t count, const std::function<void(size_t)> &body);
+
+    /**
+     * @brief Returns the number of worker threads.
+     * @return unsigned The worker count.
+     */
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+private:
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    bool popLocal(unsigned index, std::function<void()> &task);
+    bool steal(unsigned thiefIndex, std::function<void()> &task);
+    void runTask(std::function<void()> &task);
+    void workerLoop(unsigned index);
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<unsigned> nextQueue{0};
+    std::atomic<size_t> pending{0}; ///< Submitted but not yet finished tasks
+
+    std::mutex sleepMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+    bool stopping = false;
+};
+
+#endif // THREAD_POOL_H
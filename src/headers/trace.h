@@ -0,0 +1,132 @@
+/**
+ * @file trace.h
+ * @brief Lightweight scoped-timer tracing with Chrome trace-event JSON output.
+ *
+ * Wrap a phase in BASSIL_TRACE_SCOPE("name") (or BASSIL_TRACE_SCOPE_ARG to
+ * attach a detail such as the file name) and, when tracing is enabled, its
+ * start time and duration are appended to a per-thread buffer. Buffers are
+ * merged by writeChromeJson() into a file that chrome://tracing and Perfetto
+ * can open.
+ *
+ * When tracing is disabled at runtime a scope costs one relaxed atomic load.
+ * Defining BASSIL_NO_TRACING compiles the macros away entirely.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Trace
+{
+    extern std::atomic<bool> enabledFlag; ///< Use isEnabled()/setEnabled()
+
+    /**
+     * @brief Returns whether scopes are currently recorded.
+     * @return bool True if tracing is on.
+     */
+    inline bool isEnabled()
+    {
+        return enabledFlag.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Turns recording on or off for all threads.
+     * @param enabled True to record scopes.
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     * @brief Monotonic timestamp used for all trace events.
+     * @return std::uint64_t Nanoseconds on the steady clock.
+     */
+    inline std::uint64_t now()
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                              std::chrono::steady_clock::now().time_since_epoch())
+                                              .count());
+    }
+
+    /**
+     * @brief Appends a complete event to the calling thread's buffer.
+     *
+     * @param name Event name; must outlive the trace (normally a string literal).
+     * @param startNs Start timestamp from now().
+     * @param endNs End timestamp from now().
+     * @param detail Optional detail, written as args.detail.
+     */
+    void record(const char *name, std::uint64_t startNs, std::uint64_t endNs, std::string_view detail = {});
+
+    /**
+     * @brief Names the calling thread in the trace (e.g. "worker 3").
+     * @param name The thread name.
+     */
+    void setThreadName(const std::string &name);
+
+    /**
+     * @brief Writes every recorded event as Chrome trace-event JSON.
+     *
+     * Must only be called while no other thread is recording.
+     *
+     * @param path The output file.
+     * @return bool False if the file could not be written.
+     */
+    bool writeChromeJson(const std::string &path);
+
+    /**
+     * @brief Discards all recorded events.
+     */
+    void clear();
+
+    /**
+     * @brief Records the lifetime of a C++ scope as one trace event.
+     */
+    class Scope
+    {
+    public:
+        explicit Scope(const char *name) : name(name), start(isEnabled() ? now() : 0) {}
+
+        Scope(const char *name, std::string_view detail) : name(name), start(isEnabled() ? now() : 0)
+        {
+            if (start != 0)
+            {
+                this->detail = detail;
+            }
+        }
+
+        ~Scope()
+        {
+            if (start != 0)
+            {
+                record(name, start, now(), detail);
+            }
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        const char *name;
+        std::uint64_t start; ///< 0 when tracing was off at construction
+        std::string detail;
+    };
+}
+
+#define BASSIL_TRACE_CONCAT_INNER(a, b) a##b
+#define BASSIL_TRACE_CONCAT(a, b) BASSIL_TRACE_CONCAT_INNER(a, b)
+
+#ifdef BASSIL_NO_TRACING
+#define BASSIL_TRACE_SCOPE(name)
+#define BASSIL_TRACE_SCOPE_ARG(name, detail)
+#else
+/// Traces the rest of the enclosing block as event @p name.
+#define BASSIL_TRACE_SCOPE(name) ::Trace::Scope BASSIL_TRACE_CONCAT(bassilTraceScope_, __LINE__)(name)
+/// Like BASSIL_TRACE_SCOPE, attaching @p detail (anything convertible to std::string_view).
+#define BASSIL_TRACE_SCOPE_ARG(name, detail) ::Trace::Scope BASSIL_TRACE_CONCAT(bassilTraceScope_, __LINE__)(name, detail)
+#endif
+
+#endif // TRACE_H
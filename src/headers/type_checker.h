@@ -0,0 +1,182 @@
+/**
+ * @file type_checker.h
+ * @brief Static type checking of a resolved syntax tree, with hash-consed types.
+ *
+ * Types are interned in a TypeTable: each distinct type is stored once and
+ * named by a TypeId, so two types are equal exactly when their IDs are. The
+ * primitive types have fixed IDs; function types (result and parameter
+ * types) are looked up in an open-addressing table on their components.
+ *
+ * The checker records a type for every node in an array parallel to the tree
+ * arrays: the type of an expression's value, the declared type of a variable,
+ * parameter or function, and TypeVoid for statements. Because children come
+ * before their parent in the tree, it makes one pass over the nodes of each
+ * top-level item front to back, with the types of a node's operands already
+ * known when it gets to the node; only the function types are computed ahead,
+ * so calls may come before the definition.
+ *
+ * Rules: char and int operands of arithmetic are ints, and an int or char
+ * operand next to a float is converted to float; % takes integers only.
+ * Comparisons give bool, == and != also compare two bools, chars or strings.
+ * && || ! take bools, and so do the conditions of if and for. Assignment,
+ * initialisation, arguments and return values accept their own type, an int
+ * or char where a float is expected, and a char where an int is. An
+ * expression with an error has TypeError, which is accepted everywhere so one
+ * mistake is reported once. Later passes can rely on these types and emit
+ * int or float operations without checking at run time.
+ */
+
+#ifndef TYPE_CHECKER_H
+#define TYPE_CHECKER_H
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "arena.h"
+#include "ast.h"
+#include "error_report.h"
+#include "lexer.h"
+#include "resolver.h"
+
+typedef std::uint32_t TypeId; ///< Interned type; compare with == instead of comparing structure
+
+/**
+ * @brief The primitive types, whose TypeIds are fixed
+ */
+enum : TypeId
+{
+    TypeError,  ///< Type of an expression that has an error (already reported)
+    TypeVoid,   ///< Type of statements and of calls to functions without a result
+    TypeInt,    ///< 64-bit signed integer
+    TypeFloat,  ///< 64-bit floating point
+    TypeChar,   ///< Character code
+    TypeString, ///< Immutable text
+    TypeBool,   ///< true or false
+    TypePrimitiveCount
+};
+
+/**
+ * @brief What a type is made of
+ */
+typedef enum : std::uint8_t
+{
+    TY_Primitive, ///< One of the fixed types above; no components
+    TY_Function,  ///< Components: result type, then parameter types
+    TY_Builtin    ///< A builtin function (see Builtin), whose arguments are checked by the checker itself
+} TypeKind;
+
+/**
+ * @brief Hash-consing table of types. Not thread-safe.
+ */
+class TypeTable
+{
+public:
+    TypeTable();
+
+    TypeTable(const TypeTable &) = delete;
+    TypeTable &operator=(const TypeTable &) = delete;
+
+    /**
+     * @brief Returns the ID of a function type, adding it if it is new.
+     * @param result The result type (TypeVoid if none).
+     * @param parameters The parameter types.
+     * @param count Number of parameters.
+     * @return TypeId The ID; equal for equal signatures.
+     */
+    TypeId function(TypeId result, const TypeId *parameters, std::uint32_t count);
+
+    /**
+     * @brief Returns the ID of the type of a builtin function.
+     */
+    TypeId builtin(Builtin which);
+
+    TypeKind kind(TypeId type) const { return types[type].kind; }
+    TypeId result(TypeId function) const { return components[types[function].first]; }                    ///< Result type of a TY_Function
+    std::uint32_t parameterCount(TypeId function) const { return types[function].count - 1; }            ///< Parameters of a TY_Function
+    TypeId parameter(TypeId function, std::uint32_t i) const { return components[types[function].first + 1 + i]; }
+    Builtin builtinOf(TypeId type) const { return static_cast<Builtin>(types[type].first); }             ///< Builtin of a TY_Builtin
+
+    /**
+     * @brief Readable name of a type, as used in messages ("int", "function(int, float) int").
+     * @return std::string_view The name, made when the type was added; valid until the next type is.
+     */
+    std::string_view name(TypeId type) const { return names[type]; }
+
+    /**
+     * @brief Removes every type but the primitives, keeping the capacity.
+     */
+    void clear();
+
+    size_t size() const { return types.size(); } ///< Number of distinct types
+
+private:
+    struct Type
+    {
+        TypeKind kind;
+        std::uint32_t first; ///< TY_Function: index into components; TY_Builtin: the Builtin
+        std::uint32_t count; ///< TY_Function: components (result and parameters)
+        std::uint64_t hash;
+    };
+
+    TypeId intern(TypeKind kind, std::uint32_t first, const TypeId *parts, std::uint32_t count);
+    void grow();
+
+    std::vector<Type> types;
+    std::vector<std::string> names; ///< Per type, so messages about a type need not format it each time
+    std::vector<TypeId> components;
+    std::vector<TypeId> slots; ///< Open addressing over types, TypeError = empty (primitives are never looked up)
+};
+
+/**
+ * @brief Reusable type checker that keeps its buffers between files.
+ *
+ * Type errors are reported as Diagnostics. Results are valid until the next
+ * check(). Not thread-safe; use one instance per thread.
+ */
+class TypeChecker
+{
+public:
+    TypeChecker() = default;
+
+    TypeChecker(const TypeChecker &) = delete;
+    TypeChecker &operator=(const TypeChecker &) = delete;
+
+    /**
+     * @brief Checks the types of one tree.
+     * @param tree The tree, as built by Parser.
+     * @param tokens The tokens it was parsed from.
+     * @param resolution Its names, as bound by Resolver.
+     * @param arena Holds the diagnostic messages.
+     * @return const std::vector<TypeId>& The type of each node (same as types()).
+     */
+    const std::vector<TypeId> &check(const AstView &tree, const std::vector<Token> &tokens, const Resolution &resolution, CompilationArena &arena);
+
+    const std::vector<TypeId> &types() const { return nodeTypes; }                 ///< Type of each node of the last check()
+    const TypeTable &table() const { return typeTable; }                           ///< The types those IDs name
+    const std::vector<Diagnostic> &diagnostics() const { return diagnosticBuffer; } ///< Type errors of the last check(), in source order
+
+private:
+    TypeId typeOf(NodeIndex node);
+    TypeId declaredType(NodeIndex typeNode) const;
+    TypeId binary(NodeIndex node);
+    TypeId unary(NodeIndex node);
+    TypeId assign(NodeIndex node);
+    TypeId call(NodeIndex node);
+    void expectCondition(NodeIndex node, NodeIndex condition);
+    void report(std::uint32_t token, std::initializer_list<std::string_view> message);
+
+    AstView tree;
+    const std::vector<Token> *tokens = nullptr;
+    const Resolution *resolution = nullptr;
+    CompilationArena *arena = nullptr;
+    TypeTable typeTable;
+    std::vector<TypeId> nodeTypes;
+    std::vector<TypeId> parameterScratch;
+    TypeId returnType = TypeVoid; ///< Result type of the function being checked
+    bool insideFunction = false;
+    std::vector<Diagnostic> diagnosticBuffer;
+};
+
+#endif // TYPE_CHECKER_H
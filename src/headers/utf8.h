@@ -0,0 +1,82 @@
+/**
+ * @file utf8.h
+ * @brief UTF-8 validation, decoding and identifier classes for the lexer.
+ *
+ * Sources are validated as a whole before lexing. On x86 CPUs with SSSE3 the
+ * validator checks 16 bytes per step with the lookup algorithm of Keiser and
+ * Lemire (simdjson): three 16-entry table lookups classify each byte pair,
+ * and a separate check catches missing or extra continuation bytes. Blocks
+ * that are pure ASCII skip both checks. Other targets use a scalar validator
+ * that also skips ASCII eight bytes at a time.
+ *
+ * Identifier characters follow Unicode XID_Start / XID_Continue (UAX #31),
+ * with the ranges generated into xid_tables.h by tools/gen_xid_tables.py.
+ */
+
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <cstdint>
+#include <string_view>
+
+namespace Utf8
+{
+    /**
+     * @brief Finds the first invalid UTF-8 sequence.
+     *
+     * Rejects overlong encodings, surrogates, code points above U+10FFFF,
+     * stray continuation bytes and truncated sequences.
+     *
+     * @param text The bytes to check.
+     * @param isAscii Optional, set to true if no byte is 0x80 or above.
+     * @return size_t Offset of the first byte of the first invalid sequence,
+     *         or std::string_view::npos if the text is valid.
+     */
+    size_t findInvalid(std::string_view text, bool *isAscii = nullptr);
+
+    /**
+     * @brief True if the text is valid UTF-8.
+     */
+    inline bool isValid(std::string_view text)
+    {
+        return findInvalid(text) == std::string_view::npos;
+    }
+
+    /**
+     * @brief Decodes one code point, checking that the sequence is valid.
+     * @param p First byte (must be before end).
+     * @param end End of the text.
+     * @param codepoint Receives the code point.
+     * @return int Length of the sequence (1-4), or 0 if it is invalid.
+     */
+    int decode(const char *p, const char *end, std::uint32_t &codepoint);
+
+    /**
+     * @brief Length of a sequence from its first byte, assuming valid UTF-8.
+     * @param lead The first byte.
+     * @return int 1-4 (1 for a byte that cannot start a sequence).
+     */
+    inline int sequenceLength(unsigned char lead)
+    {
+        return lead < 0xC0 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+    }
+
+    /**
+     * @brief Number of continuation bytes (10xxxxxx) in the text.
+     *
+     * Text length minus this is the number of code points in valid UTF-8.
+     */
+    size_t countContinuationBytes(std::string_view text);
+
+    /**
+     * @brief True if the code point may start an identifier (XID_Start or '_').
+     */
+    bool isXidStart(std::uint32_t codepoint);
+
+    /**
+     * @brief True if the code point may continue an identifier (XID_Continue).
+     */
+    bool isXidContinue(std::uint32_t codepoint);
+}
+
+#endif // UTF8_H
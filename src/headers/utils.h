@@ -7,8 +7,8 @@
  * output formatting capabilities. These utilities are designed to support
  * the core functionality of the Bassil language project.
  *
- * @note This file requires Windows-specific headers and may not be
- * compatible with non-Windows environments.
+ * @note The Windows API helpers are only declared when building for Windows
+ * (_WIN32). Everything else is portable and used by the headless drivers.
  *
  * @author Nerd Bear
  * @date 31 August
@@ -20,20 +20,20 @@
 #ifndef UTILS_H
 #define UTILS_H
 
-#pragma comment(lib, "shell32.lib") // Link with shell32.lib for SHChangeNotify
-
 #ifdef _WIN32
+#pragma comment(lib, "shell32.lib") // Link with shell32.lib for SHChangeNotify
 #include <windows.h>
+#include <shlobj.h>
 #endif
 
 #include <iostream>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <limits>
 #include <sstream>
 #include <fstream>
 #include <regex>
-#include <shlobj.h>
 
 namespace Utils
 {
@@ -46,6 +46,7 @@ namespace Utils
      */
     std::vector<std::string> split_string(const std::string &s, const std::string &delimiter);
 
+#ifdef _WIN32
     /**
      * @brief Converts a standard string to a wide string.
      *
@@ -89,6 +90,7 @@ namespace Utils
      * @return RECT A structure containing the screen dimensions.
      */
     RECT GetMaximizedScreenSize(int monitorIndex);
+#endif
 
     /**
      * @brief Trims leading whitespace from a string.
@@ -123,6 +125,20 @@ namespace Utils
      */
     int general_log(const std::string &str, bool isPrintTrue = true);
 
+    /**
+     * @brief Redirects general_log() output to a different file.
+     *
+     * @param path The path of the log file to append to from now on.
+     */
+    void setLogFilePath(const std::string &path);
+
+    /**
+     * @brief Returns the file general_log() currently appends to.
+     *
+     * @return const std::string& The active log file path.
+     */
+    const std::string &getLogFilePath();
+
     int clear_file(const std::string &filename);
 
     /**
@@ -237,6 +253,15 @@ namespace Utils
      */
     std::string wrapText(const std::string &text, size_t lineLength);
 
+    /**
+     * @brief Escapes a string for use inside a JSON string literal.
+     *
+     * @param text The raw text.
+     * @return std::string The text with quotes, backslashes and control characters escaped.
+     */
+    std::string escapeJson(std::string_view text);
+
+#ifdef _WIN32
     /**
      * @brief Sets the file association icon for a specific file extension.
      *
@@ -245,6 +270,7 @@ namespace Utils
      * @return bool Returns true if the association was set successfully, false otherwise.
      */
     bool SetFileAssociationIcon(const std::wstring &fileExtension, const std::wstring &iconPath);
+#endif
 
     /**
      * @brief Reads a specific line from a file.
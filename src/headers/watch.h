@@ -0,0 +1,30 @@
+/**
+ * @file watch.h
+ * @brief bassilc --watch: re-lex sources as they are saved.
+ */
+
+#ifndef WATCH_H
+#define WATCH_H
+
+#include "driver.h"
+
+namespace Watch
+{
+    /**
+     * @brief Lexes every input once, then watches the input tree with inotify.
+     *
+     * Events are collected until the tree has been quiet for options.debounceMs,
+     * then only the files touched by the burst are looked up in a SourceCache.
+     * Files whose content hash did not change (no-op saves) are skipped; for the
+     * others the diagnostics are printed and the token JSON is rewritten.
+     * Deleted files, and the files of directories moved away, have their token
+ * JSON removed. If the inotify queue overflows, every input is rescanned and
+ * rebuilt.
+     *
+     * @param options The driver options; inputs are files and/or directories.
+     * @return int Only returns on error (1); the watch runs until interrupted.
+     */
+    int run(const Driver::Options &options);
+}
+
+#endif // WATCH_H
@@ -3,9 +3,11 @@
 #include <sstream>
 #include <vector>
 #include <stdexcept>
-#include "C:/coding-projects/CPP-Dev/bassil/src/headers/utils.h"
-#include "C:/coding-projects/CPP-Dev/bassil/src/headers/error_report.h"
-#include "C:/coding-projects/CPP-Dev/bassil/src/headers/lexer.h"
+#include "headers/utils.h"
+#include "headers/error_report.h"
+#include "headers/lexer.h"
+#include "headers/trace.h"
+#include "headers/alloc_tracker.h"
 
 /**
  * @brief Main entry point for the Windows application.
@@ -23,6 +25,10 @@ int WINAPI startMainProccess(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR
 {
     std::cout << "Main Start Proccess reached\n";
 
+    // Set BASSIL_TRACE=<file> to get a Chrome trace of the phases of this run.
+    const char *traceFile = std::getenv("BASSIL_TRACE");
+    Trace::setEnabled(traceFile != nullptr);
+
     try
     {
         Utils::enableAnsiInConsole();
@@ -48,7 +54,12 @@ int WINAPI startMainProccess(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR
         Utils::clear_file("C:/coding-projects/CPP-Dev/bassil/output/after_lex.json");
 
         // Read input file
-        std::string inputContent = Utils::readFileToString(inputFilePath);
+        std::string inputContent;
+        {
+            BASSIL_TRACE_SCOPE("read");
+            BASSIL_ALLOC_PHASE(AllocTracker::AP_Read);
+            inputContent = Utils::readFileToString(inputFilePath);
+        }
 
         if (inputContent.empty())
         {
@@ -58,14 +69,31 @@ int WINAPI startMainProccess(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR
         Utils::general_log("Input string: " + inputContent, true);
 
         // Perform lexical analysis
-        std::vector<Token> tokens = lex(inputContent);
+        CompilationArena arena(inputContent.size() + 1024);
+        std::vector<Token> tokens;
+        {
+            BASSIL_ALLOC_PHASE(AllocTracker::AP_Lex);
+            tokens = lex(inputContent, arena);
+        }
 
         // Display and save tokens
-        display_tokens(tokens);
-        save_tokens(tokens, "C:/coding-projects/CPP-Dev/bassil/output/after_lex.json");
+        {
+            BASSIL_ALLOC_PHASE(AllocTracker::AP_Display);
+            display_tokens(tokens);
+        }
+        {
+            BASSIL_ALLOC_PHASE(AllocTracker::AP_Save);
+            save_tokens(tokens, "C:/coding-projects/CPP-Dev/bassil/output/after_lex.json");
+        }
 
         Utils::CreateWinAPI32BallonNotification("Lexical Analysis Complete", "Lexical analysis has been completed successfully.", 0);
 
+        if (traceFile)
+        {
+            Trace::writeChromeJson(traceFile);
+            Trace::clear();
+        }
+
         return 0;
     }
     catch (const std::exception &e)
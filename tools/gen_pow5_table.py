@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+"""Generates src/headers/pow5_table.h, the 128-bit powers of five used by the
+Eisel-Lemire float parser in src/cpp/numbers.cpp.
+
+Entry q - SMALLEST_POWER holds 5^q scaled so its most significant bit is bit
+127, truncated for q >= 0 and rounded up for q < 0 (the same table as the
+fast_float library).
+
+Usage: python3 tools/gen_pow5_table.py > src/headers/pow5_table.h
+"""
+
+SMALLEST_POWER = -342
+LARGEST_POWER = 308
+
+
+def entries():
+    for q in range(SMALLEST_POWER, 0):
+        power5 = 5 ** -q
+        z = 0
+        while (1 << z) < power5:
+            z += 1
+        if q >= -27:
+            b = z + 127
+            c = 2 ** b // power5 + 1
+        else:
+            b = 2 * z + 2 * 64
+            c = 2 ** b // power5 + 1
+            while c >= (1 << 128):
+                c //= 2
+        yield c
+    for q in range(0, LARGEST_POWER + 1):
+        power5 = 5 ** q
+        while power5 < (1 << 127):
+            power5 *= 2
+        while power5 >= (1 << 128):
+            power5 //= 2
+        yield power5
+
+
+def main():
+    print("/**")
+    print(" * @file pow5_table.h")
+    print(" * @brief 128-bit powers of five for the Eisel-Lemire float parser.")
+    print(" *")
+    print(" * Generated by tools/gen_pow5_table.py; do not edit.")
+    print(" */")
+    print()
+    print("#ifndef POW5_TABLE_H")
+    print("#define POW5_TABLE_H")
+    print()
+    print("#include <cstdint>")
+    print()
+    print("namespace Numbers")
+    print("{")
+    print("    constexpr int pow5SmallestPower = %d;" % SMALLEST_POWER)
+    print("    constexpr int pow5LargestPower = %d;" % LARGEST_POWER)
+    print()
+    print("    /// {high, low} 64-bit halves of 5^q, for q = pow5SmallestPower..pow5LargestPower")
+    print("    const std::uint64_t pow5Table[][2] = {")
+    for c in entries():
+        print("        {0x%016xull, 0x%016xull}," % (c >> 64, c & 0xFFFFFFFFFFFFFFFF))
+    print("    };")
+    print("}")
+    print()
+    print("#endif // POW5_TABLE_H")
+
+
+if __name__ == "__main__":
+    main()
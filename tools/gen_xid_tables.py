@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+"""Generates src/headers/xid_tables.h, the non-ASCII code point ranges with the
+Unicode XID_Start and XID_Continue properties used for Bassil identifiers
+(the same definition as UAX #31, C++ and Python identifiers).
+
+The properties are read from Python's own identifier rules, so the Unicode
+version is that of the interpreter running the script (printed in the header).
+ASCII is left out: the lexer handles it with direct byte tests.
+
+Usage: python3 tools/gen_xid_tables.py > src/headers/xid_tables.h
+"""
+
+import sys
+import unicodedata
+
+
+def is_xid_start(c):
+    return chr(c).isidentifier()
+
+
+def is_xid_continue(c):
+    return ("a" + chr(c)).isidentifier()
+
+
+def ranges(predicate):
+    result = []
+    start = None
+    for c in range(0x80, sys.maxunicode + 2):
+        inside = c <= sys.maxunicode and predicate(c)
+        if inside and start is None:
+            start = c
+        elif not inside and start is not None:
+            result.append((start, c - 1))
+            start = None
+    return result
+
+
+def print_table(name, table):
+    print("    /// %d ranges" % len(table))
+    print("    const std::uint32_t %s[][2] = {" % name)
+    for i in range(0, len(table), 4):
+        row = ", ".join("{0x%05X, 0x%05X}" % r for r in table[i:i + 4])
+        print("        %s," % row)
+    print("    };")
+
+
+def main():
+    start = ranges(is_xid_start)
+    cont = ranges(is_xid_continue)
+    print("/**")
+    print(" * @file xid_tables.h")
+    print(" * @brief Non-ASCII XID_Start / XID_Continue ranges (Unicode %s)." % unicodedata.unidata_version)
+    print(" *")
+    print(" * Generated by tools/gen_xid_tables.py; do not edit.")
+    print(" */")
+    print()
+    print("#ifndef XID_TABLES_H")
+    print("#define XID_TABLES_H")
+    print()
+    print("#include <cstdint>")
+    print()
+    print("namespace Utf8")
+    print("{")
+    print("    /// Sorted, disjoint {first, last} code point ranges")
+    print_table("xidStartRanges", start)
+    print()
+    print_table("xidContinueRanges", cont)
+    print("}")
+    print()
+    print("#endif // XID_TABLES_H")
+
+
+if __name__ == "__main__":
+    main()